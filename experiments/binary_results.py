@@ -0,0 +1,177 @@
+# Reader for the binary results format of run_experiment --output_format binary
+# (see src/binary_output_writer.h for the layout). Files that are still being
+# written can be read as well: an incomplete last record is ignored.
+
+import json
+import struct
+
+import run_experiment as rexp
+
+MAGIC = b'SFFTRES1'
+RECORD_INPUT = 1
+RECORD_TRIAL = 2
+RECORD_TIMING = 3
+
+PERF_EVENTS = ['cycles', 'instructions', 'l1d_read_misses', 'llc_misses',
+               'dtlb_read_misses', 'branch_misses']
+PHASES = ['permute_filter', 'bucket_fft', 'location', 'estimation']
+
+STATS_FORMAT = '<Qddd'
+TRIAL_FORMAT = ('<II d' + 'Qddd' * 3 + ' d' + 'q' * len(PERF_EVENTS)
+                + 'd' * len(PHASES))
+TIMING_FORMAT = '<II QQQ ddddddd'
+
+
+def unpack_stats(data, offset):
+  l0, l1, l2, linf = struct.unpack_from(STATS_FORMAT, data, offset)
+  return rexp.SignalStatistics(l0=l0, l1=l1, l2=l2, linf=linf)
+
+
+def parse_input_record(payload):
+  name_length, = struct.unpack_from('<I', payload, 0)
+  offset = 4 + name_length
+  name = payload[4:offset].decode('utf-8')
+  reference_time, = struct.unpack_from('<d', payload, offset)
+  offset += 8
+  stats = []
+  for ii in range(4):
+    stats.append(unpack_stats(payload, offset))
+    offset += struct.calcsize(STATS_FORMAT)
+  return name, reference_time, stats
+
+
+def parse_trial_record(payload):
+  values = struct.unpack_from(TRIAL_FORMAT, payload, 0)
+  algorithm_index, flags, running_time = values[0:3]
+  stats = []
+  for ii in range(3):
+    l0, l1, l2, linf = values[3 + 4 * ii:7 + 4 * ii]
+    stats.append(rexp.SignalStatistics(l0=l0, l1=l1, l2=l2, linf=linf))
+  pos = 15
+  running_fraction = values[pos]
+  counts = values[pos + 1:pos + 1 + len(PERF_EVENTS)]
+  pos += 1 + len(PERF_EVENTS)
+  phase_values = values[pos:pos + len(PHASES)]
+  perf = None
+  if flags & 1:
+    perf = {name: count for name, count in zip(PERF_EVENTS, counts)
+            if count >= 0}
+    perf['running_fraction'] = running_fraction
+  phases = None
+  if flags & 2:
+    phases = dict(zip(PHASES, phase_values))
+  result = rexp.RunResult(running_time=running_time, error_stats=stats[0],
+                          topk_error_stats=stats[1], output_stats=stats[2],
+                          perf_counters=perf, phase_times=phases)
+  return algorithm_index, result
+
+
+def parse_timing_record(payload):
+  values = struct.unpack_from(TIMING_FORMAT, payload, 0)
+  timing = rexp.TimingStatistics(num_warmup_runs=values[2],
+                                 num_samples=values[3],
+                                 num_outliers=values[4],
+                                 median=values[5],
+                                 p5=values[6],
+                                 p95=values[7],
+                                 mad=values[8],
+                                 mean_without_outliers=values[9],
+                                 median_ci_low=values[10],
+                                 median_ci_high=values[11])
+  return values[0], timing
+
+
+# Returns the header (a dictionary with command, n, k, l0_epsilon, and
+# algorithms) and a generator over (record type, payload) pairs.
+def read_records(data):
+  if data[0:len(MAGIC)] != MAGIC:
+    raise ValueError('Not a binary results file.')
+  offset = len(MAGIC)
+  header_length, = struct.unpack_from('<I', data, offset)
+  offset += 4
+  header = json.loads(data[offset:offset + header_length].decode('utf-8'))
+  offset += header_length
+
+  def records(offset):
+    while offset + 8 <= len(data):
+      record_type, length = struct.unpack_from('<II', data, offset)
+      if offset + 8 + length > len(data):
+        break
+      yield record_type, data[offset + 8:offset + 8 + length]
+      offset += 8 + length
+
+  return header, records(offset)
+
+
+# Returns a dictionary from algorithm name to ExperimentResults (the same
+# structure as run_experiment.load_multi_algorithm_results_file). The results
+# of an input are only included once all of its records have been written.
+def load_binary_results_file(filename):
+  with open(filename, 'rb') as f:
+    data = f.read()
+  header, records = read_records(data)
+  algorithms = header['algorithms']
+
+  results = {}
+  for algorithm in algorithms:
+    results[algorithm] = rexp.ExperimentResults(command=header['command'],
+                                                results={})
+
+  def add_input(current):
+    name, reference_time, stats, runs, timing = current
+    for ii, algorithm in enumerate(algorithms):
+      if ii not in timing:
+        # Incomplete input at the end of the file.
+        return
+    for ii, algorithm in enumerate(algorithms):
+      results[algorithm].results[name] = rexp.InputResults(
+          input_stats=stats[0], reference_time=reference_time,
+          reference_output_stats=stats[1], results=runs.get(ii, []),
+          best_k_term_stats=stats[2], best_k_term_error_stats=stats[3],
+          timing_stats=timing[ii])
+
+  current = None
+  for record_type, payload in records:
+    if record_type == RECORD_INPUT:
+      if current is not None:
+        add_input(current)
+      name, reference_time, stats = parse_input_record(payload)
+      current = (name, reference_time, stats, {}, {})
+    elif record_type == RECORD_TRIAL:
+      algorithm_index, run = parse_trial_record(payload)
+      current[3].setdefault(algorithm_index, []).append(run)
+    elif record_type == RECORD_TIMING:
+      algorithm_index, timing = parse_timing_record(payload)
+      current[4][algorithm_index] = timing
+  if current is not None:
+    add_input(current)
+  return results
+
+
+# Returns the trials as columns: a dictionary from column name (input,
+# algorithm, running_time, error_l0, error_l1, ..., output_linf) to a list
+# with one entry per trial.
+def load_binary_trial_columns(filename):
+  with open(filename, 'rb') as f:
+    data = f.read()
+  header, records = read_records(data)
+  columns = {'input': [], 'algorithm': [], 'running_time': []}
+  for prefix in ['error', 'topk_error', 'output']:
+    for field in rexp.SignalStatistics._fields:
+      columns[prefix + '_' + field] = []
+
+  input_name = None
+  for record_type, payload in records:
+    if record_type == RECORD_INPUT:
+      input_name = parse_input_record(payload)[0]
+    elif record_type == RECORD_TRIAL:
+      algorithm_index, run = parse_trial_record(payload)
+      columns['input'].append(input_name)
+      columns['algorithm'].append(header['algorithms'][algorithm_index])
+      columns['running_time'].append(run.running_time)
+      for prefix, stats in [('error', run.error_stats),
+                            ('topk_error', run.topk_error_stats),
+                            ('output', run.output_stats)]:
+        for field in rexp.SignalStatistics._fields:
+          columns[prefix + '_' + field].append(getattr(stats, field))
+  return columns
@@ -0,0 +1,73 @@
+import os
+import random
+import sys
+
+from gen_input import gen_inputs
+from helpers import make_data_point, write_data_points_to_file, Tee, \
+    data_filename, index_filename, results_filename, \
+    plot_time_data_filename, script_output_filename
+from run_experiment import run_experiment, extract_running_times, \
+    load_results_file
+
+# Compares the native sparse FFTs (and FFTW) on composite signal lengths
+# n = 3 * 2^e with the alternative of zero-padding to the next power of two
+# (4 * 2^e). The padded runs use k-sparse inputs of the padded length, so they
+# measure the running time the padding costs (a zero-padded k-sparse signal
+# is not k-sparse in the frequency domain, so the padded spectra would also
+# have to be post-processed).
+
+tmpdir = '/tmp/sfft_experiments/composite_vs_padded'
+num_instances = 10
+num_trials = 10
+exp1 = 14
+exp2 = 22
+k = 50
+l0_eps = 0.5
+time_percentile_low = 0
+time_percentile_high = 95
+random.seed(3175209)
+
+if not os.path.isdir(tmpdir):
+  os.makedirs(tmpdir)
+sys.stdout = Tee(script_output_filename(tmpdir))
+
+algs = ['fftw', 'sfft1-native', 'sfft2-native']
+sizes = [(3 * 2 ** exp, 4 * 2 ** exp) for exp in range(exp1, exp2 + 1)]
+
+for composite_n, padded_n in sizes:
+  for n in [composite_n, padded_n]:
+    print 'n = {}'.format(n)
+    print '  generating input data ...'
+    indexf = index_filename(tmpdir, n, k)
+    input_filename = gen_inputs(n, k, num_instances,
+        data_filename(tmpdir, n, k, '{}'),
+        seed=random.randint(0, 2000000000), index_file=indexf)
+    for alg in algs:
+      print '  algorithm: {}'.format(alg)
+      run_experiment(n, k, indexf, alg, l0_eps, num_trials,
+          seed=random.randint(0, 2000000000),
+          output_file=results_filename(tmpdir, alg, n, k))
+    for f in input_filename:
+      os.remove(f)
+
+# Running times by composite n: at n itself and padded to the next power of
+# two.
+for alg in algs:
+  composite_results = {}
+  padded_results = {}
+  for composite_n, padded_n in sizes:
+    for n, results in [(composite_n, composite_results),
+                       (padded_n, padded_results)]:
+      r = load_results_file(results_filename(tmpdir, alg, n, k))
+      results[composite_n] = make_data_point(extract_running_times(r),
+                                             time_percentile_low,
+                                             time_percentile_high)
+  print '\n{}:'.format(alg)
+  for composite_n, padded_n in sizes:
+    print '  n = {:>9}: {:.3e} s   padded to {:>9}: {:.3e} s'.format(
+        composite_n, composite_results[composite_n].average, padded_n,
+        padded_results[composite_n].average)
+  write_data_points_to_file(composite_results,
+      plot_time_data_filename(tmpdir, alg + '_composite'), 'n', 'time')
+  write_data_points_to_file(padded_results,
+      plot_time_data_filename(tmpdir, alg + '_padded'), 'n', 'time')
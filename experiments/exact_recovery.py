@@ -0,0 +1,63 @@
+import os
+import random
+import sys
+
+from gen_input import gen_inputs
+from helpers import Tee, data_filename, index_filename, results_filename, \
+    script_output_filename
+from run_experiment import run_experiment, extract_l0_errors, \
+    extract_l2_errors, load_results_file
+
+# Correctness check of the native sparse FFTs: on noiseless k-sparse inputs
+# (magnitude 1, random phases), every trial must recover the spectrum exactly
+# up to l0_eps per coefficient, i.e., find the full support and no spurious
+# frequencies. Exits with status 1 if any trial fails.
+
+tmpdir = '/tmp/sfft_experiments/exact_recovery'
+num_instances = 5
+num_trials = 5
+l0_eps = 1e-4
+random.seed(4410973)
+
+# (n, rows, k, algorithms). rows > 1 are 2D inputs.
+configs = [
+  (2 ** 14, 1, 10, ['sfft1-native', 'sfft2-native']),
+  (2 ** 18, 1, 50, ['sfft1-native', 'sfft2-native']),
+  (2 ** 22, 1, 50, ['sfft1-native', 'sfft2-native']),
+  (2 ** 22, 1, 500, ['sfft1-native', 'sfft2-native']),
+  (3 * 2 ** 16, 1, 50, ['sfft1-native', 'sfft2-native']),
+  (5 * 3 ** 9, 1, 20, ['sfft1-native', 'sfft2-native']),
+  (2 ** 20, 2 ** 10, 50, ['sfft2d-native']),
+  (3 * 2 ** 18, 768, 50, ['sfft2d-native']),
+  (2 ** 22, 2 ** 9, 50, ['sfft2d-native']),
+]
+
+if not os.path.isdir(tmpdir):
+  os.makedirs(tmpdir)
+sys.stdout = Tee(script_output_filename(tmpdir))
+
+failures = 0
+for n, rows, k, algs in configs:
+  print 'n = {} (rows = {}), k = {}'.format(n, rows, k)
+  indexf = index_filename(tmpdir, n, k)
+  input_filename = gen_inputs(n, k, num_instances,
+      data_filename(tmpdir, n, k, '{}'),
+      seed=random.randint(0, 2000000000), index_file=indexf,
+      randomize_phase=True, rows=rows)
+  for alg in algs:
+    r = run_experiment(n, k, indexf, alg, l0_eps, num_trials,
+        seed=random.randint(0, 2000000000),
+        output_file=results_filename(tmpdir, alg, n, k), num_warmup_runs=1,
+        rows=rows)
+    l0_errors = extract_l0_errors(r)
+    num_failed = sum(1 for e in l0_errors if e > 0)
+    print '  {:<14} failed trials {:>3} / {:<3} max l2 error {:.3e}'.format(
+        alg, num_failed, len(l0_errors), max(extract_l2_errors(r)))
+    failures += num_failed
+  for f in input_filename:
+    os.remove(f)
+
+if failures > 0:
+  print '\n{} trials did not recover the spectrum exactly.'.format(failures)
+  sys.exit(1)
+print '\nAll trials recovered the spectrum exactly.'
@@ -5,8 +5,11 @@ import helpers
 def snr_db_to_noise_variance(snr, n, k):
   return float(k) / float(2 * helpers.db_to_ratio(snr) * n)
 
+# If codec is not empty, the input is written as a compressed signal container
+# with this codec (raw, lossless, or float32). With rows > 1, the input is a
+# rows x (n / rows) array with a k-sparse 2D spectrum.
 def gen_input(n, k, output_file, seed, randomize_phase=False, stats_file='',
-    noise_variance=-1):
+    noise_variance=-1, wisdom_file='', codec='', rows=1):
   cmd = ['./gen_input']
   cmd.extend(['--n', str(n)])
   cmd.extend(['--k', str(k)])
@@ -19,4 +22,43 @@ def gen_input(n, k, output_file, seed, randomize_phase=False, stats_file='',
   if noise_variance > 0:
     var_string = '{:.6e}'.format(noise_variance)
     cmd.extend(['--noise_variance', var_string])
+  if len(wisdom_file) > 0:
+    cmd.extend(['--wisdom_file', wisdom_file])
+  if len(codec) > 0:
+    cmd.extend(['--output_format', 'container', '--codec', codec])
+  if rows > 1:
+    cmd.extend(['--rows', str(rows)])
   subprocess.check_output(cmd, stdin=None, stderr=subprocess.STDOUT)
+
+# Generates num_instances inputs with one gen_input process. The '{}' in
+# output_pattern and stats_pattern is replaced by the instance number
+# 1, ..., num_instances (e.g., data_filename(basedir, n, k, '{}')), and the
+# instance seeds are derived from seed. If index_file is not empty, the list of
+# inputs is written to it. codec is the same as in gen_input.
+def gen_inputs(n, k, num_instances, output_pattern, seed, index_file='',
+    randomize_phase=False, stats_pattern='', noise_variance=-1,
+    wisdom_file='', codec='', rows=1):
+  cmd = ['./gen_input']
+  cmd.extend(['--n', str(n)])
+  cmd.extend(['--k', str(k)])
+  cmd.extend(['--num_instances', str(num_instances)])
+  cmd.extend(['--output_pattern', output_pattern])
+  cmd.extend(['--seed', str(seed)])
+  if len(index_file) > 0:
+    cmd.extend(['--index_file', index_file])
+  if not randomize_phase:
+    cmd.append('--skip_phase_randomization')
+  if len(stats_pattern) > 0:
+    cmd.extend(['--stats_pattern', stats_pattern])
+  if noise_variance > 0:
+    var_string = '{:.6e}'.format(noise_variance)
+    cmd.extend(['--noise_variance', var_string])
+  if len(wisdom_file) > 0:
+    cmd.extend(['--wisdom_file', wisdom_file])
+  if len(codec) > 0:
+    cmd.extend(['--output_format', 'container', '--codec', codec])
+  if rows > 1:
+    cmd.extend(['--rows', str(rows)])
+  subprocess.check_output(cmd, stdin=None, stderr=subprocess.STDOUT)
+  return [output_pattern.replace('{}', str(instance))
+          for instance in range(1, num_instances + 1)]
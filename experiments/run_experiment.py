@@ -8,9 +8,20 @@ ExperimentResults = namedtuple('ExperimentResults',
 InputResults = namedtuple('InputResults', ['input_stats', 'reference_time',
                                            'reference_output_stats', 'results',
                                            'best_k_term_stats',
-                                           'best_k_term_error_stats'])
+                                           'best_k_term_error_stats',
+                                           'timing_stats'])
+# perf_counters is a dictionary from event name to count (or None if the run
+# did not record performance counters). phase_times is a dictionary from
+# phase name (permute_filter, bucket_fft, location, estimation) to seconds (or
+# None if the algorithm did not report phase times).
 RunResult = namedtuple('RunResult', ['running_time', 'error_stats',
-                                     'topk_error_stats', 'output_stats'])
+                                     'topk_error_stats', 'output_stats',
+                                     'perf_counters', 'phase_times'])
+TimingStatistics = namedtuple('TimingStatistics',
+                              ['num_warmup_runs', 'num_samples', 'num_outliers',
+                               'median', 'p5', 'p95', 'mad',
+                               'mean_without_outliers', 'median_ci_low',
+                               'median_ci_high'])
 
 
 def write_index_file(index_filename, input_filenames):
@@ -28,34 +39,81 @@ def extract_stats(stats):
   return SignalStatistics(l0=l0, l1=l1, l2=l2, linf=linf)
 
 
-def extract_input_results(obj):
-  istats = extract_stats(obj['input_stats'])
-  reftime = float(obj['reference_time'])
-  refostats = extract_stats(obj['reference_output_stats'])
-  ktstats = extract_stats(obj['best_k_term_stats'])
-  ktestats = extract_stats(obj['best_k_term_error_stats'])
+def extract_timing_stats(stats):
+  if stats is None:
+    return None
+  return TimingStatistics(num_warmup_runs=int(stats['num_warmup_runs']),
+                          num_samples=int(stats['num_samples']),
+                          num_outliers=int(stats['num_outliers']),
+                          median=float(stats['median']),
+                          p5=float(stats['p5']),
+                          p95=float(stats['p95']),
+                          mad=float(stats['mad']),
+                          mean_without_outliers=float(
+                              stats['mean_without_outliers']),
+                          median_ci_low=float(stats['median_ci_low']),
+                          median_ci_high=float(stats['median_ci_high']))
+
+
+def extract_run_results(runs):
   rresults = []
-  for run in obj['results']:
+  for run in runs:
     time = run['running_time']
     estats = extract_stats(run['error_stats'])
     testats = extract_stats(run['topk_error_stats'])
     ostats = extract_stats(run['output_stats'])
+    perf = run.get('perf_counters')
+    phases = run.get('phase_times')
+    if phases is not None:
+      phases = {name: float(t) for name, t in phases.items()}
     rresults.append(RunResult(running_time=time, error_stats=estats,
-                              topk_error_stats=testats, output_stats=ostats))
+                              topk_error_stats=testats, output_stats=ostats,
+                              perf_counters=perf, phase_times=phases))
+  return rresults
+
+
+# timing is None for results files without timing statistics.
+def extract_input_results(obj, runs, timing):
+  istats = extract_stats(obj['input_stats'])
+  reftime = float(obj['reference_time'])
+  refostats = extract_stats(obj['reference_output_stats'])
+  ktstats = extract_stats(obj['best_k_term_stats'])
+  ktestats = extract_stats(obj['best_k_term_error_stats'])
+  rresults = extract_run_results(runs)
   return InputResults(input_stats=istats, reference_time=reftime,
                       reference_output_stats=refostats, results=rresults,
                       best_k_term_stats=ktstats,
-                      best_k_term_error_stats=ktestats)
+                      best_k_term_error_stats=ktestats,
+                      timing_stats=extract_timing_stats(timing))
 
 
 def parse_results_json(obj):
   cmd = obj['command']
   input_results = {}
   for infile in obj['results'].keys():
-    input_results[infile] = extract_input_results(obj['results'][infile])
+    inobj = obj['results'][infile]
+    input_results[infile] = extract_input_results(inobj, inobj['results'],
+                                                  inobj.get('timing_stats'))
   return ExperimentResults(command=cmd, results=input_results)
 
 
+# Parses the output of run_experiment --algorithms. Returns a dictionary from
+# algorithm name to ExperimentResults, so the functions below can be used for
+# each algorithm separately.
+def parse_multi_algorithm_results_json(obj):
+  cmd = obj['command']
+  results = {}
+  for infile in obj['results'].keys():
+    inobj = obj['results'][infile]
+    for algorithm, runs in inobj['algorithm_results'].iteritems():
+      if algorithm not in results:
+        results[algorithm] = ExperimentResults(command=cmd, results={})
+      timing = inobj.get('algorithm_timing_stats', {}).get(algorithm)
+      results[algorithm].results[infile] = extract_input_results(inobj, runs,
+                                                                 timing)
+  return results
+
+
 def extract_running_times(experiment_results):
   res = []
   for input_results in experiment_results.results.itervalues():
@@ -64,6 +122,13 @@ def extract_running_times(experiment_results):
   return res
 
 
+def extract_median_running_times(experiment_results):
+  res = []
+  for input_results in experiment_results.results.itervalues():
+    res.append(input_results.timing_stats.median)
+  return res
+
+
 def extract_l2_errors(experiment_results):
   res = []
   for input_results in experiment_results.results.itervalues():
@@ -127,8 +192,14 @@ def load_results_file(filename):
     return parse_results_json(json.load(f))
 
 
+def load_multi_algorithm_results_file(filename):
+  with open(filename, 'r') as f:
+    return parse_multi_algorithm_results_json(json.load(f))
+
+
 def run_experiment(n, k, input_index, algorithm, l0_epsilon, num_trials, seed,
-                   output_file, num_warmup_runs=10, rounded_real_output=False):
+                   output_file, num_warmup_runs=10, rounded_real_output=False,
+                   wisdom_file='', rows=1):
   cmd = ['./run_experiment']
   cmd.extend(['--n', str(n)])
   cmd.extend(['--k', str(k)])
@@ -142,5 +213,35 @@ def run_experiment(n, k, input_index, algorithm, l0_epsilon, num_trials, seed,
     cmd.extend(['--output_file', output_file])
   if rounded_real_output:
     cmd.append('--rounded_real_output')
+  if len(wisdom_file) > 0:
+    cmd.extend(['--wisdom_file', wisdom_file])
+  if rows > 1:
+    cmd.extend(['--rows', str(rows)])
   subprocess.call(cmd, stdin=None, stderr=subprocess.STDOUT)
   return load_results_file(output_file)
+
+
+# Runs several algorithms on the same inputs in one run_experiment process.
+# Returns a dictionary from algorithm name to ExperimentResults.
+def run_experiment_multi(n, k, input_index, algorithms, l0_epsilon, num_trials,
+                         seed, output_file, num_warmup_runs=10,
+                         rounded_real_output=False, wisdom_file='', rows=1):
+  cmd = ['./run_experiment']
+  cmd.extend(['--n', str(n)])
+  cmd.extend(['--k', str(k)])
+  cmd.extend(['--input_index', input_index])
+  cmd.extend(['--algorithms', ','.join(algorithms)])
+  cmd.extend(['--l0_epsilon', str(l0_epsilon)])
+  cmd.extend(['--num_trials', str(num_trials)])
+  cmd.extend(['--num_warmup_runs', str(num_warmup_runs)])
+  cmd.extend(['--seed', str(seed)])
+  if (len(output_file) > 0):
+    cmd.extend(['--output_file', output_file])
+  if rounded_real_output:
+    cmd.append('--rounded_real_output')
+  if len(wisdom_file) > 0:
+    cmd.extend(['--wisdom_file', wisdom_file])
+  if rows > 1:
+    cmd.extend(['--rows', str(rows)])
+  subprocess.call(cmd, stdin=None, stderr=subprocess.STDOUT)
+  return load_multi_algorithm_results_file(output_file)
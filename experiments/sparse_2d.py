@@ -0,0 +1,61 @@
+import os
+import random
+import sys
+
+from gen_input import gen_inputs
+from helpers import make_data_point, write_data_points_to_file, Tee, \
+    data_filename, index_filename, results_filename, \
+    plot_time_data_filename, script_output_filename
+from run_experiment import run_experiment, extract_running_times, \
+    extract_l2_errors, load_results_file
+
+# Compares the native 2D sparse FFT with dense 2D FFTs (FFTW) on square
+# side x side signals with k-sparse 2D spectra, up to 4096 x 4096 and beyond.
+# The inputs are stored in row-major order; the errors are computed against
+# the 2D FFTW reference with the frequencies as row-major indices.
+
+tmpdir = '/tmp/sfft_experiments/sparse_2d'
+num_instances = 5
+num_trials = 5
+sides = [512, 1024, 2048, 4096, 8192]
+k = 50
+l0_eps = 0.5
+time_percentile_low = 0
+time_percentile_high = 95
+random.seed(6640183)
+
+if not os.path.isdir(tmpdir):
+  os.makedirs(tmpdir)
+sys.stdout = Tee(script_output_filename(tmpdir))
+
+algs = ['fftw', 'sfft2d-native']
+
+for side in sides:
+  n = side * side
+  print 'side = {} (n = {})'.format(side, n)
+  print '  generating input data ...'
+  indexf = index_filename(tmpdir, n, k)
+  input_filename = gen_inputs(n, k, num_instances,
+      data_filename(tmpdir, n, k, '{}'),
+      seed=random.randint(0, 2000000000), index_file=indexf, rows=side)
+  for alg in algs:
+    print '  algorithm: {}'.format(alg)
+    run_experiment(n, k, indexf, alg, l0_eps, num_trials,
+        seed=random.randint(0, 2000000000),
+        output_file=results_filename(tmpdir, alg, n, k), rows=side)
+  for f in input_filename:
+    os.remove(f)
+
+for alg in algs:
+  time_results = {}
+  print '\n{}:'.format(alg)
+  for side in sides:
+    n = side * side
+    r = load_results_file(results_filename(tmpdir, alg, n, k))
+    time_results[side] = make_data_point(extract_running_times(r),
+                                         time_percentile_low,
+                                         time_percentile_high)
+    print '  {:>5} x {:<5}: {:.3e} s   max l2 error {:.3e}'.format(
+        side, side, time_results[side].average, max(extract_l2_errors(r)))
+  write_data_points_to_file(time_results,
+      plot_time_data_filename(tmpdir, alg), 'side', 'time')
@@ -1,6 +1,7 @@
 #ifndef __AAFFT_INTERFACE_H__
 #define __AAFFT_INTERFACE_H__
 
+#include <cmath>
 #include <complex>
 #include <cstdio>
 #include <iostream>
@@ -22,27 +23,45 @@ using std::vector;
 #include "aafft/AAfourier1D.h"
 
 #include "fft_interface.h"
+#include "perf_counters.h"
 #include "timer.h"
+#include "tuning_database.h"
 
 class AAFFTInterface : public FFTInterface {
  public:
-  AAFFTInterface(size_t n, size_t k) : n_(n), k_(k) {};
+  // The built-in parameters only cover k in {50, 100, 200, 500, 1000, 2000,
+  // 4000}. For other k, tuned parameters are required.
+  AAFFTInterface(size_t n, size_t k,
+                 const TuningParameters& tuning = TuningParameters())
+      : n_(n), k_(k), tuning_(tuning) {};
+
+  // The parameters I, S, M, and E (see SetImportantParameters). The initial
+  // values are those of the nearest k with built-in parameters.
+  static std::vector<TunableParameter> TunableParameters(size_t n, size_t k);
 
   bool Setup();
 
-  bool RunTrial(const std::vector<std::complex<double>>& input,
-                std::vector<std::complex<double>>* output,
-                double* running_time);
+  bool HasSparseOutput() const {
+    return true;
+  }
+
+  bool RunTrialSparse(const std::complex<double>* input,
+                      SparseSignal* output,
+                      double* running_time);
 
   ~AAFFTInterface() {}
 
  private:
   size_t n_;
   size_t k_;
+  TuningParameters tuning_;
   std::vector<Rep_Term> output_;
   Parameters params_;
 
-  static std::vector<std::complex<double>> input_;
+  // Points to the input of the current trial. Fast_DFT only accepts a plain
+  // function pointer for sampling the signal, hence the static member. It is
+  // thread-local so that several instances can run in concurrent threads.
+  static thread_local const std::complex<double>* input_;
   static std::complex<double> GetInput(unsigned int ii, int) {
     return input_[ii];
   }
@@ -51,18 +70,16 @@ class AAFFTInterface : public FFTInterface {
   bool SetImportantParameters();
 };
 
-std::vector<std::complex<double>> AAFFTInterface::input_;
+thread_local const std::complex<double>* AAFFTInterface::input_ = nullptr;
 
 bool AAFFTInterface::InternalSetup() {
   bool is_power_of_2 = (n_ & (n_ - 1)) == 0;
   if (!is_power_of_2) {
     fprintf(stderr, "Currently only power-of-2 signal dimensions are "
-            "supported.\n");
+            "supported. Use sfft1-native or sfft2-native for other n.\n");
     return false;
   }
 
-  input_.resize(n_);
-
   // Parameter setup
 
   //////////////////////////////////////////////////
@@ -105,50 +122,80 @@ bool AAFFTInterface::InternalSetup() {
   return true;
 }
 
-bool AAFFTInterface::SetImportantParameters() {
-  // These parameter settings follow Haitham's choices for the SFFT SODA paper.
+namespace {
+
+// The parameter choices of Haitham for the SFFT SODA paper: k, I, E, S, M.
+const int kAAFFTParameterTable[][5] = {
+  {50, 5, 5, 128, 5},
+  {100, 6, 5, 128, 5},
+  {200, 6, 6, 200, 6},
+  {500, 7, 6, 440, 6},
+  {1000, 8, 7, 640, 7},
+  {2000, 8, 8, 1100, 9},
+  {4000, 8, 8, 2000, 11},
+};
+const size_t kAAFFTParameterTableSize = 7;
+
+}  // namespace
+
+std::vector<TunableParameter> AAFFTInterface::TunableParameters(size_t n,
+                                                                size_t k) {
+  size_t nearest = 0;
+  for (size_t ii = 1; ii < kAAFFTParameterTableSize; ++ii) {
+    double distance = std::fabs(std::log(static_cast<double>(k)
+                                         / kAAFFTParameterTable[ii][0]));
+    double best = std::fabs(std::log(static_cast<double>(k)
+                                     / kAAFFTParameterTable[nearest][0]));
+    if (distance < best) {
+      nearest = ii;
+    }
+  }
+  const int* row = kAAFFTParameterTable[nearest];
+  std::vector<double> sample_points;
+  for (size_t S = 32; S <= 8192 && S <= n; S *= 2) {
+    sample_points.push_back(S);
+  }
+  return {
+    {"I", static_cast<double>(row[1]), {3, 4, 5, 6, 7, 8, 10}},
+    {"E", static_cast<double>(row[2]), {3, 4, 5, 6, 7, 8, 10}},
+    {"S", static_cast<double>(row[3]), sample_points},
+    {"M", static_cast<double>(row[4]), {3, 5, 7, 9, 11, 13}},
+  };
+}
 
+bool AAFFTInterface::SetImportantParameters() {
   // Corresponding to command line variables
   int I, S, M, E;
 
-  if (k_ == 50) {
-    I = 5;
-    E = 5;
-    S = 128;
-    M = 5;
-  } else if (k_ == 100) {
-    I = 6;
-    E = 5;
-    S = 128;
-    M = 5;
-  } else if (k_ == 200) {
-    I = 6;
-    E = 6;
-    S = 200;
-    M = 6;
-  } else if (k_ == 500) {
-    I = 7;
-    E = 6;
-    S = 440;
-    M = 6;
-  } else if (k_ == 1000) {
-    I = 8;
-    E = 7;
-    S = 640;
-    M = 7;
-  } else if (k_ == 2000) {
-    I = 8;
-    E = 8;
-    S = 1100;
-    M = 9;
-  } else if (k_ == 4000) {
-    I = 8;
-    E = 8;
-    S = 2000;
-    M = 11;
+  if (!tuning_.empty()) {
+    std::vector<TunableParameter> space = TunableParameters(n_, k_);
+    if (!CheckTuningParameters(tuning_, space, "aafft")) {
+      return false;
+    }
+    I = GetTuningParameter(tuning_, "I", space[0].initial);
+    E = GetTuningParameter(tuning_, "E", space[1].initial);
+    S = GetTuningParameter(tuning_, "S", space[2].initial);
+    M = GetTuningParameter(tuning_, "M", space[3].initial);
+    if (I < 1 || E < 1 || S < 1 || M < 1) {
+      fprintf(stderr, "Invalid AAFFT parameters.\n");
+      return false;
+    }
   } else {
-    fprintf(stderr, "Unsupported parameters\n");
-    return false;
+    size_t row = 0;
+    while (row < kAAFFTParameterTableSize
+           && static_cast<size_t>(kAAFFTParameterTable[row][0]) != k_) {
+      ++row;
+    }
+    if (row == kAAFFTParameterTableSize) {
+      fprintf(stderr, "Unsupported parameters (no built-in AAFFT parameters "
+                      "for k = %lu). Tune them with tune_parameters and pass "
+                      "the tuning database with --tuning_db.\n", k_);
+      return false;
+    }
+    I = kAAFFTParameterTable[row][1];
+    E = kAAFFTParameterTable[row][2];
+    S = kAAFFTParameterTable[row][3];
+    M = kAAFFTParameterTable[row][4];
   }
 
   // important
@@ -186,28 +233,27 @@ bool AAFFTInterface::Setup() {
   return InternalSetup();
 }
 
-bool AAFFTInterface::RunTrial(const std::vector<std::complex<double>>& input,
-                              std::vector<std::complex<double>>* output,
-                              double* running_time) {
-  if (input.size() != n_) {
-    return false;
-  }
+bool AAFFTInterface::RunTrialSparse(const std::complex<double>* input,
+                                    SparseSignal* output,
+                                    double* running_time) {
   input_ = input;
 
   output_.clear();
 
   DFT_engine tmp_dft_engine(0, 0);
 
+  PerfCounters::StartRegion();
   Timer timer;
   Fast_DFT(params_, GetInput, output_, tmp_dft_engine);
   *running_time = timer.GetElapsedSeconds();
+  PerfCounters::StopRegion();
 
-  output->resize(n_);
-  output->assign(n_, std::complex<double>(0.0, 0.0));
+  output->Clear();
   for (Rep_Term term : output_) {
-    (*output)[term.frequency] = term.coefficient;
+    output->Add(term.frequency, term.coefficient);
   }
-  
+  output->Normalize();
+
   return true;
 }
 
@@ -0,0 +1,203 @@
+#include "binary_output_writer.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "helpers.h"
+
+using std::ostream;
+using std::string;
+using std::vector;
+
+typedef std::complex<double> dcomplex;
+
+// The records are written in the byte order of the machine.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "The binary results format is little-endian.");
+
+namespace {
+
+const char kMagic[] = "SFFTRES1";
+
+template <typename T>
+void Append(T value, string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendStatistics(const SignalStatistics& stats, string* buffer) {
+  Append<uint64_t>(stats.l0, buffer);
+  Append<double>(stats.l1, buffer);
+  Append<double>(stats.l2, buffer);
+  Append<double>(stats.linf, buffer);
+}
+
+// Appends the record header and returns the position of the payload length,
+// which is filled in by FinishRecord.
+size_t StartRecord(uint32_t type, string* buffer) {
+  Append<uint32_t>(type, buffer);
+  size_t length_pos = buffer->size();
+  Append<uint32_t>(0, buffer);
+  return length_pos;
+}
+
+void FinishRecord(size_t length_pos, string* buffer) {
+  uint32_t length = buffer->size() - length_pos - sizeof(uint32_t);
+  memcpy(&((*buffer)[length_pos]), &length, sizeof(length));
+}
+
+}  // namespace
+
+BinaryOutputWriter::BinaryOutputWriter(const string& filename, size_t n,
+                                       size_t k, double l0_epsilon,
+                                       const vector<string>& algorithms)
+    : n_(n), k_(k), l0_epsilon_(l0_epsilon), algorithms_(algorithms) {
+  if (filename.empty()) {
+    out_ = &std::cout;
+    delete_ostream_ = false;
+  } else {
+    out_ = new std::ofstream(filename, std::ios::binary);
+    delete_ostream_ = true;
+  }
+}
+
+bool BinaryOutputWriter::WritePrelude(int argc, char** argv) {
+  std::ostringstream header;
+  header << "{\"command\": \"" << CollapseCommand(argc, argv) << "\", "
+         << "\"n\": " << n_ << ", \"k\": " << k_ << ", "
+         << "\"l0_epsilon\": " << std::scientific << l0_epsilon_ << ", "
+         << "\"algorithms\": [";
+  for (size_t ii = 0; ii < algorithms_.size(); ++ii) {
+    header << (ii == 0 ? "\"" : ", \"") << algorithms_[ii] << "\"";
+  }
+  header << "]}";
+
+  string buffer(kMagic, sizeof(kMagic) - 1);
+  Append<uint32_t>(header.str().size(), &buffer);
+  buffer += header.str();
+  return WriteFormattedInputResult(buffer);
+}
+
+void BinaryOutputWriter::AppendInputRecord(const string& input_name,
+                                           const dcomplex* input_data,
+                                           size_t input_size,
+                                           const ReferenceSummary& reference,
+                                           double reference_time,
+                                           string* buffer) {
+  SignalStatistics input_stats;
+  ComputeSignalStatistics(input_data, input_size, l0_epsilon_, &input_stats);
+  SignalStatistics ref_output_stats;
+  ComputeReferenceStatistics(reference, l0_epsilon_, &ref_output_stats);
+  SignalStatistics best_k_term_stats;
+  SignalStatistics best_k_term_error_stats;
+  ComputeBestKTermStatistics(reference, k_, l0_epsilon_, &best_k_term_stats,
+                             &best_k_term_error_stats);
+
+  size_t length_pos = StartRecord(RECORD_INPUT, buffer);
+  Append<uint32_t>(input_name.size(), buffer);
+  buffer->append(input_name);
+  Append<double>(reference_time, buffer);
+  AppendStatistics(input_stats, buffer);
+  AppendStatistics(ref_output_stats, buffer);
+  AppendStatistics(best_k_term_stats, buffer);
+  AppendStatistics(best_k_term_error_stats, buffer);
+  FinishRecord(length_pos, buffer);
+}
+
+void BinaryOutputWriter::AppendAlgorithmRecords(size_t algorithm_index,
+    const vector<RunResult>& results,
+    const TimingStatistics& timing,
+    string* buffer) {
+  for (size_t ii = 0; ii < results.size(); ++ii) {
+    const RunResult& result = results[ii];
+    size_t length_pos = StartRecord(RECORD_TRIAL, buffer);
+    Append<uint32_t>(algorithm_index, buffer);
+    Append<uint32_t>((result.perf_counters.valid ? 1 : 0)
+                     | (result.phase_times.valid ? 2 : 0), buffer);
+    Append<double>(result.time, buffer);
+    AppendStatistics(result.error_statistics, buffer);
+    AppendStatistics(result.topk_error_statistics, buffer);
+    AppendStatistics(result.output_statistics, buffer);
+    const PerfCounterValues& perf = result.perf_counters;
+    Append<double>(perf.valid ? perf.running_fraction : 0.0, buffer);
+    for (int event = 0; event < NUM_PERF_EVENTS; ++event) {
+      Append<int64_t>(perf.valid ? perf.counts[event] : -1, buffer);
+    }
+    for (int phase = 0; phase < NUM_PHASES; ++phase) {
+      Append<double>(result.phase_times.valid
+                     ? result.phase_times.times[phase] : 0.0, buffer);
+    }
+    FinishRecord(length_pos, buffer);
+  }
+
+  size_t length_pos = StartRecord(RECORD_TIMING, buffer);
+  Append<uint32_t>(algorithm_index, buffer);
+  Append<uint32_t>(0, buffer);
+  Append<uint64_t>(timing.num_warmup_runs, buffer);
+  Append<uint64_t>(timing.num_samples, buffer);
+  Append<uint64_t>(timing.num_outliers, buffer);
+  Append<double>(timing.median, buffer);
+  Append<double>(timing.p5, buffer);
+  Append<double>(timing.p95, buffer);
+  Append<double>(timing.mad, buffer);
+  Append<double>(timing.mean_without_outliers, buffer);
+  Append<double>(timing.median_ci_low, buffer);
+  Append<double>(timing.median_ci_high, buffer);
+  FinishRecord(length_pos, buffer);
+}
+
+bool BinaryOutputWriter::WriteInputResult(const string& input_name,
+                                          const dcomplex* input_data,
+                                          size_t input_size,
+                                          const ReferenceSummary& reference,
+                                          double reference_time,
+                                          const vector<RunResult>& results,
+                                          const TimingStatistics& timing,
+                                          bool /* is_last */) {
+  string buffer;
+  AppendInputRecord(input_name, input_data, input_size, reference,
+                    reference_time, &buffer);
+  AppendAlgorithmRecords(0, results, timing, &buffer);
+  return WriteFormattedInputResult(buffer);
+}
+
+bool BinaryOutputWriter::WriteInputResults(const string& input_name,
+    const dcomplex* input_data,
+    size_t input_size,
+    const ReferenceSummary& reference,
+    double reference_time,
+    const vector<string>& algorithms,
+    const vector<vector<RunResult>>& results,
+    const vector<TimingStatistics>& timing,
+    bool /* is_last */) {
+  string buffer;
+  AppendInputRecord(input_name, input_data, input_size, reference,
+                    reference_time, &buffer);
+  for (size_t ii = 0; ii < algorithms.size(); ++ii) {
+    AppendAlgorithmRecords(ii, results[ii], timing[ii], &buffer);
+  }
+  return WriteFormattedInputResult(buffer);
+}
+
+bool BinaryOutputWriter::WriteFormattedInputResult(const string& formatted) {
+  ostream& oref = *out_;
+  if (!oref.good()) {
+    return false;
+  }
+  oref.write(formatted.data(), formatted.size());
+  oref.flush();
+  return oref.good();
+}
+
+bool BinaryOutputWriter::WriteEnd() {
+  ostream& oref = *out_;
+  oref.flush();
+  return oref.good();
+}
+
+BinaryOutputWriter::~BinaryOutputWriter() {
+  if (delete_ostream_) {
+    delete out_;
+  }
+}
@@ -0,0 +1,100 @@
+#ifndef __BINARY_OUTPUT_WRITER_H__
+#define __BINARY_OUTPUT_WRITER_H__
+
+#include <complex>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "result_helpers.h"
+#include "results_writer.h"
+#include "timing_statistics.h"
+
+// Binary results format (see experiments/binary_results.py for a reader).
+// All numbers are little-endian.
+//
+// The file starts with the magic bytes "SFFTRES1", a uint32 header length,
+// and a JSON header of this length with the command, n, k, l0_epsilon, and
+// the list of algorithms. It is followed by records, each consisting of a
+// uint32 record type, a uint32 payload length, and the payload:
+//
+//  - INPUT: uint32 name length, the input name, the reference time (double),
+//    and the input, reference output, best k-term, and best k-term error
+//    statistics. Statistics are stored as uint64 l0 and double l1, l2, linf.
+//  - TRIAL (fixed size): uint32 algorithm index, uint32 flags (bit 0: perf
+//    counters valid, bit 1: phase times valid), the running time, the error,
+//    top-k error, and output statistics, the perf counter running fraction
+//    (double) and counts (int64, -1 if unsupported), and the phase times.
+//  - TIMING (fixed size): uint32 algorithm index, uint32 padding,
+//    num_warmup_runs, num_samples, num_outliers (uint64), median, p5, p95,
+//    mad, mean_without_outliers, median_ci_low, median_ci_high (double).
+//
+// TRIAL and TIMING records belong to the preceding INPUT record. The records
+// of an input are appended with one buffered write, so a reader can process
+// a file that is still being written by ignoring an incomplete last record.
+class BinaryOutputWriter : public ResultsWriter {
+ public:
+  enum RecordType {
+    RECORD_INPUT = 1,
+    RECORD_TRIAL = 2,
+    RECORD_TIMING = 3,
+  };
+
+  BinaryOutputWriter(std::ostream* out, size_t n, size_t k, double l0_epsilon,
+                     const std::vector<std::string>& algorithms)
+      : out_(out), delete_ostream_(false), n_(n), k_(k),
+        l0_epsilon_(l0_epsilon), algorithms_(algorithms) {}
+
+  // Writes to stdout if filename is empty.
+  BinaryOutputWriter(const std::string& filename, size_t n, size_t k,
+                     double l0_epsilon,
+                     const std::vector<std::string>& algorithms);
+
+  ~BinaryOutputWriter();
+
+  bool WritePrelude(int argc, char** argv);
+
+  bool WriteInputResult(const std::string& input_name,
+                        const std::complex<double>* input_data,
+                        size_t input_size,
+                        const ReferenceSummary& reference,
+                        double reference_time,
+                        const std::vector<RunResult>& results,
+                        const TimingStatistics& timing,
+                        bool is_last);
+
+  bool WriteInputResults(const std::string& input_name,
+                         const std::complex<double>* input_data,
+                         size_t input_size,
+                         const ReferenceSummary& reference,
+                         double reference_time,
+                         const std::vector<std::string>& algorithms,
+                         const std::vector<std::vector<RunResult>>& results,
+                         const std::vector<TimingStatistics>& timing,
+                         bool is_last);
+
+  bool WriteFormattedInputResult(const std::string& formatted);
+
+  bool WriteEnd();
+
+ private:
+  std::ostream* out_;
+  bool delete_ostream_;
+  size_t n_;
+  size_t k_;
+  double l0_epsilon_;
+  std::vector<std::string> algorithms_;
+
+  void AppendInputRecord(const std::string& input_name,
+                         const std::complex<double>* input_data,
+                         size_t input_size,
+                         const ReferenceSummary& reference,
+                         double reference_time,
+                         std::string* buffer);
+  void AppendAlgorithmRecords(size_t algorithm_index,
+                              const std::vector<RunResult>& results,
+                              const TimingStatistics& timing,
+                              std::string* buffer);
+};
+
+#endif
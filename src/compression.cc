@@ -0,0 +1,181 @@
+#include "compression.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kHashBits = 14;
+const size_t kMaxOffset = 65535;
+const size_t kMinMatch = 4;
+// End conditions of the LZ4 block format: the last kLastLiterals bytes are
+// always literals, and no match starts in the last kMatchLimit bytes.
+const size_t kLastLiterals = 5;
+const size_t kMatchLimit = 12;
+// Number of consecutive misses after which the step size of the match search
+// grows by one (2^kSkipShift). Incompressible data is skipped quickly.
+const int kSkipShift = 5;
+
+uint32_t Read32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - kHashBits);
+}
+
+uint8_t* WriteLength(size_t length, uint8_t* op) {
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+uint8_t* WriteLiterals(const uint8_t* literals, size_t num_literals,
+                       size_t match_code, uint8_t* op) {
+  uint8_t literal_code = num_literals < 15 ? num_literals : 15;
+  *op++ = (literal_code << 4) | (match_code < 15 ? match_code : 15);
+  if (num_literals >= 15) {
+    op = WriteLength(num_literals - 15, op);
+  }
+  memcpy(op, literals, num_literals);
+  return op + num_literals;
+}
+
+// Reads an extended length (a sequence of bytes ending with a byte below
+// 255). Returns false if the input ends first.
+bool ReadLength(const uint8_t** ip, const uint8_t* end, size_t* length) {
+  uint8_t value;
+  do {
+    if (*ip >= end) {
+      return false;
+    }
+    value = *(*ip)++;
+    *length += value;
+  } while (value == 255);
+  return true;
+}
+
+}  // namespace
+
+void ByteShuffle(const uint8_t* in, size_t count, size_t element_size,
+                 uint8_t* out) {
+  for (size_t b = 0; b < element_size; ++b) {
+    uint8_t* plane = out + b * count;
+    for (size_t ii = 0; ii < count; ++ii) {
+      plane[ii] = in[ii * element_size + b];
+    }
+  }
+}
+
+void ByteUnshuffle(const uint8_t* in, size_t count, size_t element_size,
+                   uint8_t* out) {
+  for (size_t b = 0; b < element_size; ++b) {
+    const uint8_t* plane = in + b * count;
+    for (size_t ii = 0; ii < count; ++ii) {
+      out[ii * element_size + b] = plane[ii];
+    }
+  }
+}
+
+size_t LZCompressBound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+size_t LZCompress(const uint8_t* in, size_t size, uint8_t* out) {
+  uint8_t* op = out;
+  size_t anchor = 0;
+  if (size > kMatchLimit) {
+    std::vector<uint32_t> table(1 << kHashBits, 0);
+    size_t match_limit = size - kMatchLimit;
+    size_t extend_limit = size - kLastLiterals;
+    size_t ip = 0;
+    size_t misses = 0;
+    while (ip < match_limit) {
+      uint32_t sequence = Read32(in + ip);
+      uint32_t hash = Hash(sequence);
+      size_t candidate = table[hash];
+      table[hash] = ip;
+      if (candidate >= ip || ip - candidate > kMaxOffset
+          || Read32(in + candidate) != sequence) {
+        ip += 1 + (misses++ >> kSkipShift);
+        continue;
+      }
+      misses = 0;
+
+      size_t length = kMinMatch;
+      while (ip + length < extend_limit
+             && in[candidate + length] == in[ip + length]) {
+        ++length;
+      }
+      size_t match_code = length - kMinMatch;
+      op = WriteLiterals(in + anchor, ip - anchor, match_code, op);
+      size_t offset = ip - candidate;
+      *op++ = offset & 0xff;
+      *op++ = offset >> 8;
+      if (match_code >= 15) {
+        op = WriteLength(match_code - 15, op);
+      }
+      ip += length;
+      anchor = ip;
+    }
+  }
+  op = WriteLiterals(in + anchor, size - anchor, 0, op);
+  return op - out;
+}
+
+bool LZDecompress(const uint8_t* in, size_t in_size, uint8_t* out,
+                  size_t out_size) {
+  const uint8_t* ip = in;
+  const uint8_t* in_end = in + in_size;
+  uint8_t* op = out;
+  uint8_t* out_end = out + out_size;
+  while (ip < in_end) {
+    uint8_t token = *ip++;
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !ReadLength(&ip, in_end, &num_literals)) {
+      return false;
+    }
+    if (num_literals > static_cast<size_t>(in_end - ip)
+        || num_literals > static_cast<size_t>(out_end - op)) {
+      return false;
+    }
+    memcpy(op, ip, num_literals);
+    ip += num_literals;
+    op += num_literals;
+    if (ip == in_end) {
+      // The last sequence has no match.
+      break;
+    }
+
+    if (in_end - ip < 2) {
+      return false;
+    }
+    size_t offset = ip[0] | (ip[1] << 8);
+    ip += 2;
+    size_t length = token & 15;
+    if (length == 15 && !ReadLength(&ip, in_end, &length)) {
+      return false;
+    }
+    length += kMinMatch;
+    if (offset == 0 || offset > static_cast<size_t>(op - out)
+        || length > static_cast<size_t>(out_end - op)) {
+      return false;
+    }
+    const uint8_t* match = op - offset;
+    if (offset >= length) {
+      memcpy(op, match, length);
+      op += length;
+    } else {
+      // Overlapping match (a repeated pattern).
+      for (size_t ii = 0; ii < length; ++ii) {
+        *op++ = match[ii];
+      }
+    }
+  }
+  return op == out_end;
+}
@@ -0,0 +1,33 @@
+#ifndef __COMPRESSION_H__
+#define __COMPRESSION_H__
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte shuffle: stores byte b of each of the count elements of element_size
+// bytes in a contiguous plane (out[b * count + i] = in[i * element_size + b]).
+// For floating point data, the planes with the sign and exponent bytes are
+// much more compressible than the interleaved data.
+void ByteShuffle(const uint8_t* in, size_t count, size_t element_size,
+                 uint8_t* out);
+void ByteUnshuffle(const uint8_t* in, size_t count, size_t element_size,
+                   uint8_t* out);
+
+// Fast LZ77 compression in the LZ4 block format: a sequence of tokens, each
+// with a number of literal bytes followed by a match (2-byte offset into the
+// last 64 KB of output, length at least 4). Compression is greedy with a
+// single hash table lookup per position; decompression is a simple copy loop.
+
+// Upper bound of the compressed size of size bytes.
+size_t LZCompressBound(size_t size);
+
+// Compresses in into out, which must have room for LZCompressBound(size)
+// bytes. Returns the compressed size.
+size_t LZCompress(const uint8_t* in, size_t size, uint8_t* out);
+
+// Decompresses exactly out_size bytes. Returns false if in is not a valid
+// compressed block of this size (never reads or writes out of bounds).
+bool LZDecompress(const uint8_t* in, size_t in_size, uint8_t* out,
+                  size_t out_size);
+
+#endif
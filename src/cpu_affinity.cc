@@ -0,0 +1,85 @@
+#include "cpu_affinity.h"
+
+#include <cstdio>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <utility>
+
+#include <omp.h>
+#include <sched.h>
+
+namespace {
+
+// Reads a single integer from a sysfs file. Returns -1 on failure.
+int ReadTopologyValue(int cpu, const char* name) {
+  std::ostringstream filename;
+  filename << "/sys/devices/system/cpu/cpu" << cpu << "/topology/" << name;
+  std::ifstream in(filename.str());
+  int value = -1;
+  if (!(in >> value)) {
+    return -1;
+  }
+  return value;
+}
+
+}  // namespace
+
+bool GetAllowedCPUs(bool one_per_core, std::vector<int>* cpus) {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    fprintf(stderr, "Could not get the CPU affinity mask.\n");
+    return false;
+  }
+  cpus->clear();
+  // Physical cores as (package id, core id) pairs.
+  std::set<std::pair<int, int>> used_cores;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (!CPU_ISSET(cpu, &allowed)) {
+      continue;
+    }
+    if (one_per_core) {
+      int package = ReadTopologyValue(cpu, "physical_package_id");
+      int core = ReadTopologyValue(cpu, "core_id");
+      // Without topology information, every CPU counts as its own core.
+      if (core >= 0
+          && !used_cores.insert(std::make_pair(package, core)).second) {
+        continue;
+      }
+    }
+    cpus->push_back(cpu);
+  }
+  return !cpus->empty();
+}
+
+bool PinCurrentThread(int cpu) {
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(cpu, &cpu_set);
+  return sched_setaffinity(0, sizeof(cpu_set), &cpu_set) == 0;
+}
+
+bool PinOpenMPThreads(size_t num_threads) {
+  std::vector<int> cpus;
+  if (!GetAllowedCPUs(false, &cpus)) {
+    return false;
+  }
+  if (cpus.size() < num_threads) {
+    fprintf(stderr, "Warning: %lu threads share %lu CPUs.\n", num_threads,
+        cpus.size());
+  }
+
+  int num_failures = 0;
+  #pragma omp parallel num_threads(num_threads) reduction(+:num_failures)
+  {
+    if (!PinCurrentThread(cpus[omp_get_thread_num() % cpus.size()])) {
+      ++num_failures;
+    }
+  }
+  if (num_failures > 0) {
+    fprintf(stderr, "Could not pin %d threads.\n", num_failures);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,23 @@
+#ifndef __CPU_AFFINITY_H__
+#define __CPU_AFFINITY_H__
+
+#include <cstddef>
+#include <vector>
+
+// Returns the CPUs in the current affinity mask of the process (so the result
+// respects taskset / numactl). If one_per_core is true, only the first logical
+// CPU of each physical core is returned, so that threads pinned to the
+// returned CPUs do not share a core via SMT.
+bool GetAllowedCPUs(bool one_per_core, std::vector<int>* cpus);
+
+// Pins the calling thread to the given CPU.
+bool PinCurrentThread(int cpu);
+
+// Pins the first num_threads OpenMP threads (including the calling thread,
+// which is OpenMP thread 0) to one CPU each. Thread i is pinned to the i-th
+// allowed CPU. The pinning only applies to OpenMP teams of at most
+// num_threads threads, which the OpenMP runtime reuses for later parallel
+// regions.
+bool PinOpenMPThreads(size_t num_threads);
+
+#endif
@@ -4,12 +4,63 @@
 #include <complex>
 #include <vector>
 
+#include "phase_timing.h"
+#include "sparse_signal.h"
+
+// FFT implementations either produce a dense output (RunTrial) or, for the
+// sparse FFT algorithms, a list of (frequency, coefficient) pairs
+// (RunTrialSparse). An implementation overrides the method matching
+// HasSparseOutput(). FFTWrapper converts between the two output types.
 class FFTInterface {
  public:
   virtual bool Setup() = 0;
-  virtual bool RunTrial(const std::vector<std::complex<double> >& input,
-                        std::vector<std::complex<double> >* output,
-                        double* running_time) = 0;
+
+  virtual bool HasSparseOutput() const {
+    return false;
+  }
+
+  // The input points to n complex numbers (n is given at construction time).
+  // It is read-only and may be backed by a memory-mapped file.
+  virtual bool RunTrial(const std::complex<double>* /* input */,
+                        std::vector<std::complex<double> >* /* output */,
+                        double* /* running_time */) {
+    return false;
+  }
+
+  // Implementations that compute in single precision take their input as
+  // complex floats (UsesFloatInput() is true) and override this RunTrial
+  // instead. The output is still returned in double precision, so that the
+  // error statistics are computed in the same way for all implementations.
+  virtual bool UsesFloatInput() const {
+    return false;
+  }
+
+  virtual bool RunTrial(const std::complex<float>* /* input */,
+                        std::vector<std::complex<double> >* /* output */,
+                        double* /* running_time */) {
+    return false;
+  }
+
+  // Same as RunTrial, but the output is sparse. The output is normalized
+  // (see SparseSignal::Normalize).
+  virtual bool RunTrialSparse(const std::complex<double>* /* input */,
+                              SparseSignal* /* output */,
+                              double* /* running_time */) {
+    return false;
+  }
+
+  // Enables or disables the per-phase timers of the sparse FFT algorithms
+  // for the following trials. Returns false if the implementation has no
+  // phase timers. The timers can add overhead to the running time.
+  virtual bool SetPhaseTiming(bool /* enabled */) {
+    return false;
+  }
+
+  // Phase times of the last trial. Returns false if they are not available.
+  virtual bool GetLastPhaseTimes(PhaseTimes* /* times */) const {
+    return false;
+  }
+
   virtual ~FFTInterface() {}
 };
 
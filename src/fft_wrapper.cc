@@ -4,23 +4,70 @@
 #include "fftw_interface.h"
 #include "sfft_eth_interface.h"
 #include "sfft_mit_interface.h"
+#include "sfft2d_native_interface.h"
+#include "sfft_native_interface.h"
+
+namespace {
+
+const struct {
+  const char* name;
+  FFTWrapper::Type type;
+} kTypeNames[] = {
+  {"aafft", FFTWrapper::Type::AAFFT},
+  {"fftw", FFTWrapper::Type::FFTW},
+  {"fftw-mt", FFTWrapper::Type::FFTW_MT},
+  {"fftwf", FFTWrapper::Type::FFTWF},
+  {"fftwf-mt", FFTWrapper::Type::FFTWF_MT},
+  {"sfft1-eth", FFTWrapper::Type::SFFT1_ETH},
+  {"sfft1-mit", FFTWrapper::Type::SFFT1_MIT},
+  {"sfft1-native", FFTWrapper::Type::SFFT1_NATIVE},
+  {"sfft2-eth", FFTWrapper::Type::SFFT2_ETH},
+  {"sfft2-mit", FFTWrapper::Type::SFFT2_MIT},
+  {"sfft2-native", FFTWrapper::Type::SFFT2_NATIVE},
+  {"sfft2d-native", FFTWrapper::Type::SFFT2D_NATIVE},
+  {"sfft3-eth", FFTWrapper::Type::SFFT3_ETH},
+};
+
+}  // namespace
 
 bool FFTWrapper::ParseType(const std::string& str, Type* type) {
   string lower = boost::algorithm::to_lower_copy(str);
-  if (lower == "aafft") {
-    *type = Type::AAFFT;
-  } else if (lower == "fftw") {
-    *type = Type::FFTW;
-  } else if (lower == "sfft1-eth") {
-    *type = Type::SFFT1_ETH;
-  } else if (lower == "sfft1-mit") {
-    *type = Type::SFFT1_MIT;
-  } else if (lower == "sfft2-eth") {
-    *type = Type::SFFT2_ETH;
-  } else if (lower == "sfft2-mit") {
-    *type = Type::SFFT2_MIT;
-  } else if (lower == "sfft3-eth") {
-    *type = Type::SFFT3_ETH;
+  for (auto entry : kTypeNames) {
+    if (lower == entry.name) {
+      *type = entry.type;
+      return true;
+    }
+  }
+  return false;
+}
+
+std::string FFTWrapper::TypeName(Type type) {
+  for (auto entry : kTypeNames) {
+    if (type == entry.type) {
+      return entry.name;
+    }
+  }
+  return "";
+}
+
+bool FFTWrapper::GetTunableParameters(Type type, size_t n, size_t k,
+                                      std::vector<TunableParameter>* space) {
+  if (type == Type::AAFFT) {
+    *space = AAFFTInterface::TunableParameters(n, k);
+  } else if (type == Type::SFFT1_MIT) {
+    *space = SFFTMITInterface::TunableParameters(n, k,
+        SFFTMITInterface::Version::SFFT_1);
+  } else if (type == Type::SFFT2_MIT) {
+    *space = SFFTMITInterface::TunableParameters(n, k,
+        SFFTMITInterface::Version::SFFT_2);
+  } else if (type == Type::SFFT1_NATIVE) {
+    *space = SFFTNativeInterface::TunableParameters(n, k,
+        SFFTNativeInterface::Version::SFFT_1);
+  } else if (type == Type::SFFT2_NATIVE) {
+    *space = SFFTNativeInterface::TunableParameters(n, k,
+        SFFTNativeInterface::Version::SFFT_2);
+  } else if (type == Type::SFFT2D_NATIVE) {
+    *space = SFFT2DNativeInterface::TunableParameters(n, k);
   } else {
     return false;
   }
@@ -28,23 +75,82 @@ bool FFTWrapper::ParseType(const std::string& str, Type* type) {
 }
 
 bool FFTWrapper::Setup() {
+  size_t rows = planning_options_.rows;
+  if (rows == 0 || n_ % rows != 0) {
+    fprintf(stderr, "The number of rows (%lu) must divide n (%lu).\n", rows,
+            n_);
+    return false;
+  }
+  bool supports_2d = (type_ == Type::FFTW || type_ == Type::FFTW_MT
+                      || type_ == Type::FFTWF || type_ == Type::FFTWF_MT
+                      || type_ == Type::SFFT2D_NATIVE);
+  if (rows > 1 && !supports_2d) {
+    fprintf(stderr, "Algorithm %s does not support 2D signals.\n",
+            TypeName(type_).c_str());
+    return false;
+  }
+  if (rows == 1 && type_ == Type::SFFT2D_NATIVE) {
+    fprintf(stderr, "Algorithm sfft2d-native requires 2D signals (rows > "
+                    "1).\n");
+    return false;
+  }
+
+  TuningParameters parameters = planning_options_.parameters;
+  if (parameters.empty() && !planning_options_.tuning_database.empty()) {
+    TuningDatabase database;
+    if (!database.Load(planning_options_.tuning_database)) {
+      return false;
+    }
+    database.Lookup(TypeName(type_), n_, rows, k_, &parameters);
+  }
+  std::vector<TunableParameter> space;
+  if (!parameters.empty() && !GetTunableParameters(type_, n_, k_, &space)) {
+    fprintf(stderr, "Algorithm %s has no tunable parameters.\n",
+            TypeName(type_).c_str());
+    return false;
+  }
+
   if (type_ == Type::AAFFT) {
-    fft_.reset(new AAFFTInterface(n_, k_));
+    fft_.reset(new AAFFTInterface(n_, k_, parameters));
   } else if (type_ == Type::FFTW) {
-    fft_.reset(new FFTWInterface(n_, true));
+    fft_.reset(new FFTWInterface(n_, planning_options_.fftw_flags, 1, rows));
+  } else if (type_ == Type::FFTW_MT) {
+    fft_.reset(new FFTWInterface(n_, planning_options_.fftw_flags,
+                                 planning_options_.fftw_threads, rows));
+  } else if (type_ == Type::FFTWF) {
+    fft_.reset(new FFTWFInterface(n_, planning_options_.fftw_flags, 1,
+                                  rows));
+  } else if (type_ == Type::FFTWF_MT) {
+    fft_.reset(new FFTWFInterface(n_, planning_options_.fftw_flags,
+                                  planning_options_.fftw_threads, rows));
   } else if (type_ == Type::SFFT1_ETH) {
     fft_.reset(new SFFTETHInterface(n_, k_, SFFTETHInterface::Version::SFFT_1,
-          false));
+          planning_options_.sfft_eth_measure));
   } else if (type_ == Type::SFFT1_MIT) {
-    fft_.reset(new SFFTMITInterface(n_, k_, SFFTMITInterface::Version::SFFT_1));
+    fft_.reset(new SFFTMITInterface(n_, k_, SFFTMITInterface::Version::SFFT_1,
+                                    parameters,
+                                    planning_options_.filter_cache_dir));
+  } else if (type_ == Type::SFFT1_NATIVE) {
+    fft_.reset(new SFFTNativeInterface(n_, k_,
+          SFFTNativeInterface::Version::SFFT_1, planning_options_.fftw_flags,
+          parameters));
   } else if (type_ == Type::SFFT2_ETH) {
     fft_.reset(new SFFTETHInterface(n_, k_, SFFTETHInterface::Version::SFFT_2,
-          false));
+          planning_options_.sfft_eth_measure));
   } else if (type_ == Type::SFFT2_MIT) {
-    fft_.reset(new SFFTMITInterface(n_, k_, SFFTMITInterface::Version::SFFT_2));
+    fft_.reset(new SFFTMITInterface(n_, k_, SFFTMITInterface::Version::SFFT_2,
+                                    parameters,
+                                    planning_options_.filter_cache_dir));
+  } else if (type_ == Type::SFFT2_NATIVE) {
+    fft_.reset(new SFFTNativeInterface(n_, k_,
+          SFFTNativeInterface::Version::SFFT_2, planning_options_.fftw_flags,
+          parameters));
+  } else if (type_ == Type::SFFT2D_NATIVE) {
+    fft_.reset(new SFFT2DNativeInterface(rows, n_ / rows, k_,
+          planning_options_.fftw_flags, parameters));
   } else if (type_ == Type::SFFT3_ETH) {
     fft_.reset(new SFFTETHInterface(n_, k_, SFFTETHInterface::Version::SFFT_3,
-          false));
+          planning_options_.sfft_eth_measure));
   } else {
     fprintf(stderr, "Unknown FFT type.\n");
     return false;
@@ -58,25 +164,120 @@ bool FFTWrapper::Setup() {
   return true;
 }
 
-bool FFTWrapper::RunTrial(const std::vector<std::complex<double>>& input,
+bool FFTWrapper::HasSparseOutput() const {
+  return fft_->HasSparseOutput();
+}
+
+bool FFTWrapper::UsesFloatInput() const {
+  return fft_->UsesFloatInput();
+}
+
+bool FFTWrapper::SetPhaseTiming(bool enabled) {
+  return fft_->SetPhaseTiming(enabled);
+}
+
+void FFTWrapper::GetLastPhaseTimes(PhaseTimes* times) const {
+  if (!fft_->GetLastPhaseTimes(times)) {
+    times->valid = false;
+  }
+}
+
+bool FFTWrapper::RunTrial(const std::complex<double>* input,
+    size_t input_size,
     std::vector<std::complex<double>>* output,
     double* time) {
-  if (input.size() != n_) {
+  if (input_size != n_) {
     fprintf(stderr, "Error, input size does not match n_: %lu vs %lu\n",
-        input.size(), n_);
+        input_size, n_);
     return false;
   }
+  if (fft_->UsesFloatInput()) {
+    // Convert outside of the timed region.
+    float_input_.resize(n_);
+    for (size_t ii = 0; ii < n_; ++ii) {
+      float_input_[ii] = std::complex<float>(input[ii]);
+    }
+    return RunTrial(float_input_.data(), input_size, output, time);
+  }
+  if (fft_->HasSparseOutput()) {
+    SparseSignal sparse_output;
+    if (!RunTrialSparse(input, input_size, &sparse_output, time)) {
+      return false;
+    }
+    sparse_output.ToDense(n_, output);
+    return true;
+  }
   if (!fft_->RunTrial(input, output, time)) {
     fprintf(stderr, "Error while running internal FFT implementation.");
     return false;
   }
-  if (output->size() != input.size()) {
+  if (output->size() != input_size) {
     fprintf(stderr, "Dimension of output produced by the interal FFT "
         "implementation does not match the input dimension: "
         "%lu vs %lu (output vs input).",
         output->size(),
-        input.size());
+        input_size);
     return false;
   }
   return true;
 }
+
+bool FFTWrapper::RunTrial(const std::complex<float>* input,
+    size_t input_size,
+    std::vector<std::complex<double>>* output,
+    double* time) {
+  if (input_size != n_) {
+    fprintf(stderr, "Error, input size does not match n_: %lu vs %lu\n",
+        input_size, n_);
+    return false;
+  }
+  if (!fft_->RunTrial(input, output, time)) {
+    fprintf(stderr, "Error while running internal FFT implementation.");
+    return false;
+  }
+  if (output->size() != input_size) {
+    fprintf(stderr, "Dimension of output produced by the interal FFT "
+        "implementation does not match the input dimension: "
+        "%lu vs %lu (output vs input).",
+        output->size(),
+        input_size);
+    return false;
+  }
+  return true;
+}
+
+bool FFTWrapper::RunTrialSparse(const std::complex<double>* input,
+    size_t input_size,
+    SparseSignal* output,
+    double* time) {
+  if (input_size != n_) {
+    fprintf(stderr, "Error, input size does not match n_: %lu vs %lu\n",
+        input_size, n_);
+    return false;
+  }
+  if (!fft_->HasSparseOutput()) {
+    std::vector<std::complex<double>> dense_output;
+    if (!RunTrial(input, input_size, &dense_output, time)) {
+      return false;
+    }
+    output->Clear();
+    for (size_t ii = 0; ii < n_; ++ii) {
+      if (dense_output[ii] != std::complex<double>(0.0, 0.0)) {
+        output->Add(ii, dense_output[ii]);
+      }
+    }
+    return true;
+  }
+  if (!fft_->RunTrialSparse(input, output, time)) {
+    fprintf(stderr, "Error while running internal FFT implementation.");
+    return false;
+  }
+  for (size_t ii = 0; ii < output->size(); ++ii) {
+    if (output->indices[ii] >= n_) {
+      fprintf(stderr, "Frequency produced by the internal FFT implementation "
+          "is out of range: %lu (n = %lu).", output->indices[ii], n_);
+      return false;
+    }
+  }
+  return true;
+}
@@ -7,36 +7,113 @@
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
+#include <fftw3.h>
 
 #include "fft_interface.h"
+#include "tuning_database.h"
 
 class FFTWrapper {
  public:
   enum class Type {
       AAFFT,
       FFTW,
+      FFTW_MT,
+      FFTWF,
+      FFTWF_MT,
       SFFT1_ETH,
       SFFT1_MIT,
+      SFFT1_NATIVE,
       SFFT2_ETH,
       SFFT2_MIT,
+      SFFT2_NATIVE,
+      SFFT2D_NATIVE,
       SFFT3_ETH,
   };
 
+  // Planning options of the backends that use FFTW internally.
+  struct PlanningOptions {
+    PlanningOptions() : fftw_flags(FFTW_MEASURE), fftw_threads(1),
+        sfft_eth_measure(false), rows(1) {}
+
+    // Planner flags of the FFTW backends and of the bucket FFTs of the
+    // native sparse FFT backends.
+    unsigned int fftw_flags;
+    // Number of threads of the multithreaded FFTW backends (FFTW_MT,
+    // FFTWF_MT).
+    size_t fftw_threads;
+    // Use FFTW_MEASURE (instead of FFTW_ESTIMATE) for the plans of the
+    // SFFT-ETH backends.
+    bool sfft_eth_measure;
+    // Parameters of the sparse backends (see GetTunableParameters). If empty,
+    // the parameters are looked up in the tuning database (if given), and
+    // the built-in defaults are used otherwise.
+    TuningParameters parameters;
+    // File name of the tuning database written by tune_parameters, or "".
+    std::string tuning_database;
+    // Directory of the filter cache of the SFFT-MIT backends, or "".
+    std::string filter_cache_dir;
+    // With rows > 1, signals are rows x (n / rows) arrays in row-major order
+    // and the backends compute 2D DFTs. Only the FFTW backends and
+    // SFFT2D_NATIVE (which requires rows > 1) support this.
+    size_t rows;
+  };
+
   static bool ParseType(const std::string& str, Type* type);
 
+  // The name accepted by ParseType (also the key in the tuning database).
+  static std::string TypeName(Type type);
+
+  // The parameter space of the auto-tuner for the backend. Returns false if
+  // the backend has no tunable parameters.
+  static bool GetTunableParameters(Type type, size_t n, size_t k,
+                                   std::vector<TunableParameter>* space);
+
   FFTWrapper(size_t n, size_t k, Type type) : n_(n), k_(k), type_(type) { };
 
+  FFTWrapper(size_t n, size_t k, Type type, const PlanningOptions& options)
+      : n_(n), k_(k), type_(type), planning_options_(options) { };
+
   bool Setup();
 
-  bool RunTrial(const std::vector<std::complex<double>>& input,
+  // True if the underlying implementation produces a sparse output. For
+  // these implementations, RunTrialSparse avoids materializing a dense
+  // n-vector.
+  bool HasSparseOutput() const;
+
+  bool RunTrial(const std::complex<double>* input,
+                size_t input_size,
                 std::vector<std::complex<double>>* output,
                 double* time);
 
+  // True if the implementation computes in single precision. It then should
+  // be called with complex float input; double input is converted before
+  // each trial (not included in the running time).
+  bool UsesFloatInput() const;
+
+  bool RunTrial(const std::complex<float>* input,
+                size_t input_size,
+                std::vector<std::complex<double>>* output,
+                double* time);
+
+  bool RunTrialSparse(const std::complex<double>* input,
+                      size_t input_size,
+                      SparseSignal* output,
+                      double* time);
+
+  // See FFTInterface::SetPhaseTiming.
+  bool SetPhaseTiming(bool enabled);
+
+  // Sets times->valid to false if no phase times are available.
+  void GetLastPhaseTimes(PhaseTimes* times) const;
+
  private:
   size_t n_;
   size_t k_;
   Type type_;
+  PlanningOptions planning_options_;
   std::unique_ptr<FFTInterface> fft_;
+  // Buffer for converting double input for single precision implementations.
+  std::vector<std::complex<float>> float_input_;
 };
 
 #endif
@@ -1,28 +1,61 @@
 #ifndef __FFTW_INTERFACE_H__
 #define __FFTW_INTERFACE_H__
 
-#include <fftw3.h>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
 
 #include "fft_interface.h"
+#include "fftw_traits.h"
+#include "perf_counters.h"
 #include "timer.h"
 
-class FFTWInterface : public FFTInterface {
+// FFTW backend in double (Real = double) or single precision (Real = float).
+// The single precision backend takes complex float input, so it reads half as
+// much memory as the double precision backend.
+template <typename Real>
+class BasicFFTWInterface : public FFTInterface {
  public:
-  FFTWInterface(size_t n,
-                bool measure) : n_(n), measure_(measure) {};
+  typedef FFTWTraits<Real> FFTW;
+
+  // planning_flags is the FFTW planner rigor (FFTW_ESTIMATE, FFTW_MEASURE,
+  // ...). With num_threads > 1, the plan is multithreaded. With rows > 1, the
+  // input is a rows x (n / rows) array in row-major order and the backend
+  // computes its 2D DFT.
+  BasicFFTWInterface(size_t n, unsigned int planning_flags,
+                     size_t num_threads, size_t rows = 1)
+      : n_(n), rows_(rows), input_(nullptr), output_(nullptr),
+        plan_(nullptr), planning_flags_(planning_flags),
+        num_threads_(num_threads) {};
 
   bool Setup() {
-    input_ = fftw_alloc_complex(n_);
+    input_ = FFTW::AllocComplex(n_);
     if (input_ == nullptr) {
       return false;
     }
-    output_ = fftw_alloc_complex(n_);
+    output_ = FFTW::AllocComplex(n_);
     if (output_ == nullptr) {
       return false;
     }
-    unsigned int flags = measure_ ? FFTW_MEASURE : FFTW_ESTIMATE;
+    // The input of RunTrial is read-only (it may be a memory-mapped file), so
+    // the plan must not overwrite its input when applied to it directly.
+    unsigned int flags = planning_flags_ | FFTW_PRESERVE_INPUT;
 
-    plan_ = fftw_plan_dft_1d(n_, input_, output_, FFTW_FORWARD, flags);
+    if (num_threads_ > 1) {
+      if (!FFTW::InitThreads()) {
+        return false;
+      }
+      FFTW::PlanWithNThreads(num_threads_);
+    }
+    if (rows_ > 1) {
+      plan_ = FFTW::PlanDFT2D(rows_, n_ / rows_, input_, output_,
+                              FFTW_FORWARD, flags);
+    } else {
+      plan_ = FFTW::PlanDFT1D(n_, input_, output_, FFTW_FORWARD, flags);
+    }
+    if (num_threads_ > 1) {
+      FFTW::PlanWithNThreads(1);
+    }
 
     if (plan_ == nullptr) {
       return false;
@@ -30,45 +63,65 @@ class FFTWInterface : public FFTInterface {
     return true;
   }
 
-  bool RunTrial(const std::vector<std::complex<double>>& input,
+  bool UsesFloatInput() const {
+    return std::is_same<Real, float>::value;
+  }
+
+  using FFTInterface::RunTrial;
+
+  bool RunTrial(const std::complex<Real>* input,
                 std::vector<std::complex<double>>* output,
                 double* running_time) {
-    if (input.size() != n_) {
-      return false;
+    // Transform the input in place if it has the alignment the plan was
+    // created for (always the case for memory-mapped inputs). Otherwise copy
+    // it into the planned buffer first.
+    typename FFTW::Complex* in = reinterpret_cast<typename FFTW::Complex*>(
+        const_cast<std::complex<Real>*>(input));
+    bool same_alignment = (FFTW::AlignmentOf(reinterpret_cast<Real*>(in))
+        == FFTW::AlignmentOf(reinterpret_cast<Real*>(input_)));
+    if (!same_alignment) {
+      memcpy(input_, input, sizeof(typename FFTW::Complex) * n_);
+      in = input_;
     }
-    memcpy(input_, input.data(), sizeof(fftw_complex) * n_);
 
+    PerfCounters::StartRegion();
     Timer timer; 
-    fftw_execute(plan_);
+    FFTW::ExecuteDFT(plan_, in, output_);
     *running_time = timer.GetElapsedSeconds();
+    PerfCounters::StopRegion();
 
     output->resize(n_);
-    memcpy(output->data(), output_, sizeof(fftw_complex) * n_);
     double normalization_factor = 1.0 / sqrt(n_);
     for (size_t ii = 0; ii < n_; ++ii) {
-      (*output)[ii] *= normalization_factor;
+      (*output)[ii] = std::complex<double>(output_[ii][0], output_[ii][1])
+                      * normalization_factor;
     }
     return true;
   }
 
-  ~FFTWInterface() {
+  ~BasicFFTWInterface() {
     if (plan_ != nullptr) {
-      fftw_destroy_plan(plan_);
+      FFTW::DestroyPlan(plan_);
     }
     if (output_ != nullptr) {
-      fftw_free(output_);
+      FFTW::Free(output_);
     }
     if (input_ != nullptr) {
-      fftw_free(input_);
+      FFTW::Free(input_);
     }
   }
 
  private:
   size_t n_;
-  fftw_complex* input_;
-  fftw_complex* output_;
-  fftw_plan plan_;
-  bool measure_;
+  size_t rows_;
+  typename FFTW::Complex* input_;
+  typename FFTW::Complex* output_;
+  typename FFTW::Plan plan_;
+  unsigned int planning_flags_;
+  size_t num_threads_;
 };
 
+typedef BasicFFTWInterface<double> FFTWInterface;
+typedef BasicFFTWInterface<float> FFTWFInterface;
+
 #endif
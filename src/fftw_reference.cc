@@ -0,0 +1,124 @@
+#include "fftw_reference.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "fftw_threads.h"
+#include "timer.h"
+
+namespace {
+
+// Distance between two consecutive slots in the batch buffer. Padding the
+// slots to a multiple of 8 complex numbers (128 bytes) gives every slot the
+// same alignment, so the single-transform plan can be applied to any slot
+// with fftw_execute_dft.
+size_t SlotDistance(size_t n) {
+  return (n + 7) / 8 * 8;
+}
+
+}  // namespace
+
+bool FFTWReference::Setup() {
+  if (n_ == 0 || batch_size_ == 0 || rows_ == 0 || n_ % rows_ != 0) {
+    return false;
+  }
+
+  size_t dist = SlotDistance(n_);
+  data_ = fftw_alloc_complex(dist * batch_size_);
+  if (data_ == nullptr) {
+    return false;
+  }
+
+  if (num_threads_ > 1) {
+    if (!InitFFTWThreads()) {
+      return false;
+    }
+    fftw_plan_with_nthreads(num_threads_);
+  }
+  bool success = CreatePlans();
+  if (num_threads_ > 1) {
+    fftw_plan_with_nthreads(1);
+  }
+  return success;
+}
+
+bool FFTWReference::CreatePlans() {
+  int sign = forward_ ? FFTW_FORWARD : FFTW_BACKWARD;
+  // The dimensions of the transform (n for 1D signals).
+  int rank = (rows_ > 1 ? 2 : 1);
+  int dims[2] = {static_cast<int>(n_), 1};
+  if (rank == 2) {
+    dims[0] = rows_;
+    dims[1] = n_ / rows_;
+    single_plan_ = fftw_plan_dft_2d(dims[0], dims[1], data_, data_, sign,
+                                    planning_flags_);
+  } else {
+    single_plan_ = fftw_plan_dft_1d(n_, data_, data_, sign, planning_flags_);
+  }
+  if (single_plan_ == nullptr) {
+    return false;
+  }
+
+  size_t dist = SlotDistance(n_);
+  if (batch_size_ > 1) {
+    batch_plan_ = fftw_plan_many_dft(rank, dims, batch_size_,
+                                     data_, nullptr, 1, dist,
+                                     data_, nullptr, 1, dist,
+                                     sign, planning_flags_);
+    if (batch_plan_ == nullptr) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void FFTWReference::LoadInput(size_t slot,
+                              const std::complex<double>* input) {
+  memcpy(data_ + slot * SlotDistance(n_), input,
+         sizeof(fftw_complex) * n_);
+}
+
+bool FFTWReference::Execute(size_t num_inputs, double* computation_time) {
+  if (num_inputs == 0 || num_inputs > batch_size_) {
+    return false;
+  }
+  size_t dist = SlotDistance(n_);
+
+  Timer timer;
+  if (num_inputs == batch_size_ && batch_plan_ != nullptr) {
+    fftw_execute(batch_plan_);
+  } else {
+    for (size_t ii = 0; ii < num_inputs; ++ii) {
+      fftw_complex* slot = data_ + ii * dist;
+      fftw_execute_dft(single_plan_, slot, slot);
+    }
+  }
+  *computation_time = timer.GetElapsedSeconds() / num_inputs;
+  return true;
+}
+
+void FFTWReference::StoreOutput(size_t slot,
+    std::vector<std::complex<double>>* output) const {
+  output->resize(n_);
+  memcpy(output->data(), data_ + slot * SlotDistance(n_),
+         sizeof(fftw_complex) * n_);
+  if (normalize_) {
+    double normalization_factor = 1.0 / sqrt(n_);
+    for (size_t ii = 0; ii < n_; ++ii) {
+      (*output)[ii] *= normalization_factor;
+    }
+  }
+}
+
+FFTWReference::~FFTWReference() {
+  if (batch_plan_ != nullptr) {
+    fftw_destroy_plan(batch_plan_);
+  }
+  if (single_plan_ != nullptr) {
+    fftw_destroy_plan(single_plan_);
+  }
+  if (data_ != nullptr) {
+    fftw_free(data_);
+  }
+}
@@ -0,0 +1,64 @@
+#ifndef __FFTW_REFERENCE_H__
+#define __FFTW_REFERENCE_H__
+
+#include <complex>
+#include <vector>
+
+#include <fftw3.h>
+
+// Computes reference outputs with a single FFTW plan that is created once for
+// a given (n, direction) and reused for all inputs. With a batch size larger
+// than 1, the plan is a fftw_plan_many_dft plan that transforms several inputs
+// in one call.
+//
+// Usage: load up to batch_size() inputs with LoadInput, call Execute, and
+// retrieve the outputs with StoreOutput.
+//
+// planning_flags is the FFTW planner rigor (FFTW_ESTIMATE, FFTW_MEASURE, ...).
+// With num_threads > 1, the plans are multithreaded. With rows > 1, the inputs
+// are rows x (n / rows) arrays in row-major order and the plans compute 2D
+// DFTs.
+class FFTWReference {
+ public:
+  FFTWReference(size_t n, bool forward, bool normalize, size_t batch_size,
+                unsigned int planning_flags, size_t num_threads,
+                size_t rows = 1)
+      : n_(n), forward_(forward), normalize_(normalize),
+        batch_size_(batch_size), planning_flags_(planning_flags),
+        num_threads_(num_threads), rows_(rows), data_(nullptr),
+        single_plan_(nullptr), batch_plan_(nullptr) {}
+
+  bool Setup();
+
+  size_t batch_size() const {
+    return batch_size_;
+  }
+
+  void LoadInput(size_t slot, const std::complex<double>* input);
+
+  // Transforms the first num_inputs slots. The computation time is the time
+  // per input, i.e., the time of a batched transform is split evenly among
+  // the inputs in the batch.
+  bool Execute(size_t num_inputs, double* computation_time);
+
+  void StoreOutput(size_t slot,
+                   std::vector<std::complex<double>>* output) const;
+
+  ~FFTWReference();
+
+ private:
+  size_t n_;
+  bool forward_;
+  bool normalize_;
+  size_t batch_size_;
+  unsigned int planning_flags_;
+  size_t num_threads_;
+  size_t rows_;
+  fftw_complex* data_;
+  fftw_plan single_plan_;
+  fftw_plan batch_plan_;
+
+  bool CreatePlans();
+};
+
+#endif
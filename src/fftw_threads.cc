@@ -0,0 +1,26 @@
+#include "fftw_threads.h"
+
+#include <cstdio>
+
+#include <fftw3.h>
+
+bool InitFFTWThreads() {
+  static bool initialized = false;
+  static bool success = false;
+  if (!initialized) {
+    success = (fftw_init_threads() != 0);
+    initialized = true;
+    if (!success) {
+      fprintf(stderr, "Could not initialize FFTW threads.\n");
+    }
+  }
+  return success;
+}
+
+bool MakeFFTWPlannerThreadSafe() {
+  if (!InitFFTWThreads()) {
+    return false;
+  }
+  fftw_make_planner_thread_safe();
+  return true;
+}
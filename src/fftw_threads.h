@@ -0,0 +1,17 @@
+#ifndef __FFTW_THREADS_H__
+#define __FFTW_THREADS_H__
+
+// Multithreaded FFTW plans use the OpenMP variant of FFTW's threading
+// (libfftw3_omp), so FFTW shares its worker threads with the OpenMP code in
+// this project.
+
+// Initializes FFTW's threading. Must be called once before any other FFTW
+// function (including the wisdom functions) is used. Later calls do nothing.
+bool InitFFTWThreads();
+
+// Makes the FFTW planner safe to call from several threads at the same time
+// (requires FFTW 3.3.5 or later). Needed when backends that create FFTW plans
+// internally run in concurrent threads. Initializes FFTW's threading first.
+bool MakeFFTWPlannerThreadSafe();
+
+#endif
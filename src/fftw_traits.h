@@ -0,0 +1,98 @@
+#ifndef __FFTW_TRAITS_H__
+#define __FFTW_TRAITS_H__
+
+#include <cstdio>
+
+#include <fftw3.h>
+
+#include "fftw_threads.h"
+
+// The parts of the FFTW API used by the FFTW backends, for double (fftw_) and
+// single precision (fftwf_, libfftw3f).
+template <typename Real>
+struct FFTWTraits;
+
+template <>
+struct FFTWTraits<double> {
+  typedef fftw_complex Complex;
+  typedef fftw_plan Plan;
+
+  static Complex* AllocComplex(size_t n) {
+    return fftw_alloc_complex(n);
+  }
+  static void Free(void* p) {
+    fftw_free(p);
+  }
+  static int AlignmentOf(double* p) {
+    return fftw_alignment_of(p);
+  }
+  static bool InitThreads() {
+    return InitFFTWThreads();
+  }
+  static void PlanWithNThreads(int num_threads) {
+    fftw_plan_with_nthreads(num_threads);
+  }
+  static Plan PlanDFT1D(int n, Complex* in, Complex* out, int sign,
+                        unsigned int flags) {
+    return fftw_plan_dft_1d(n, in, out, sign, flags);
+  }
+  static Plan PlanDFT2D(int n0, int n1, Complex* in, Complex* out, int sign,
+                        unsigned int flags) {
+    return fftw_plan_dft_2d(n0, n1, in, out, sign, flags);
+  }
+  static void ExecuteDFT(const Plan plan, Complex* in, Complex* out) {
+    fftw_execute_dft(plan, in, out);
+  }
+  static void DestroyPlan(Plan plan) {
+    fftw_destroy_plan(plan);
+  }
+};
+
+template <>
+struct FFTWTraits<float> {
+  typedef fftwf_complex Complex;
+  typedef fftwf_plan Plan;
+
+  static Complex* AllocComplex(size_t n) {
+    return fftwf_alloc_complex(n);
+  }
+  static void Free(void* p) {
+    fftwf_free(p);
+  }
+  static int AlignmentOf(float* p) {
+    return fftwf_alignment_of(p);
+  }
+  // The single precision library has its own threading state (see
+  // InitFFTWThreads).
+  static bool InitThreads() {
+    static bool initialized = false;
+    static bool success = false;
+    if (!initialized) {
+      success = (fftwf_init_threads() != 0);
+      initialized = true;
+      if (!success) {
+        fprintf(stderr, "Could not initialize FFTW threads (float).\n");
+      }
+    }
+    return success;
+  }
+  static void PlanWithNThreads(int num_threads) {
+    fftwf_plan_with_nthreads(num_threads);
+  }
+  static Plan PlanDFT1D(int n, Complex* in, Complex* out, int sign,
+                        unsigned int flags) {
+    return fftwf_plan_dft_1d(n, in, out, sign, flags);
+  }
+  static Plan PlanDFT2D(int n0, int n1, Complex* in, Complex* out, int sign,
+                        unsigned int flags) {
+    return fftwf_plan_dft_2d(n0, n1, in, out, sign, flags);
+  }
+  static void ExecuteDFT(const Plan plan, Complex* in, Complex* out) {
+    fftwf_execute_dft(plan, in, out);
+  }
+  static void DestroyPlan(Plan plan) {
+    fftwf_destroy_plan(plan);
+  }
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "fftw_wisdom.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/algorithm/string.hpp>
+#include <fcntl.h>
+#include <fftw3.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace {
+
+std::string ExportWisdom() {
+  char* wisdom = fftw_export_wisdom_to_string();
+  if (wisdom == nullptr) {
+    return "";
+  }
+  std::string result(wisdom);
+  free(wisdom);
+  return result;
+}
+
+bool FileExists(const std::string& filename) {
+  return access(filename.c_str(), F_OK) == 0;
+}
+
+}  // namespace
+
+int FFTWWisdom::Lock(bool exclusive) const {
+  std::string lock_filename = filename_ + ".lock";
+  int fd = open(lock_filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open wisdom lock file %s.\n",
+        lock_filename.c_str());
+    return -1;
+  }
+  if (flock(fd, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+    fprintf(stderr, "Could not lock wisdom lock file %s.\n",
+        lock_filename.c_str());
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void FFTWWisdom::Unlock(int fd) const {
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+bool FFTWWisdom::Load() {
+  if (!enabled()) {
+    return true;
+  }
+  int fd = Lock(false);
+  if (fd < 0) {
+    return false;
+  }
+  bool success = true;
+  if (FileExists(filename_)) {
+    if (!fftw_import_wisdom_from_filename(filename_.c_str())) {
+      fprintf(stderr, "Could not import FFTW wisdom from %s.\n",
+          filename_.c_str());
+      success = false;
+    }
+  }
+  Unlock(fd);
+  loaded_wisdom_ = ExportWisdom();
+  return success;
+}
+
+bool FFTWWisdom::Save() {
+  if (!enabled() || ExportWisdom() == loaded_wisdom_) {
+    return true;
+  }
+  int fd = Lock(true);
+  if (fd < 0) {
+    return false;
+  }
+  // Merge with wisdom saved by other processes since our Load.
+  if (FileExists(filename_)) {
+    fftw_import_wisdom_from_filename(filename_.c_str());
+  }
+  // Write to a temporary file and rename it so that readers which do not use
+  // the lock never see a partially written file.
+  std::string tmp_filename = filename_ + ".tmp";
+  bool success = fftw_export_wisdom_to_filename(tmp_filename.c_str())
+      && rename(tmp_filename.c_str(), filename_.c_str()) == 0;
+  if (!success) {
+    fprintf(stderr, "Could not save FFTW wisdom to %s.\n", filename_.c_str());
+    unlink(tmp_filename.c_str());
+  }
+  Unlock(fd);
+  loaded_wisdom_ = ExportWisdom();
+  return success;
+}
+
+bool FFTWWisdom::ParsePlanningFlags(const std::string& str,
+                                    unsigned int* flags) {
+  std::string lower = boost::algorithm::to_lower_copy(str);
+  if (lower == "estimate") {
+    *flags = FFTW_ESTIMATE;
+  } else if (lower == "measure") {
+    *flags = FFTW_MEASURE;
+  } else if (lower == "patient") {
+    *flags = FFTW_PATIENT;
+  } else if (lower == "exhaustive") {
+    *flags = FFTW_EXHAUSTIVE;
+  } else {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,44 @@
+#ifndef __FFTW_WISDOM_H__
+#define __FFTW_WISDOM_H__
+
+#include <string>
+
+// Persistent FFTW wisdom shared by all binaries. Plans created with
+// FFTW_MEASURE or FFTW_PATIENT are expensive to compute, but FFTW can store
+// the result of the planning ("wisdom") and reuse it in later processes, where
+// planning then takes almost no time.
+//
+// Usage: call Load before creating any plans and Save after the last plan has
+// been created. Access to the wisdom file is synchronized with flock on a
+// separate lock file, so several processes can share the same wisdom file.
+// Save merges the wisdom of this process with the wisdom that other processes
+// saved in the meantime.
+class FFTWWisdom {
+ public:
+  // An empty filename disables loading and saving.
+  explicit FFTWWisdom(const std::string& filename) : filename_(filename) {}
+
+  bool enabled() const {
+    return !filename_.empty();
+  }
+
+  // A missing wisdom file is not an error.
+  bool Load();
+
+  // Does not write the file if no new wisdom was accumulated since Load.
+  bool Save();
+
+  // Parses "estimate", "measure", "patient", or "exhaustive" into the
+  // corresponding FFTW planner flag.
+  static bool ParsePlanningFlags(const std::string& str, unsigned int* flags);
+
+ private:
+  std::string filename_;
+  std::string loaded_wisdom_;
+
+  // Returns the file descriptor of the lock file or -1 on failure.
+  int Lock(bool exclusive) const;
+  void Unlock(int fd) const;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "flat_filter.h"
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+
+namespace {
+
+// Number of cosines computed with the rotation recurrence before the
+// rotation is recomputed exactly (bounds the accumulated rounding error).
+const size_t kAnchorInterval = 256;
+
+// Modified Bessel function of the first kind of order 0 (power series).
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  double y = 0.25 * x * x;
+  for (int kk = 1; kk < 500; ++kk) {
+    term *= y / (static_cast<double>(kk) * kk);
+    sum += term;
+    if (term < sum * 1e-17) {
+      break;
+    }
+  }
+  return sum;
+}
+
+// Kaiser's formula for the window parameter beta given the attenuation in dB.
+double KaiserBeta(double attenuation) {
+  if (attenuation > 50.0) {
+    return 0.1102 * (attenuation - 8.7);
+  } else if (attenuation >= 21.0) {
+    return 0.5842 * std::pow(attenuation - 21.0, 0.4)
+           + 0.07886 * (attenuation - 21.0);
+  } else {
+    return 0.0;
+  }
+}
+
+}  // namespace
+
+bool FlatFilter::Create(size_t n, size_t B, double tolerance,
+                        double transition) {
+  if (B == 0 || B >= n || n % B != 0) {
+    fprintf(stderr, "FlatFilter: B = %lu must be a divisor of n = %lu with "
+                    "B < n.\n", B, n);
+    return false;
+  }
+  if (tolerance <= 0.0 || tolerance >= 1.0 || transition <= 0.0) {
+    fprintf(stderr, "FlatFilter: invalid tolerance or transition width.\n");
+    return false;
+  }
+  n_ = n;
+  B_ = B;
+
+  // Kaiser's estimate of the window length for the given attenuation and
+  // transition width (in cycles per sample).
+  double attenuation = -20.0 * std::log10(tolerance);
+  double beta = KaiserBeta(attenuation);
+  double transition_width = transition / (2.0 * B);
+  size_t half_width = static_cast<size_t>(std::ceil(
+      (attenuation - 7.95) / (14.357 * transition_width) / 2.0));
+  if (half_width < 1) {
+    half_width = 1;
+  }
+  size_t size = 2 * half_width + 1;
+  size = (size + 2 * B - 1) / (2 * B) * (2 * B);
+  if (size > n) {
+    fprintf(stderr, "FlatFilter: the filter for B = %lu (%lu samples) is "
+                    "longer than the signal (n = %lu).\n", B, size, n);
+    return false;
+  }
+
+  // Ideal lowpass filter with the cutoff in the middle of the transition
+  // band, times the window.
+  double cutoff = (1.0 + transition / 2.0) / (2.0 * B);
+  double i0_beta = BesselI0(beta);
+  time_.assign(size, 0.0);
+  int64_t offset = -first();
+  for (size_t tt = 0; tt <= half_width; ++tt) {
+    double ratio = static_cast<double>(tt) / half_width;
+    double window = BesselI0(beta * std::sqrt(1.0 - ratio * ratio)) / i0_beta;
+    double sinc = 2.0 * cutoff;
+    if (tt > 0) {
+      sinc = std::sin(2.0 * M_PI * cutoff * tt) / (M_PI * tt);
+    }
+    time_[offset + tt] = sinc * window;
+    time_[offset - tt] = sinc * window;
+  }
+
+  // Since the filter is symmetric, its DFT is real:
+  // G(f) = g_0 + 2 sum_{t >= 1} g_t cos(2 pi f t / n).
+  size_t num_offsets = n / (2 * B) + 1;
+  freq_.resize(num_offsets);
+  const double* g = time_.data() + offset;
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t ff = 0; ff < num_offsets; ++ff) {
+    double angle = 2.0 * M_PI * static_cast<double>(ff) / n;
+    std::complex<double> rotation = std::polar(1.0, angle);
+    std::complex<double> phase(1.0, 0.0);
+    double sum = 0.0;
+    for (size_t tt = 1; tt <= half_width; ++tt) {
+      if (tt % kAnchorInterval == 0) {
+        phase = std::polar(1.0, angle * tt);
+      } else {
+        phase *= rotation;
+      }
+      sum += g[tt] * phase.real();
+    }
+    freq_[ff] = g[0] + 2.0 * sum;
+  }
+  return true;
+}
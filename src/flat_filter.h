@@ -0,0 +1,54 @@
+#ifndef __FLAT_FILTER_H__
+#define __FLAT_FILTER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Flat window filter that hashes the n frequencies of a signal into B
+// buckets: a Kaiser-windowed ideal lowpass filter. Its DFT is within
+// tolerance of 1 for offsets |f| <= n / (2B) (the bucket of a frequency) and
+// below tolerance for |f| >= (1 + transition) * n / (2B).
+//
+// The filter is real and symmetric. Its support is
+// O(B log(1 / tolerance) / transition) samples, centered at t = 0 and padded
+// with zeros to a multiple of 2B, so that time() starts at a multiple of B.
+class FlatFilter {
+ public:
+  FlatFilter() : n_(0), B_(0) {}
+
+  // B must be a divisor of n with B < n.
+  bool Create(size_t n, size_t B, double tolerance, double transition);
+
+  size_t B() const {
+    return B_;
+  }
+
+  // Number of samples of the time-domain filter.
+  size_t size() const {
+    return time_.size();
+  }
+
+  // Offset of the first sample: time()[ii] is the filter at t = first() + ii.
+  int64_t first() const {
+    return -static_cast<int64_t>(time_.size() / 2);
+  }
+
+  const double* time() const {
+    return time_.data();
+  }
+
+  // DFT of the filter at the frequency offset f, |f| <= n / (2B).
+  double freq(int64_t f) const {
+    return freq_[f < 0 ? -f : f];
+  }
+
+ private:
+  size_t n_;
+  size_t B_;
+  std::vector<double> time_;
+  // DFT at the offsets 0, ..., n / (2B).
+  std::vector<double> freq_;
+};
+
+#endif
@@ -1,22 +1,22 @@
 #include <cmath>
-#include <complex>
 #include <cstdint>
 #include <cstdio>
 #include <fstream>
 #include <iostream>
-#include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/program_options.hpp>
 
-#include "fftw_helper.h"
+#include "fftw_wisdom.h"
 #include "helpers.h"
 #include "result_helpers.h"
+#include "signal_container.h"
+#include "signal_generator.h"
 
 namespace po = boost::program_options;
 
-using std::complex;
 using std::cout;
 using std::endl;
 using std::log10;
@@ -24,43 +24,8 @@ using std::ofstream;
 using std::string;
 using std::vector;
 
-typedef complex<double> dcomplex;
-
-bool WriteOutput(const vector<dcomplex>& data, const string& dest) {
-  if (dest.length() == 0) {
-    for (size_t ii = 0; ii < data.size(); ++ii) {
-      if (ii != 0) {
-        cout << " ";
-      }
-      cout << data[ii];
-    }
-    cout << endl;
-  } else {
-    FILE* fout = fopen(dest.c_str(), "wb");
-    if (fout == nullptr) {
-      fprintf(stderr, "Error opening file \"%s\".", dest.c_str());
-      return false;
-    }
-    size_t num_written = fwrite(data.data(), sizeof(dcomplex), data.size(),
-                                fout);
-    if (num_written != data.size()) {
-      fprintf(stderr, "Error writing data: %lu elements written, expected %lu."
-                      "\n", num_written, data.size());
-      return false;
-    }
-
-    if (fclose(fout) != 0) {
-      fprintf(stderr, "Error closing file \"%s\".", dest.c_str());
-      return false;
-    }
-  }
-  return true;
-}
-
 bool WriteStatsFile(int argc, char** argv,
-                    const vector<dcomplex>& pure_spectrum,
-                    const vector<dcomplex>& spectrum_noise,
-                    const vector<dcomplex>& final_signal,
+                    const GeneratorStatistics& stats,
                     const string& stats_filename) {
   ofstream out(stats_filename);
   if (!out.good()) {
@@ -70,12 +35,9 @@ bool WriteStatsFile(int argc, char** argv,
 
   string cmd = CollapseCommand(argc, argv);
 
-  SignalStatistics pure_spectrum_stats;
-  SignalStatistics spectrum_noise_stats;
-  SignalStatistics final_signal_stats;
-  ComputeSignalStatistics(pure_spectrum, 0.0, &pure_spectrum_stats);
-  ComputeSignalStatistics(spectrum_noise, 0.0, &spectrum_noise_stats);
-  ComputeSignalStatistics(final_signal, 0.0, &final_signal_stats);
+  const SignalStatistics& pure_spectrum_stats = stats.pure_spectrum;
+  const SignalStatistics& spectrum_noise_stats = stats.spectrum_noise;
+  const SignalStatistics& final_signal_stats = stats.final_signal;
   double snr = pure_spectrum_stats.l2 / spectrum_noise_stats.l2;
   snr = snr * snr;
 
@@ -97,6 +59,151 @@ bool WriteStatsFile(int argc, char** argv,
   return out.good();
 }
 
+// Replaces the "{}" in pattern with the instance number.
+string InstanceFilename(const string& pattern, size_t instance) {
+  string result = pattern;
+  size_t pos = result.find("{}");
+  if (pos != string::npos) {
+    result.replace(pos, 2, std::to_string(instance));
+  }
+  return result;
+}
+
+// With single_precision, the file contains complex floats instead of complex
+// doubles.
+bool WriteBinaryFile(SignalGenerator* generator, size_t buffer,
+                     bool single_precision, const string& filename,
+                     GeneratorStatistics* stats) {
+  FILE* fout = fopen(filename.c_str(), "wb");
+  if (fout == nullptr) {
+    fprintf(stderr, "Error opening file \"%s\".\n", filename.c_str());
+    return false;
+  }
+  bool success;
+  if (single_precision) {
+    success = generator->WriteBinaryFloat(buffer, fout, stats);
+  } else {
+    success = generator->WriteBinary(buffer, fout, stats);
+  }
+  if (fclose(fout) != 0) {
+    fprintf(stderr, "Error closing file \"%s\".\n", filename.c_str());
+    success = false;
+  }
+  if (!success) {
+    fprintf(stderr, "Error while writing output.\n");
+  }
+  return success;
+}
+
+// Format of the output files: plain binary complex doubles (or floats with
+// single_precision) or a container (see signal_container.h) with the given
+// codec, n, and k.
+struct FileFormat {
+  bool container;
+  bool single_precision;
+  SignalContainerHeader header;
+};
+
+bool WriteOutputFile(SignalGenerator* generator, size_t buffer,
+                     const FileFormat& format, uint64_t seed,
+                     const string& filename, GeneratorStatistics* stats) {
+  if (!format.container) {
+    return WriteBinaryFile(generator, buffer, format.single_precision,
+                           filename, stats);
+  }
+  SignalContainerHeader header = format.header;
+  header.seed = seed;
+  SignalContainerWriter writer;
+  if (!writer.Open(filename, header)) {
+    return false;
+  }
+  if (!generator->WriteContainer(buffer, &writer, stats)
+      || !writer.Close(stats->pure_spectrum, stats->spectrum_noise,
+                       stats->final_signal)) {
+    fprintf(stderr, "Error while writing output.\n");
+    return false;
+  }
+  return true;
+}
+
+struct BatchOptions {
+  FileFormat format;
+  size_t num_instances;
+  uint64_t base_seed;
+  string output_pattern;
+  string stats_pattern;
+  string index_file;
+};
+
+// Writes one instance (output and stats file).
+void WriteInstance(int argc, char** argv, const BatchOptions& batch,
+                   size_t instance, SignalGenerator* generator, size_t buffer,
+                   GeneratorStatistics* stats, bool* success) {
+  *success = WriteOutputFile(generator, buffer, batch.format,
+      InstanceSeed(batch.base_seed, instance),
+      InstanceFilename(batch.output_pattern, instance), stats);
+  if (*success && !batch.stats_pattern.empty()) {
+    string stats_filename = InstanceFilename(batch.stats_pattern, instance);
+    if (!WriteStatsFile(argc, argv, *stats, stats_filename)) {
+      fprintf(stderr, "Error while writing stats file.\n");
+      *success = false;
+    }
+  }
+}
+
+// Generates the instances 1, ..., num_instances with the seeds
+// InstanceSeed(base_seed, instance). The generator and its plan are shared by
+// all instances. With two buffers, instance i is written by a separate thread
+// while instance i + 1 is generated.
+bool GenerateInstances(int argc, char** argv, const BatchOptions& batch,
+                       size_t num_buffers, SignalGenerator* generator) {
+  vector<GeneratorStatistics> stats(num_buffers);
+  std::thread writer;
+  bool writer_success = true;
+  bool success = true;
+  for (size_t instance = 1; instance <= batch.num_instances; ++instance) {
+    size_t buffer = instance % num_buffers;
+    generator->Generate(InstanceSeed(batch.base_seed, instance), buffer,
+                        &stats[buffer]);
+    if (writer.joinable()) {
+      writer.join();
+      success = success && writer_success;
+    }
+    if (!success) {
+      break;
+    }
+    if (num_buffers > 1) {
+      writer = std::thread(WriteInstance, argc, argv, std::cref(batch),
+                           instance, generator, buffer, &stats[buffer],
+                           &writer_success);
+    } else {
+      WriteInstance(argc, argv, batch, instance, generator, buffer,
+                    &stats[buffer], &writer_success);
+      success = writer_success;
+    }
+  }
+  if (writer.joinable()) {
+    writer.join();
+    success = success && writer_success;
+  }
+  if (!success) {
+    return false;
+  }
+
+  if (!batch.index_file.empty()) {
+    ofstream index(batch.index_file);
+    for (size_t instance = 1; instance <= batch.num_instances; ++instance) {
+      index << InstanceFilename(batch.output_pattern, instance) << "\n";
+    }
+    if (!index.good()) {
+      fprintf(stderr, "Error while writing index file \"%s\".\n",
+          batch.index_file.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
 int main(int argc, char** argv) {
   size_t k;
   size_t n;
@@ -104,28 +211,86 @@ int main(int argc, char** argv) {
   uint_fast32_t seed;
   double noise_variance;
   string stats_file;
+  string fftw_planning;
+  string wisdom_file;
+  size_t num_threads;
+  size_t rows;
+  string synthesis;
+  string output_format;
+  string codec;
+  BatchOptions batch;
 
   po::options_description desc("Allowed options");
   desc.add_options()
+      ("codec", po::value<string>(&codec)->default_value("lossless"),
+          "Codec of the container output format: raw, lossless (byte shuffle "
+          "and LZ compression), or float32 (lossy, values rounded to floats). "
+          "The default is lossless.")
+      ("fftw_planning",
+          po::value<string>(&fftw_planning)->default_value("estimate"),
+          "FFTW planner rigor for the inverse FFT: estimate, measure, patient, "
+          "or exhaustive. The default is estimate.")
       ("firstk", "Do not randomize spectrum support, take the k first indices.")
       ("help", "Show help message.")
+      ("index_file", po::value<string>(&batch.index_file)->default_value(""),
+          "With --num_instances: file for the list of generated inputs (an "
+          "index file for run_experiment), or \"\" for no index file.")
       ("k", po::value<size_t>(&k)->default_value(0), "Sparsity")
       ("n", po::value<size_t>(&n)->default_value(0),
           "Size of the signal to be generated.")
+      ("num_instances",
+          po::value<size_t>(&batch.num_instances)->default_value(0),
+          "Number of inputs to generate in one process (0 for a single input "
+          "written to --output_file). Instance i is written to "
+          "--output_pattern with the seed derived from --seed and i, so the "
+          "inputs only depend on --seed and their instance number.")
       ("noise_variance",
           po::value<double>(&noise_variance)->default_value(-1.0),
           "This parameter specifies the noise variance for both the real and "
           "imaginary component. If negative, no noise is added.")
       ("output_file", po::value<string>(&output_file)->default_value(""),
           "Output file name (or \"\" for stdout). The default is \"\".")
+      ("output_format",
+          po::value<string>(&output_format)->default_value("binary"),
+          "Format of the output files: binary (n complex doubles), float "
+          "(n complex floats, for run_experiment --input_precision float), "
+          "or container (chunked and compressed with --codec, with a header "
+          "that records n, k, the seed, and the signal statistics). The "
+          "default is binary.")
+      ("output_pattern",
+          po::value<string>(&batch.output_pattern)->default_value(""),
+          "With --num_instances: output file name, where \"{}\" is replaced "
+          "by the instance number 1, ..., num_instances.")
+      ("rows", po::value<size_t>(&rows)->default_value(1),
+          "Number of rows of a 2D signal: with rows > 1, the signal is a "
+          "rows x (n / rows) array in row-major order with a k-sparse 2D "
+          "spectrum. The default is 1 (1D signals).")
       ("skip_phase_randomization", "Do not randomize the phase.")
       ("seed", po::value<size_t>(&seed)->default_value(0),
-          "Seed for the PRNG.")
+          "Seed for the PRNG. The random numbers are drawn from counter-based "
+          "streams, so the output only depends on the seed (not on the number "
+          "of threads).")
       ("skip_ifft", "Do not apply an inverse FFT on the generated spectrum.")
       ("skip_normalization", "Do not normalize the output from FFTW.")
+      ("synthesis", po::value<string>(&synthesis)->default_value("fft"),
+          "How the time-domain signal is computed: fft (inverse FFT of the "
+          "spectrum), direct (sum of the k tones, evaluated with a phasor "
+          "recurrence; only without noise), or auto (direct if there is no "
+          "noise, k <= 24, and the signal is 1D). Direct synthesis needs no "
+          "n-element buffer, but its output differs from the inverse FFT by "
+          "rounding errors. The default is fft.")
       ("stats_file", po::value<string>(&stats_file)->default_value(""),
           "File for the signal statistics. If the parameters is \"\", no "
-          "statistics file will be written.");
+          "statistics file will be written.")
+      ("stats_pattern",
+          po::value<string>(&batch.stats_pattern)->default_value(""),
+          "With --num_instances: statistics file name, where \"{}\" is "
+          "replaced by the instance number (or \"\" for no statistics).")
+      ("threads", po::value<size_t>(&num_threads)->default_value(1),
+          "Number of threads for the inverse FFT. The default is 1.")
+      ("wisdom_file", po::value<string>(&wisdom_file)->default_value(""),
+          "File for loading and saving FFTW wisdom (or \"\" for no wisdom "
+          "file). The default is \"\".");
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
   po::notify(vm);
@@ -139,57 +304,130 @@ int main(int argc, char** argv) {
     fprintf(stderr, "k can be at most n.\n");
     return false;
   }
+  if (rows == 0 || n % rows != 0) {
+    fprintf(stderr, "The number of rows must divide n.\n");
+    return 1;
+  }
 
-  std::mt19937 prng(seed);
+  bool batch_mode = batch.num_instances > 0;
+  if (batch_mode) {
+    if (batch.output_pattern.find("{}") == string::npos) {
+      fprintf(stderr, "--output_pattern must contain \"{}\".\n");
+      return 1;
+    }
+    if (!batch.stats_pattern.empty()
+        && batch.stats_pattern.find("{}") == string::npos) {
+      fprintf(stderr, "--stats_pattern must contain \"{}\".\n");
+      return 1;
+    }
+    if (!output_file.empty() || !stats_file.empty()) {
+      fprintf(stderr, "Use --output_pattern and --stats_pattern instead of "
+          "--output_file and --stats_file with --num_instances.\n");
+      return 1;
+    }
+    batch.base_seed = seed;
+  }
 
-  // Positions
-  vector<int> indices(n);
-  for (size_t ii = 0; ii < n; ++ii) {
-    indices[ii] = ii;
+  FileFormat& format = batch.format;
+  format.container = (output_format == "container");
+  format.single_precision = (output_format == "float");
+  if (output_format != "binary" && output_format != "float"
+      && !format.container) {
+    fprintf(stderr, "Unknown output format \"%s\".\n", output_format.c_str());
+    return 1;
   }
-  if (!vm.count("firstk")) {
-    std::shuffle(indices.begin(), indices.end(), prng);
+  if (!ParseSignalCodec(codec, &format.header.codec)) {
+    fprintf(stderr, "Unknown codec \"%s\".\n", codec.c_str());
+    return 1;
   }
+  if (output_format != "binary" && !batch_mode && output_file.empty()) {
+    fprintf(stderr, "--output_format %s needs an output file (the output "
+        "on stdout is in text format).\n", output_format.c_str());
+    return 1;
+  }
+  format.header.n = n;
+  format.header.k = k;
 
-  // Spectrum
-  vector<dcomplex> signal(n, dcomplex(0, 0));
-
-  std::uniform_real_distribution<> phase_distribution(0, 2 * M_PI);
-  for (size_t ii = 0; ii < k; ++ii) {
-    size_t pos = indices[ii];
-    if (vm.count("skip_phase_randomization")) {
-      signal[pos].real(1.0);
-      signal[pos].imag(0.0);
-    } else {
-      double phase = phase_distribution(prng);
-      signal[pos].real(std::cos(phase));
-      signal[pos].imag(std::sin(phase));
-    }
+  unsigned int planning_flags;
+  if (!FFTWWisdom::ParsePlanningFlags(fftw_planning, &planning_flags)) {
+    fprintf(stderr, "Unknown FFTW planning mode \"%s\".\n",
+        fftw_planning.c_str());
+    return 1;
   }
 
-  vector<dcomplex> noise(n, dcomplex(0, 0));
-  vector<dcomplex> final_signal(signal);
-  std::normal_distribution<> noise_distribution(0, sqrt(noise_variance));
-  if (noise_variance > 0.0) {
-    for (size_t ii = 0; ii < n; ++ii) {
-      noise[ii] = dcomplex(noise_distribution(prng), noise_distribution(prng));
-      final_signal[ii] += noise[ii];
+  GeneratorOptions options;
+  options.n = n;
+  options.k = k;
+  options.noise_variance = noise_variance;
+  options.firstk = vm.count("firstk");
+  options.randomize_phase = !vm.count("skip_phase_randomization");
+  options.apply_ifft = !vm.count("skip_ifft");
+  options.normalize = !vm.count("skip_normalization");
+  options.planning_flags = planning_flags;
+  options.num_threads = num_threads;
+  options.rows = rows;
+  bool can_synthesize = options.apply_ifft && noise_variance <= 0.0
+                        && rows == 1;
+  if (synthesis == "direct") {
+    if (!can_synthesize) {
+      fprintf(stderr, "Direct synthesis cannot be used with noise, "
+          "--skip_ifft, or 2D signals.\n");
+      return 1;
     }
+    options.direct_synthesis = true;
+  } else if (synthesis == "auto") {
+    // Measured on one core with FFTW 3.3.5: the direct synthesis is faster
+    // up to about k = 24 for n = 2^16 to 2^22, the inverse FFT from k = 48.
+    // The flop counts (8 n k vs. 5 n log2(n)) do not predict this, since
+    // both are memory bound.
+    options.direct_synthesis = can_synthesize && k <= 24;
+  } else if (synthesis != "fft") {
+    fprintf(stderr, "Unknown synthesis mode \"%s\".\n", synthesis.c_str());
+    return 1;
   }
 
-  if (!vm.count("skip_ifft")) {
-    double tmp;
-    ApplyFFTW(final_signal, !vm.count("skip_normalization"), false, false, &tmp,
-        &final_signal);
+  // In batch mode, a second buffer lets the next instance be generated while
+  // the previous one is written. The direct synthesis computes the signal
+  // while writing, so there is nothing to overlap.
+  if (batch_mode && !options.direct_synthesis) {
+    options.num_buffers = 2;
   }
 
-  if (!WriteOutput(final_signal, output_file)) {
-    fprintf(stderr, "Error while writing output.\n");
+  bool uses_fftw = options.apply_ifft && !options.direct_synthesis;
+  FFTWWisdom wisdom(wisdom_file);
+  if (uses_fftw && !wisdom.Load()) {
+    return 1;
+  }
+  SignalGenerator generator(options);
+  if (!generator.Setup()) {
     return 1;
   }
+  if (uses_fftw && !wisdom.Save()) {
+    return 1;
+  }
+
+  if (batch_mode) {
+    size_t num_buffers = options.direct_synthesis ? 1 : options.num_buffers;
+    return GenerateInstances(argc, argv, batch, num_buffers, &generator)
+        ? 0 : 1;
+  }
+
+  GeneratorStatistics stats;
+  if (output_file.empty()) {
+    if (!generator.GenerateText(seed, &cout, &stats)) {
+      fprintf(stderr, "Error while writing output.\n");
+      return 1;
+    }
+  } else {
+    generator.Generate(seed, 0, &stats);
+    if (!WriteOutputFile(&generator, 0, batch.format, seed, output_file,
+                         &stats)) {
+      return 1;
+    }
+  }
 
   if (!stats_file.empty()) {
-    if (!WriteStatsFile(argc, argv, signal, noise, final_signal, stats_file)) {
+    if (!WriteStatsFile(argc, argv, stats, stats_file)) {
       fprintf(stderr, "Error while writing stats file.\n");
       return 1;
     }
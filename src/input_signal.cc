@@ -0,0 +1,190 @@
+#include "input_signal.h"
+
+#include <cstdint>
+
+#include "signal_container.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool InputSignal::MapBinaryFile(const std::string& filename, size_t n) {
+  Release();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open file %s.\n", filename.c_str());
+    return false;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || n == 0) {
+    // Not a regular file (e.g., a pipe), use the buffered reader.
+    close(fd);
+    FILE* input = fopen(filename.c_str(), "rb");
+    if (input == nullptr) {
+      fprintf(stderr, "Could not open file %s.\n", filename.c_str());
+      return false;
+    }
+    bool success = ReadBinaryFile(input, n);
+    if (fclose(input) != 0) {
+      fprintf(stderr, "Could not close input.\n");
+    }
+    return success;
+  }
+
+  size_t file_length = file_stat.st_size;
+  char magic[8];
+  if (pread(fd, magic, sizeof(magic), 0) == sizeof(magic)
+      && IsSignalContainer(magic, sizeof(magic))) {
+    bool success = ReadContainerFile(fd, file_length, n);
+    close(fd);
+    if (!success) {
+      fprintf(stderr, "Could not read signal container %s.\n",
+          filename.c_str());
+    }
+    return success;
+  }
+
+  size_t expected_length = n * sizeof(std::complex<double>);
+  if (file_length < expected_length) {
+    fprintf(stderr, "Read only %lu input elements, not %lu.\n",
+        file_length / sizeof(std::complex<double>), n);
+    close(fd);
+    return false;
+  }
+  if (file_length > expected_length) {
+    fprintf(stderr, "Input not empty afer reading %lu complex numbers.\n", n);
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, expected_length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "Could not map file %s.\n", filename.c_str());
+    return false;
+  }
+
+  mapped_data_ = data;
+  mapped_length_ = expected_length;
+  size_ = n;
+  Prefetch();
+  return true;
+}
+
+bool InputSignal::ReadBinaryFile(FILE* file, size_t n) {
+  owned_data_.resize(n);
+  size_t num_read = fread(owned_data_.data(), 2 * sizeof(double), n, file);
+  if (num_read != n) {
+    fprintf(stderr, "Read only %lu input elements, not %lu.\n", num_read, n);
+    return false;
+  }
+  // Check if file is empty
+  uint8_t tmp;
+  if (fread(&tmp, sizeof(uint8_t), 1, file) != 0) {
+    fprintf(stderr, "Input not empty afer reading %lu complex numbers.\n", n);
+    return false;
+  }
+  size_ = n;
+  return true;
+}
+
+bool InputSignal::ReadContainerFile(int fd, size_t length, size_t n) {
+  void* data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  madvise(data, length, MADV_SEQUENTIAL);
+  SignalContainerHeader header;
+  bool success = ParseSignalContainerHeader(data, length, &header);
+  if (success && header.n != n) {
+    fprintf(stderr, "Signal container has %lu elements, not %lu.\n",
+        header.n, n);
+    success = false;
+  }
+  if (success) {
+    owned_data_.resize(n);
+    success = DecodeSignalContainer(data, length, header, owned_data_.data());
+  }
+  munmap(data, length);
+  if (success) {
+    size_ = n;
+  }
+  return success;
+}
+
+bool InputSignal::ReadFloatBinaryFile(const std::string& filename, size_t n) {
+  Release();
+  FILE* input = fopen(filename.c_str(), "rb");
+  if (input == nullptr) {
+    fprintf(stderr, "Could not open file %s.\n", filename.c_str());
+    return false;
+  }
+  float_data_.resize(n);
+  size_t num_read = fread(float_data_.data(), 2 * sizeof(float), n, input);
+  uint8_t tmp;
+  bool at_end = (fread(&tmp, sizeof(uint8_t), 1, input) == 0);
+  if (fclose(input) != 0) {
+    fprintf(stderr, "Could not close input.\n");
+  }
+  if (num_read != n) {
+    fprintf(stderr, "Read only %lu input elements, not %lu.\n", num_read, n);
+    return false;
+  }
+  if (!at_end) {
+    fprintf(stderr, "Input not empty afer reading %lu complex numbers.\n", n);
+    return false;
+  }
+
+  owned_data_.resize(n);
+  for (size_t ii = 0; ii < n; ++ii) {
+    owned_data_[ii] = std::complex<double>(float_data_[ii]);
+  }
+  size_ = n;
+  return true;
+}
+
+void InputSignal::MakeFloatCopy() {
+  if (float_data_.size() == size_) {
+    return;
+  }
+  const std::complex<double>* signal = data();
+  float_data_.resize(size_);
+  for (size_t ii = 0; ii < size_; ++ii) {
+    float_data_[ii] = std::complex<float>(signal[ii]);
+  }
+}
+
+bool InputSignal::ReadText(std::istream* input, size_t n) {
+  Release();
+  owned_data_.resize(n);
+  for (size_t ii = 0; ii < n; ++ii) {
+    if (!((*input) >> owned_data_[ii])) {
+      fprintf(stderr, "Could not read element %lu from stdin.\n", ii);
+      return false;
+    }
+  }
+  size_ = n;
+  return true;
+}
+
+void InputSignal::Prefetch() const {
+  if (mapped_data_ != nullptr) {
+    madvise(mapped_data_, mapped_length_, MADV_WILLNEED);
+  }
+}
+
+void InputSignal::Release() {
+  if (mapped_data_ != nullptr) {
+    munmap(mapped_data_, mapped_length_);
+    mapped_data_ = nullptr;
+    mapped_length_ = 0;
+  }
+  owned_data_.clear();
+  owned_data_.shrink_to_fit();
+  float_data_.clear();
+  float_data_.shrink_to_fit();
+  size_ = 0;
+}
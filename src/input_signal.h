@@ -0,0 +1,79 @@
+#ifndef __INPUT_SIGNAL_H__
+#define __INPUT_SIGNAL_H__
+
+#include <complex>
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Read-only view of an input signal. Binary input files are memory-mapped so
+// that the data is neither copied into a separate buffer when it is read nor
+// when it is passed to the FFT implementations. Inputs that cannot be mapped
+// (text input or non-regular files) are stored in an owned buffer instead,
+// as are signal containers (signal_container.h), which are decompressed.
+class InputSignal {
+ public:
+  InputSignal() : mapped_data_(nullptr), mapped_length_(0), size_(0) {}
+
+  // Maps a binary file containing exactly n complex doubles. Falls back to
+  // reading the file into an owned buffer if the file cannot be mapped. If
+  // the file is a signal container, it is decompressed (in parallel) into an
+  // owned buffer.
+  bool MapBinaryFile(const std::string& filename, size_t n);
+
+  // Reads a binary file containing exactly n complex floats. The signal is
+  // available in single precision (float_data) and, converted, in double
+  // precision (data).
+  bool ReadFloatBinaryFile(const std::string& filename, size_t n);
+
+  // Reads n complex numbers in text format.
+  bool ReadText(std::istream* input, size_t n);
+
+  // Asks the kernel to read the whole file ahead of time. This is
+  // asynchronous and can be used to overlap I/O with computation on a
+  // previous input.
+  void Prefetch() const;
+
+  const std::complex<double>* data() const {
+    if (mapped_data_ != nullptr) {
+      return static_cast<const std::complex<double>*>(mapped_data_);
+    }
+    return owned_data_.data();
+  }
+
+  // Creates the single precision copy of the signal for float_data (unless
+  // it already exists).
+  void MakeFloatCopy();
+
+  // The signal in single precision (only after ReadFloatBinaryFile or
+  // MakeFloatCopy).
+  const std::complex<float>* float_data() const {
+    return float_data_.data();
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  void Release();
+
+  ~InputSignal() {
+    Release();
+  }
+
+ private:
+  void* mapped_data_;
+  size_t mapped_length_;
+  std::vector<std::complex<double>> owned_data_;
+  std::vector<std::complex<float>> float_data_;
+  size_t size_;
+
+  bool ReadBinaryFile(FILE* file, size_t n);
+  bool ReadContainerFile(int fd, size_t length, size_t n);
+
+  InputSignal(const InputSignal&) = delete;
+  InputSignal& operator=(const InputSignal&) = delete;
+};
+
+#endif
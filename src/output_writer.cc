@@ -6,7 +6,6 @@
 #include "helpers.h"
 
 using std::complex;
-using std::endl;
 using std::ostream;
 using std::ostringstream;
 using std::scientific;
@@ -35,9 +34,9 @@ bool OutputWriter::WritePrelude(const string& command) {
   if (!oref.good()) {
     return false;
   }
-  oref << "{" << endl;
-  oref << "  \"command\": \"" << command << "\"," << endl;
-  oref << "  \"results\": {" << endl;
+  oref << "{\n";
+  oref << "  \"command\": \"" << command << "\",\n";
+  oref << "  \"results\": {\n";
   return oref.good();
 }
 
@@ -51,8 +50,9 @@ bool OutputWriter::WriteEnd() {
   if (!oref.good()) {
     return false;
   }
-  oref << "  }" << endl;
-  oref << "}" << endl;
+  oref << "  }\n";
+  oref << "}\n";
+  oref.flush();
   return oref.good();
 }
 
@@ -61,66 +61,156 @@ void OutputWriter::WriteSignalStatistics(const SignalStatistics& stats,
   WriteStatisticsJSONToStream(stats, indent, out_);
 }
 
-bool OutputWriter::WriteInputResult(const string& input_name,
-                                    const vector<dcomplex>& input_data,
-                                    const vector<dcomplex>& ref_output,
-                                    double reference_time,
-                                    const std::vector<RunResult>& results,
-                                    bool is_last) {
+bool OutputWriter::WriteInputHeader(const string& input_name,
+                                    const dcomplex* input_data,
+                                    size_t input_size,
+                                    const ReferenceSummary& reference,
+                                    double reference_time) {
   SignalStatistics input_stats;
-  ComputeSignalStatistics(input_data, l0_epsilon_, &input_stats);
+  ComputeSignalStatistics(input_data, input_size, l0_epsilon_, &input_stats);
   SignalStatistics ref_output_stats;
-  ComputeSignalStatistics(ref_output, l0_epsilon_, &ref_output_stats);
+  ComputeReferenceStatistics(reference, l0_epsilon_, &ref_output_stats);
 
-  vector<dcomplex> best_k_term;
-  ComputeBestKTermRepresentation(ref_output, k_, &best_k_term);
   SignalStatistics best_k_term_stats;
-  ComputeSignalStatistics(best_k_term, l0_epsilon_, &best_k_term_stats);
   SignalStatistics best_k_term_error_stats;
-  ComputeErrorStatistics(best_k_term, ref_output, l0_epsilon_,
-      &best_k_term_error_stats);
+  ComputeBestKTermStatistics(reference, k_, l0_epsilon_, &best_k_term_stats,
+                             &best_k_term_error_stats);
 
   ostream& oref = *out_;
   if (!oref.good()) {
     return false;
   }
-  oref << "    \"" << input_name << "\": {" << endl;
-  oref << "      \"input_stats\": {" << endl;
+  oref << "    \"" << input_name << "\": {\n";
+  oref << "      \"input_stats\": {\n";
   WriteSignalStatistics(input_stats, 8);
-  oref << "      }," << endl;
-  oref << "      \"reference_time\": " << scientific << reference_time << ","
-       << endl;
-  oref << "      \"reference_output_stats\": {" << endl;
+  oref << "      },\n";
+  oref << "      \"reference_time\": " << scientific << reference_time
+       << ",\n";
+  oref << "      \"reference_output_stats\": {\n";
   WriteSignalStatistics(ref_output_stats, 8);
-  oref << "      }," << endl;
-  oref << "      \"best_k_term_stats\": {" << endl;
+  oref << "      },\n";
+  oref << "      \"best_k_term_stats\": {\n";
   WriteSignalStatistics(best_k_term_stats, 8);
-  oref << "      }," << endl;
-  oref << "      \"best_k_term_error_stats\": {" << endl;
+  oref << "      },\n";
+  oref << "      \"best_k_term_error_stats\": {\n";
   WriteSignalStatistics(best_k_term_error_stats, 8);
-  oref << "      }," << endl;
-  oref << "      \"results\": [" << endl;
+  oref << "      },\n";
+  return oref.good();
+}
+
+void OutputWriter::WriteRunResults(const vector<RunResult>& results,
+                                   size_t indent) {
+  ostream& oref = *out_;
+  string ind(indent, ' ');
   for (size_t ii = 0; ii < results.size(); ++ii) {
-    oref << "        {" << endl;
-    oref << "          \"running_time\": " << scientific << results[ii].time
-         << "," << endl;
-    oref << "          \"error_stats\": {" << endl;
-    WriteSignalStatistics(results[ii].error_statistics, 12);
-    oref << "          }," << endl;
-    oref << "          \"topk_error_stats\": {" << endl;
-    WriteSignalStatistics(results[ii].topk_error_statistics, 12);
-    oref << "          }," << endl;
-    oref << "          \"output_stats\": {" << endl;
-    WriteSignalStatistics(results[ii].output_statistics, 12);
-    oref << "          }" << endl;
-    oref << "        }" << (ii != results.size() - 1 ? "," : "") << endl;
+    oref << ind << "{\n";
+    oref << ind << "  \"running_time\": " << scientific << results[ii].time
+         << ",\n";
+    oref << ind << "  \"error_stats\": {\n";
+    WriteSignalStatistics(results[ii].error_statistics, indent + 4);
+    oref << ind << "  },\n";
+    oref << ind << "  \"topk_error_stats\": {\n";
+    WriteSignalStatistics(results[ii].topk_error_statistics, indent + 4);
+    oref << ind << "  },\n";
+    oref << ind << "  \"output_stats\": {\n";
+    WriteSignalStatistics(results[ii].output_statistics, indent + 4);
+    const PerfCounterValues& perf = results[ii].perf_counters;
+    if (perf.valid) {
+      oref << ind << "  },\n";
+      oref << ind << "  \"perf_counters\": {\n";
+      for (int event = 0; event < NUM_PERF_EVENTS; ++event) {
+        if (perf.counts[event] >= 0) {
+          oref << ind << "    \"" << PerfEventName(PerfEvent(event))
+               << "\": " << perf.counts[event] << ",\n";
+        }
+      }
+      oref << ind << "    \"running_fraction\": " << scientific
+           << perf.running_fraction << '\n';
+    }
+    const PhaseTimes& phases = results[ii].phase_times;
+    if (phases.valid) {
+      oref << ind << "  },\n";
+      oref << ind << "  \"phase_times\": {\n";
+      for (int phase = 0; phase < NUM_PHASES; ++phase) {
+        oref << ind << "    \"" << PhaseName(Phase(phase)) << "\": "
+             << scientific << phases.times[phase]
+             << (phase != NUM_PHASES - 1 ? "," : "") << '\n';
+      }
+    }
+    oref << ind << "  }\n";
+    oref << ind << "}" << (ii != results.size() - 1 ? "," : "") << '\n';
   }
-  oref << "      ]\n" << endl;
-  oref << "    }" << (is_last ? "" : ",") << endl;
+}
+
+bool OutputWriter::WriteInputResult(const string& input_name,
+                                    const dcomplex* input_data,
+                                    size_t input_size,
+                                    const ReferenceSummary& reference,
+                                    double reference_time,
+                                    const std::vector<RunResult>& results,
+                                    const TimingStatistics& timing,
+                                    bool is_last) {
+  if (!WriteInputHeader(input_name, input_data, input_size, reference,
+                        reference_time)) {
+    return false;
+  }
+  ostream& oref = *out_;
+  oref << "      \"results\": [\n";
+  WriteRunResults(results, 8);
+  oref << "      ],\n";
+  oref << "      \"timing_stats\": {\n";
+  WriteTimingStatisticsJSONToStream(timing, 8, out_);
+  oref << "      }\n";
+  oref << "    }" << (is_last ? "" : ",") << '\n';
+  oref.flush();
 
   return oref.good();
 }
 
+bool OutputWriter::WriteInputResults(const string& input_name,
+    const dcomplex* input_data,
+    size_t input_size,
+    const ReferenceSummary& reference,
+    double reference_time,
+    const vector<string>& algorithms,
+    const vector<vector<RunResult>>& results,
+    const vector<TimingStatistics>& timing,
+    bool is_last) {
+  if (!WriteInputHeader(input_name, input_data, input_size, reference,
+                        reference_time)) {
+    return false;
+  }
+  ostream& oref = *out_;
+  oref << "      \"algorithm_results\": {\n";
+  for (size_t ii = 0; ii < algorithms.size(); ++ii) {
+    oref << "        \"" << algorithms[ii] << "\": [\n";
+    WriteRunResults(results[ii], 10);
+    oref << "        ]" << (ii != algorithms.size() - 1 ? "," : "") << '\n';
+  }
+  oref << "      },\n";
+  oref << "      \"algorithm_timing_stats\": {\n";
+  for (size_t ii = 0; ii < algorithms.size(); ++ii) {
+    oref << "        \"" << algorithms[ii] << "\": {\n";
+    WriteTimingStatisticsJSONToStream(timing[ii], 10, out_);
+    oref << "        }" << (ii != algorithms.size() - 1 ? "," : "") << '\n';
+  }
+  oref << "      }\n";
+  oref << "    }" << (is_last ? "" : ",") << '\n';
+  oref.flush();
+
+  return oref.good();
+}
+
+bool OutputWriter::WriteFormattedInputResult(const string& formatted) {
+  ostream& oref = *out_;
+  if (!oref.good()) {
+    return false;
+  }
+  oref << formatted;
+  oref.flush();
+  return oref.good();
+}
+
 OutputWriter::~OutputWriter() {
   if (delete_ostream_) {
     delete out_;
@@ -7,8 +7,10 @@
 #include <vector>
 
 #include "result_helpers.h"
+#include "results_writer.h"
+#include "timing_statistics.h"
 
-class OutputWriter {
+class OutputWriter : public ResultsWriter {
  public:
   OutputWriter(std::ostream* out, size_t k, double l0_epsilon) : out_(out),
       delete_ostream_(false), k_(k), l0_epsilon_(l0_epsilon) {}
@@ -20,13 +22,36 @@ class OutputWriter {
   bool WritePrelude(const std::string& command);
   bool WritePrelude(int argc, char** argv);
 
+  // The results of each input are flushed after the input, but not within an
+  // input.
   bool WriteInputResult(const std::string& input_name,
-                        const std::vector<std::complex<double>>& input_data,
-                        const std::vector<std::complex<double>>& ref_output,
+                        const std::complex<double>* input_data,
+                        size_t input_size,
+                        const ReferenceSummary& reference,
                         double reference_time,
                         const std::vector<RunResult>& results,
+                        const TimingStatistics& timing,
                         bool is_last);
 
+  // Writes the results of several algorithms on the same input. results[i]
+  // and timing[i] contain the trials of algorithms[i]. The per-algorithm
+  // trials are written to an "algorithm_results" object instead of a
+  // "results" list, and the timing statistics to "algorithm_timing_stats".
+  bool WriteInputResults(const std::string& input_name,
+                         const std::complex<double>* input_data,
+                         size_t input_size,
+                         const ReferenceSummary& reference,
+                         double reference_time,
+                         const std::vector<std::string>& algorithms,
+                         const std::vector<std::vector<RunResult>>& results,
+                         const std::vector<TimingStatistics>& timing,
+                         bool is_last);
+
+  // Writes an input result that was formatted by another OutputWriter (e.g.,
+  // one writing to a string stream in a worker thread). The formatted result
+  // must have been written with the correct is_last flag.
+  bool WriteFormattedInputResult(const std::string& formatted);
+
   bool WriteEnd();
 
  private:
@@ -36,6 +61,12 @@ class OutputWriter {
   double l0_epsilon_;
 
   void WriteSignalStatistics(const SignalStatistics& stats, size_t indent);
+  bool WriteInputHeader(const std::string& input_name,
+                        const std::complex<double>* input_data,
+                        size_t input_size,
+                        const ReferenceSummary& reference,
+                        double reference_time);
+  void WriteRunResults(const std::vector<RunResult>& results, size_t indent);
 };
 
 
@@ -0,0 +1,172 @@
+#include "perf_counters.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+thread_local PerfCounters* current_counters = nullptr;
+
+void SetEventConfig(PerfEvent event, perf_event_attr* attr) {
+  const uint64_t kReadMiss = PERF_COUNT_HW_CACHE_OP_READ << 8
+      | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+  switch (event) {
+    case PERF_CYCLES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case PERF_INSTRUCTIONS:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case PERF_L1D_READ_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_L1D | kReadMiss;
+      break;
+    case PERF_LLC_MISSES:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    case PERF_DTLB_READ_MISSES:
+      attr->type = PERF_TYPE_HW_CACHE;
+      attr->config = PERF_COUNT_HW_CACHE_DTLB | kReadMiss;
+      break;
+    case PERF_BRANCH_MISSES:
+    default:
+      attr->type = PERF_TYPE_HARDWARE;
+      attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+  }
+}
+
+int OpenEvent(PerfEvent event, int group_fd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  SetEventConfig(event, &attr);
+  attr.disabled = (group_fd == -1 ? 1 : 0);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED
+      | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+}  // namespace
+
+const char* PerfEventName(PerfEvent event) {
+  switch (event) {
+    case PERF_CYCLES:
+      return "cycles";
+    case PERF_INSTRUCTIONS:
+      return "instructions";
+    case PERF_L1D_READ_MISSES:
+      return "l1d_read_misses";
+    case PERF_LLC_MISSES:
+      return "llc_misses";
+    case PERF_DTLB_READ_MISSES:
+      return "dtlb_read_misses";
+    case PERF_BRANCH_MISSES:
+      return "branch_misses";
+    default:
+      return "unknown";
+  }
+}
+
+PerfCounters::PerfCounters() : num_fds_(0) {
+  last_values_.valid = false;
+}
+
+bool PerfCounters::Open() {
+  for (int ii = 0; ii < NUM_PERF_EVENTS; ++ii) {
+    PerfEvent event = static_cast<PerfEvent>(ii);
+    int fd = OpenEvent(event, num_fds_ == 0 ? -1 : fds_[0]);
+    if (fd >= 0) {
+      fds_[num_fds_] = fd;
+      group_events_[num_fds_] = event;
+      ++num_fds_;
+    }
+  }
+  if (num_fds_ == 0) {
+    static std::atomic<bool> warned(false);
+    if (!warned.exchange(true)) {
+      fprintf(stderr, "Warning: hardware performance counters are not "
+          "available (perf_event_open failed), continuing without them.\n");
+    }
+    return false;
+  }
+  return true;
+}
+
+void PerfCounters::SetCurrent(PerfCounters* counters) {
+  current_counters = counters;
+}
+
+void PerfCounters::StartRegion() {
+  if (current_counters != nullptr) {
+    current_counters->Start();
+  }
+}
+
+void PerfCounters::StopRegion() {
+  if (current_counters != nullptr) {
+    current_counters->Stop();
+  }
+}
+
+void PerfCounters::GetLastValues(PerfCounterValues* values) {
+  if (current_counters == nullptr) {
+    values->valid = false;
+  } else {
+    *values = current_counters->last_values_;
+  }
+}
+
+void PerfCounters::Start() {
+  if (num_fds_ == 0) {
+    return;
+  }
+  ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::Stop() {
+  last_values_.valid = false;
+  if (num_fds_ == 0) {
+    return;
+  }
+  ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  // Layout for PERF_FORMAT_GROUP: nr, time_enabled, time_running, values.
+  uint64_t buffer[3 + NUM_PERF_EVENTS];
+  ssize_t size = read(fds_[0], buffer, sizeof(buffer));
+  if (size < static_cast<ssize_t>(3 * sizeof(uint64_t))
+      || buffer[0] != num_fds_ || buffer[2] == 0) {
+    return;
+  }
+  double running_fraction = static_cast<double>(buffer[2]) / buffer[1];
+  for (int ii = 0; ii < NUM_PERF_EVENTS; ++ii) {
+    last_values_.counts[ii] = -1;
+  }
+  for (size_t ii = 0; ii < num_fds_; ++ii) {
+    last_values_.counts[group_events_[ii]] =
+        static_cast<int64_t>(buffer[3 + ii] / running_fraction + 0.5);
+  }
+  last_values_.running_fraction = running_fraction;
+  last_values_.valid = true;
+}
+
+PerfCounters::~PerfCounters() {
+  if (current_counters == this) {
+    current_counters = nullptr;
+  }
+  for (size_t ii = 0; ii < num_fds_; ++ii) {
+    close(fds_[ii]);
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include <cstddef>
+#include <cstdint>
+
+enum PerfEvent {
+  PERF_CYCLES = 0,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_READ_MISSES,
+  PERF_LLC_MISSES,
+  PERF_DTLB_READ_MISSES,
+  PERF_BRANCH_MISSES,
+  NUM_PERF_EVENTS
+};
+
+// Name of the event in the JSON output.
+const char* PerfEventName(PerfEvent event);
+
+struct PerfCounterValues {
+  // False if no counters were recorded (disabled or unavailable).
+  bool valid;
+  // Fraction of the region during which the counters were scheduled on the
+  // PMU. If it is below 1 (the kernel multiplexed the counters), the counts
+  // are extrapolated.
+  double running_fraction;
+  // -1 for events that are not supported on this machine.
+  int64_t counts[NUM_PERF_EVENTS];
+};
+
+// Hardware performance counters (via perf_event_open) for the timed region of
+// the FFT interfaces. The counters of a thread are registered with SetCurrent;
+// the FFT interfaces then bracket their timed region with StartRegion and
+// StopRegion, which do nothing if the thread has no current counters.
+//
+// Only the calling thread is counted (not threads started by the algorithm,
+// e.g., in fftw-mt), and only user-space events.
+class PerfCounters {
+ public:
+  PerfCounters();
+
+  // Opens the counters for the calling thread. Events that are not supported
+  // are skipped. Returns false (and prints a warning once per process) if no
+  // counter is available, e.g., because of perf_event_paranoid or in a
+  // container without the required permissions.
+  bool Open();
+
+  static void SetCurrent(PerfCounters* counters);
+
+  static void StartRegion();
+  static void StopRegion();
+
+  // The values of the last region of the calling thread. values->valid is
+  // false if the thread has no current counters.
+  static void GetLastValues(PerfCounterValues* values);
+
+  ~PerfCounters();
+
+ private:
+  // File descriptors in group order; group_events_ contains the event of
+  // each file descriptor. The first one is the group leader.
+  int fds_[NUM_PERF_EVENTS];
+  PerfEvent group_events_[NUM_PERF_EVENTS];
+  size_t num_fds_;
+  PerfCounterValues last_values_;
+
+  void Start();
+  void Stop();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+};
+
+#endif
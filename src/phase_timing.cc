@@ -0,0 +1,193 @@
+#include "phase_timing.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Maps a timer name of the SFFT-MIT library (step label or column of the
+// time distribution table) to a phase. Returns NUM_PHASES for unknown names.
+Phase PhaseFromTimerName(const string& name) {
+  string upper(name);
+  for (size_t ii = 0; ii < upper.size(); ++ii) {
+    upper[ii] = toupper(upper[ii]);
+  }
+  if (upper.find("PERM") != string::npos) {
+    return PHASE_PERMUTE_FILTER;
+  } else if (upper.find("FFT") != string::npos) {
+    return PHASE_BUCKET_FFT;
+  } else if (upper.find("ESTIM") != string::npos) {
+    return PHASE_ESTIMATION;
+  } else if (upper.find("LOCAT") != string::npos
+             || upper.find("SCORE") != string::npos
+             || upper.find("COMB") != string::npos
+             || upper.find("GROUP") != string::npos) {
+    return PHASE_LOCATION;
+  }
+  return NUM_PHASES;
+}
+
+// Parses a number, skipping leading separator characters such as "---".
+bool ParseNumber(const string& token, double* value) {
+  size_t start = 0;
+  while (start < token.size() && !isdigit(token[start])
+         && token[start] != '.') {
+    ++start;
+  }
+  if (start == token.size()) {
+    return false;
+  }
+  const char* begin = token.c_str() + start;
+  char* end;
+  *value = strtod(begin, &end);
+  return end != begin && *end == '\0';
+}
+
+vector<string> SplitWhitespace(const string& line) {
+  std::istringstream in(line);
+  vector<string> tokens;
+  string token;
+  while (in >> token) {
+    tokens.push_back(token);
+  }
+  return tokens;
+}
+
+}  // namespace
+
+const char* PhaseName(Phase phase) {
+  switch (phase) {
+    case PHASE_PERMUTE_FILTER:
+      return "permute_filter";
+    case PHASE_BUCKET_FFT:
+      return "bucket_fft";
+    case PHASE_LOCATION:
+      return "location";
+    case PHASE_ESTIMATION:
+      return "estimation";
+    default:
+      return "unknown";
+  }
+}
+
+PhaseTimes::PhaseTimes() : valid(false) {
+  for (int ii = 0; ii < NUM_PHASES; ++ii) {
+    times[ii] = 0.0;
+  }
+}
+
+bool ParseSFFTMITTimingOutput(const string& text, PhaseTimes* times) {
+  double step_times[NUM_PHASES] = {0.0};
+  bool has_step[NUM_PHASES] = {false};
+  double table_times[NUM_PHASES] = {0.0};
+  bool has_table[NUM_PHASES] = {false};
+
+  std::istringstream in(text);
+  string line;
+  vector<string> columns;
+  while (std::getline(in, line)) {
+    const string kTableHeader = "Time distribution:";
+    size_t header_pos = line.find(kTableHeader);
+    if (header_pos != string::npos) {
+      columns = SplitWhitespace(line.substr(header_pos
+                                            + kTableHeader.size()));
+      continue;
+    }
+
+    vector<string> tokens = SplitWhitespace(line);
+    if (!columns.empty()) {
+      // The first line after the header contains the times in seconds (the
+      // next one the percentages, which we ignore).
+      if (tokens.size() == columns.size()) {
+        for (size_t ii = 0; ii < columns.size(); ++ii) {
+          double value;
+          Phase phase = PhaseFromTimerName(columns[ii]);
+          if (phase != NUM_PHASES && ParseNumber(tokens[ii], &value)) {
+            table_times[phase] += value;
+            has_table[phase] = true;
+          }
+        }
+      }
+      columns.clear();
+      continue;
+    }
+
+    size_t open = line.find('(');
+    size_t close = line.find(')', open);
+    if (open == string::npos || close == string::npos || tokens.empty()) {
+      continue;
+    }
+    Phase phase = PhaseFromTimerName(line.substr(open + 1, close - open - 1));
+    double value;
+    if (phase != NUM_PHASES && ParseNumber(tokens.back(), &value)) {
+      step_times[phase] += value;
+      has_step[phase] = true;
+    }
+  }
+
+  times->valid = false;
+  for (int ii = 0; ii < NUM_PHASES; ++ii) {
+    if (has_step[ii]) {
+      times->times[ii] = step_times[ii];
+    } else if (has_table[ii]) {
+      times->times[ii] = table_times[ii];
+    } else {
+      times->times[ii] = 0.0;
+      continue;
+    }
+    times->valid = true;
+  }
+  return times->valid;
+}
+
+bool StdoutCapture::Start() {
+  fflush(stdout);
+  file_ = tmpfile();
+  if (file_ == nullptr) {
+    return false;
+  }
+  saved_fd_ = dup(STDOUT_FILENO);
+  if (saved_fd_ < 0 || dup2(fileno(file_), STDOUT_FILENO) < 0) {
+    if (saved_fd_ >= 0) {
+      close(saved_fd_);
+      saved_fd_ = -1;
+    }
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool StdoutCapture::Stop(string* captured) {
+  if (file_ == nullptr) {
+    return false;
+  }
+  fflush(stdout);
+  dup2(saved_fd_, STDOUT_FILENO);
+  close(saved_fd_);
+  saved_fd_ = -1;
+
+  captured->clear();
+  rewind(file_);
+  char buffer[4096];
+  size_t num_read;
+  while ((num_read = fread(buffer, 1, sizeof(buffer), file_)) > 0) {
+    captured->append(buffer, num_read);
+  }
+  fclose(file_);
+  file_ = nullptr;
+  return true;
+}
+
+StdoutCapture::~StdoutCapture() {
+  string ignored;
+  Stop(&ignored);
+}
@@ -0,0 +1,59 @@
+#ifndef __PHASE_TIMING_H__
+#define __PHASE_TIMING_H__
+
+#include <cstdio>
+#include <string>
+
+// The phases of a sparse FFT trial.
+enum Phase {
+  // Permuting the input and multiplying it with the filter into B buckets.
+  PHASE_PERMUTE_FILTER = 0,
+  // The B-dimensional FFTs of the buckets.
+  PHASE_BUCKET_FFT,
+  // Finding the candidate frequencies (voting / score table, comb filter).
+  PHASE_LOCATION,
+  // Estimating the values of the located frequencies.
+  PHASE_ESTIMATION,
+  NUM_PHASES
+};
+
+// Name of the phase in the JSON output.
+const char* PhaseName(Phase phase);
+
+struct PhaseTimes {
+  PhaseTimes();
+
+  // False if the algorithm does not report phase times (or phase timing is
+  // disabled).
+  bool valid;
+  // Seconds spent in each phase, summed over all loops of the trial.
+  double times[NUM_PHASES];
+};
+
+// Parses the timers that the SFFT-MIT library prints to stdout when
+// sfft_mit::TIMING is set. Per-loop step lines of the form
+// "Step 1.A (PERM + FILTER): <seconds>" are summed per phase; the
+// "Time distribution:" table printed at the end of outer_loop fills the
+// phases that have no step lines. Returns false if no timer was found.
+bool ParseSFFTMITTimingOutput(const std::string& text, PhaseTimes* times);
+
+// Redirects the stdout file descriptor of the process to a temporary file
+// between Start and Stop. Since the file descriptor is shared by all threads,
+// at most one capture may be active at a time.
+class StdoutCapture {
+ public:
+  StdoutCapture() : saved_fd_(-1), file_(nullptr) {}
+
+  bool Start();
+
+  // Restores stdout and returns everything written since Start.
+  bool Stop(std::string* captured);
+
+  ~StdoutCapture();
+
+ private:
+  int saved_fd_;
+  FILE* file_;
+};
+
+#endif
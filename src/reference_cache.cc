@@ -0,0 +1,199 @@
+#include "reference_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'S', 'F', 'T', 'R', 'E', 'F', '0', '1'};
+
+// Finalizer of the splitmix64 generator.
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t DoubleBits(double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+uint64_t KeyHash(const ReferenceCache::Key& key) {
+  uint64_t h = Mix(key.input_hash);
+  h = Mix(h ^ key.n);
+  // 1D keys hash as before, so existing entries stay valid.
+  if (key.rows != 1) {
+    h = Mix(h ^ key.rows);
+  }
+  h = Mix(h ^ key.k);
+  h = Mix(h ^ DoubleBits(key.l0_epsilon));
+  h = Mix(h ^ (key.rounded_real_output ? 1 : 0));
+  return h;
+}
+
+// File header. All entries are stored in native byte order.
+struct Header {
+  char magic[8];
+  uint64_t key_hash;
+  uint64_t n;
+  uint64_t k;
+  double l0_epsilon;
+  uint64_t rounded_real_output;
+  double reference_time;
+  uint64_t head_size;
+  uint64_t tail_linf_index;
+  uint64_t tail_l0;
+  double tail_l1;
+  double tail_l2;
+  double tail_linf;
+};
+
+}  // namespace
+
+uint64_t ReferenceCache::HashInput(const std::complex<double>* data,
+                                   size_t n) {
+  // Four independent multiply-xor lanes over the 64-bit words of the input.
+  const double* words = reinterpret_cast<const double*>(data);
+  size_t num_words = 2 * n;
+  uint64_t lanes[4] = {0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL,
+                       0xa4093822299f31d0ULL, 0x082efa98ec4e6c89ULL};
+  const uint64_t kPrime = 0x100000001b3ULL;
+  size_t ii = 0;
+  for (; ii + 4 <= num_words; ii += 4) {
+    for (int lane = 0; lane < 4; ++lane) {
+      lanes[lane] = (lanes[lane] ^ DoubleBits(words[ii + lane])) * kPrime;
+    }
+  }
+  for (; ii < num_words; ++ii) {
+    lanes[0] = (lanes[0] ^ DoubleBits(words[ii])) * kPrime;
+  }
+  uint64_t h = Mix(n);
+  for (int lane = 0; lane < 4; ++lane) {
+    h = Mix(h ^ lanes[lane]);
+  }
+  return h;
+}
+
+std::string ReferenceCache::GetFilename(const Key& key) const {
+  std::ostringstream name;
+  name << directory_ << "/reference_n_" << key.n << "_k_" << key.k << "_"
+       << std::hex << KeyHash(key) << ".bin";
+  return name.str();
+}
+
+bool ReferenceCache::Load(const Key& key,
+                          ReferenceSummary* summary,
+                          double* reference_time) const {
+  if (!enabled()) {
+    return false;
+  }
+  std::string filename = GetFilename(key);
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == nullptr) {
+    return false;
+  }
+
+  Header header;
+  bool valid = (fread(&header, sizeof(header), 1, file) == 1)
+      && memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+      && header.key_hash == KeyHash(key)
+      && header.n == key.n
+      && header.k == key.k
+      && header.l0_epsilon == key.l0_epsilon
+      && header.rounded_real_output == (key.rounded_real_output ? 1u : 0u)
+      && header.head_size <= header.n;
+
+  std::vector<uint64_t> indices;
+  std::vector<std::complex<double>> values;
+  if (valid) {
+    indices.resize(header.head_size);
+    values.resize(header.head_size);
+    valid = (fread(indices.data(), sizeof(uint64_t), indices.size(), file)
+                 == indices.size())
+        && (fread(values.data(), sizeof(std::complex<double>), values.size(),
+                  file) == values.size());
+  }
+  fclose(file);
+  if (!valid) {
+    fprintf(stderr, "Ignoring invalid reference cache entry %s.\n",
+        filename.c_str());
+    return false;
+  }
+
+  summary->n = header.n;
+  summary->head.Clear();
+  for (size_t ii = 0; ii < indices.size(); ++ii) {
+    summary->head.Add(indices[ii], values[ii]);
+  }
+  summary->head_by_index = summary->head;
+  summary->head_by_index.Normalize();
+  summary->tail_linf_index = header.tail_linf_index;
+  summary->tail_statistics.l0 = header.tail_l0;
+  summary->tail_statistics.l1 = header.tail_l1;
+  summary->tail_statistics.l2 = header.tail_l2;
+  summary->tail_statistics.linf = header.tail_linf;
+  *reference_time = header.reference_time;
+  return true;
+}
+
+bool ReferenceCache::Store(const Key& key,
+                           const ReferenceSummary& summary,
+                           double reference_time) const {
+  if (!enabled()) {
+    return false;
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.key_hash = KeyHash(key);
+  header.n = key.n;
+  header.k = key.k;
+  header.l0_epsilon = key.l0_epsilon;
+  header.rounded_real_output = (key.rounded_real_output ? 1 : 0);
+  header.reference_time = reference_time;
+  header.head_size = summary.head.size();
+  header.tail_linf_index = summary.tail_linf_index;
+  header.tail_l0 = summary.tail_statistics.l0;
+  header.tail_l1 = summary.tail_statistics.l1;
+  header.tail_l2 = summary.tail_statistics.l2;
+  header.tail_linf = summary.tail_statistics.linf;
+
+  std::vector<uint64_t> indices(summary.head.indices.begin(),
+                                summary.head.indices.end());
+
+  std::string filename = GetFilename(key);
+  std::ostringstream tmp_name;
+  tmp_name << filename << ".tmp." << getpid() << "."
+           << std::this_thread::get_id();
+  FILE* file = fopen(tmp_name.str().c_str(), "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "Could not open file %s.\n", tmp_name.str().c_str());
+    return false;
+  }
+  bool success = (fwrite(&header, sizeof(header), 1, file) == 1)
+      && (fwrite(indices.data(), sizeof(uint64_t), indices.size(), file)
+              == indices.size())
+      && (fwrite(summary.head.values.data(), sizeof(std::complex<double>),
+                 summary.head.size(), file) == summary.head.size());
+  if (fclose(file) != 0) {
+    success = false;
+  }
+  if (!success || rename(tmp_name.str().c_str(), filename.c_str()) != 0) {
+    fprintf(stderr, "Could not write reference cache entry %s.\n",
+        filename.c_str());
+    remove(tmp_name.str().c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,57 @@
+#ifndef __REFERENCE_CACHE_H__
+#define __REFERENCE_CACHE_H__
+
+#include <complex>
+#include <cstdint>
+#include <string>
+
+#include "result_helpers.h"
+
+// Persistent cache for reference summaries (see ReferenceSummary). When
+// several algorithms are run on the same inputs, only the first run has to
+// compute the reference FFT; later runs load the summary from a small binary
+// sidecar file in the cache directory.
+//
+// Entries are keyed by a hash of the input data together with all parameters
+// that influence the summary (n, the number of rows of 2D signals, k,
+// l0_epsilon, and whether the reference is rounded to real values). Files are
+// written to a temporary file first and then renamed, so concurrent runs never
+// see partially written entries.
+class ReferenceCache {
+ public:
+  struct Key {
+    uint64_t input_hash;
+    size_t n;
+    // Number of rows (1 for 1D signals).
+    size_t rows;
+    size_t k;
+    double l0_epsilon;
+    bool rounded_real_output;
+  };
+
+  // An empty directory disables the cache.
+  explicit ReferenceCache(const std::string& directory)
+      : directory_(directory) {}
+
+  bool enabled() const {
+    return !directory_.empty();
+  }
+
+  static uint64_t HashInput(const std::complex<double>* data, size_t n);
+
+  // Returns false if there is no (valid) entry for the key.
+  bool Load(const Key& key,
+            ReferenceSummary* summary,
+            double* reference_time) const;
+
+  bool Store(const Key& key,
+             const ReferenceSummary& summary,
+             double reference_time) const;
+
+ private:
+  std::string directory_;
+
+  std::string GetFilename(const Key& key) const;
+};
+
+#endif
@@ -2,56 +2,126 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <map>
+#include <utility>
 
 #include "helpers.h"
+#include "statistics_kernels.h"
+#include "top_k.h"
 
-void ComputeSignalStatistics(const std::vector<std::complex<double>>& signal,
-                             double l0_epsilon,
-                             SignalStatistics* stats) {
+namespace {
+
+void AddEntry(double absval, double l0_epsilon, SignalStatistics* stats) {
+  if (absval > l0_epsilon) {
+    ++(stats->l0);
+  }
+  stats->l1 += absval;
+  stats->l2 += absval * absval;
+  stats->linf = std::max(stats->linf, absval);
+}
+
+// Removes an entry previously added with AddEntry (except from linf).
+void RemoveEntry(double absval, double l0_epsilon, SignalStatistics* stats) {
+  if (absval > l0_epsilon) {
+    --(stats->l0);
+  }
+  stats->l1 -= absval;
+  stats->l2 -= absval * absval;
+}
+
+void ClearStatistics(SignalStatistics* stats) {
   stats->l0 = 0;
   stats->l1 = 0.0;
   stats->l2 = 0.0;
   stats->linf = 0.0;
+}
+
+// Adds partial sums to statistics whose l2 field is the squared l2-norm.
+void AddSums(const StatisticsSums& sums, SignalStatistics* stats) {
+  stats->l0 += sums.l0;
+  stats->l1 += sums.l1;
+  stats->l2 += sums.l2_squared;
+  stats->linf = std::max(stats->linf, sums.linf);
+}
 
-  double absval;
-  for (size_t ii = 0; ii < signal.size(); ++ii) {
-    absval = std::abs(signal[ii]);
-    if (absval > l0_epsilon) {
-      ++(stats->l0);
+// Statistics of a - b for two normalized sparse signals.
+void ComputeDifferenceStatistics(const SparseSignal& a,
+                                 const SparseSignal& b,
+                                 double l0_epsilon,
+                                 SignalStatistics* stats) {
+  ClearStatistics(stats);
+  size_t ii = 0;
+  size_t jj = 0;
+  while (ii < a.size() || jj < b.size()) {
+    if (jj == b.size() || (ii < a.size() && a.indices[ii] < b.indices[jj])) {
+      AddEntry(std::abs(a.values[ii]), l0_epsilon, stats);
+      ++ii;
+    } else if (ii == a.size() || b.indices[jj] < a.indices[ii]) {
+      AddEntry(std::abs(b.values[jj]), l0_epsilon, stats);
+      ++jj;
+    } else {
+      AddEntry(std::abs(a.values[ii] - b.values[jj]), l0_epsilon, stats);
+      ++ii;
+      ++jj;
     }
-    stats->l1 += absval;
-    stats->l2 += absval * absval;
-    stats->linf = std::max(stats->linf, absval);
   }
-
   stats->l2 = sqrt(stats->l2);
 }
 
-void ComputeErrorStatistics(const std::vector<std::complex<double>>& output,
-    const std::vector<std::complex<double>>& reference_output,
-    double l0_epsilon, SignalStatistics* stats) {
-  std::vector<std::complex<double>> error(output.size());
-  for (size_t ii = 0; ii < output.size(); ++ii) {
-    error[ii] = reference_output[ii] - output[ii];
+// The best k-term representation of a normalized sparse signal. Since the
+// entries are sorted by index, ties are broken as for dense signals.
+void ComputeBestKTermRepresentation(const SparseSignal& x, size_t k,
+                                    SparseSignal* x_k) {
+  std::vector<size_t> top;
+  SelectTopK(x.values.data(), x.size(), k, &top);
+  x_k->Clear();
+  for (size_t ii = 0; ii < top.size(); ++ii) {
+    x_k->Add(x.indices[top[ii]], x.values[top[ii]]);
   }
-  ComputeSignalStatistics(error, l0_epsilon, stats);
+  x_k->Normalize();
 }
 
-void ComputeTopKErrorStatistics(const std::vector<std::complex<double>>& output,
-    const std::vector<std::complex<double>>& reference_output,
-    double l0_epsilon, int k, SignalStatistics* stats) {
-  std::vector<std::complex<double>> output_topk;
-  ComputeBestKTermRepresentation(output, k, &output_topk);
+// The best k-term representation of the reference, normalized.
+void ComputeBestKTermRepresentation(const ReferenceSummary& reference,
+                                    size_t k, SparseSignal* x_k) {
+  x_k->Clear();
+  for (size_t ii = 0; ii < std::min(k, reference.head.size()); ++ii) {
+    x_k->Add(reference.head.indices[ii], reference.head.values[ii]);
+  }
+  x_k->Normalize();
+}
 
-  std::vector<std::complex<double>> ref_output_topk;
-  ComputeBestKTermRepresentation(reference_output, k, &ref_output_topk);
+}  // namespace
 
-  std::vector<std::complex<double>> error(output.size());
-  for (size_t ii = 0; ii < output.size(); ++ii) {
-    error[ii] = ref_output_topk[ii] - output_topk[ii];
-  }
-  ComputeSignalStatistics(error, l0_epsilon, stats);
+void ComputeSignalStatistics(const std::vector<std::complex<double>>& signal,
+                             double l0_epsilon,
+                             SignalStatistics* stats) {
+  ComputeSignalStatistics(signal.data(), signal.size(), l0_epsilon, stats);
+}
+
+void ComputeSignalStatistics(const std::complex<double>* signal,
+                             size_t n,
+                             double l0_epsilon,
+                             SignalStatistics* stats) {
+  StatisticsSums sums;
+  ComputeStatisticsSums(signal, nullptr, n, l0_epsilon, &sums);
+  stats->l0 = sums.l0;
+  stats->l1 = sums.l1;
+  stats->l2 = sqrt(sums.l2_squared);
+  stats->linf = sums.linf;
+}
+
+void ComputeErrorStatistics(const std::vector<std::complex<double>>& output,
+    const std::vector<std::complex<double>>& reference_output,
+    double l0_epsilon, SignalStatistics* stats) {
+  StatisticsSums sums;
+  ComputeStatisticsSums(reference_output.data(), output.data(), output.size(),
+                        l0_epsilon, &sums);
+  stats->l0 = sums.l0;
+  stats->l1 = sums.l1;
+  stats->l2 = sqrt(sums.l2_squared);
+  stats->linf = sums.linf;
 }
 
 void WriteStatisticsJSONToStream(const SignalStatistics& stats,
@@ -63,29 +133,189 @@ void WriteStatisticsJSONToStream(const SignalStatistics& stats,
     indentation += " ";
   }
 
-  oref << indentation << "\"l0\": " << stats.l0 << "," << std::endl;
+  oref << indentation << "\"l0\": " << stats.l0 << ",\n";
   oref << indentation << "\"l1\": " << std::scientific << stats.l1 << ","
-      << std::endl;
+      << '\n';
   oref << indentation << "\"l2\": " << std::scientific << stats.l2 << ","
-      << std::endl;
+      << '\n';
   oref << indentation << "\"linf\": " << std::scientific << stats.linf
-      << std::endl;
+      << '\n';
+}
+
+void SummarizeReference(const std::vector<std::complex<double>>& reference,
+                        size_t k,
+                        double l0_epsilon,
+                        ReferenceSummary* summary) {
+  size_t n = reference.size();
+  size_t head_size = std::min(n, std::max<size_t>(2 * k, 64));
+  summary->n = n;
+
+  // Select one more entry than the head size: this is the largest entry of
+  // the tail.
+  std::vector<size_t> top;
+  SelectTopK(reference.data(), n, head_size + 1, &top);
+
+  summary->head.Clear();
+  for (size_t ii = 0; ii < head_size; ++ii) {
+    summary->head.Add(top[ii], reference[top[ii]]);
+  }
+  summary->head_by_index = summary->head;
+  summary->head_by_index.Normalize();
+  summary->tail_linf_index = (head_size < n ? top[head_size] : n);
+
+  // The tail consists of the segments between consecutive head entries.
+  ClearStatistics(&(summary->tail_statistics));
+  const std::vector<size_t>& head_indices = summary->head_by_index.indices;
+  size_t begin = 0;
+  for (size_t ii = 0; ii <= head_indices.size(); ++ii) {
+    size_t end = (ii < head_indices.size() ? head_indices[ii] : n);
+    if (end > begin) {
+      StatisticsSums sums;
+      ComputeStatisticsSums(reference.data() + begin, nullptr, end - begin,
+                            l0_epsilon, &sums);
+      AddSums(sums, &(summary->tail_statistics));
+    }
+    begin = end + 1;
+  }
+}
+
+bool ComputeErrorStatistics(const SparseSignal& output,
+    const ReferenceSummary& reference,
+    const std::vector<std::complex<double>>* reference_output,
+    double l0_epsilon, SignalStatistics* stats) {
+  const SparseSignal& head = reference.head_by_index;
+  if (reference_output == nullptr) {
+    std::complex<double> tmp;
+    for (size_t ii = 0; ii < output.size(); ++ii) {
+      if (!head.Find(output.indices[ii], &tmp)) {
+        return false;
+      }
+    }
+  }
+
+  // Start with the error on the tail (where the output is zero) and correct
+  // it for the output entries that fall into the tail.
+  *stats = reference.tail_statistics;
+  stats->linf = 0.0;
+  bool tail_linf_covered = false;
+
+  size_t ii = 0;
+  size_t jj = 0;
+  while (ii < output.size() || jj < head.size()) {
+    if (jj == head.size()
+        || (ii < output.size() && output.indices[ii] < head.indices[jj])) {
+      size_t index = output.indices[ii];
+      const std::complex<double>& ref_value = (*reference_output)[index];
+      RemoveEntry(std::abs(ref_value), l0_epsilon, stats);
+      AddEntry(std::abs(ref_value - output.values[ii]), l0_epsilon, stats);
+      if (index == reference.tail_linf_index) {
+        tail_linf_covered = true;
+      }
+      ++ii;
+    } else if (ii == output.size() || head.indices[jj] < output.indices[ii]) {
+      AddEntry(std::abs(head.values[jj]), l0_epsilon, stats);
+      ++jj;
+    } else {
+      AddEntry(std::abs(head.values[jj] - output.values[ii]), l0_epsilon,
+               stats);
+      ++ii;
+      ++jj;
+    }
+  }
+
+  double tail_linf = reference.tail_statistics.linf;
+  if (tail_linf_covered) {
+    // The largest tail entry is part of the output, so we have to find the
+    // largest tail entry outside the output. This requires a full pass.
+    tail_linf = 0.0;
+    ii = 0;
+    jj = 0;
+    for (size_t index = 0; index < reference.n; ++index) {
+      while (ii < output.size() && output.indices[ii] < index) {
+        ++ii;
+      }
+      while (jj < head.size() && head.indices[jj] < index) {
+        ++jj;
+      }
+      if ((ii < output.size() && output.indices[ii] == index)
+          || (jj < head.size() && head.indices[jj] == index)) {
+        continue;
+      }
+      tail_linf = std::max(tail_linf, std::abs((*reference_output)[index]));
+    }
+  }
+  stats->linf = std::max(stats->linf, tail_linf);
+
+  // Removing tail entries can leave tiny negative values due to rounding.
+  stats->l1 = std::max(stats->l1, 0.0);
+  stats->l2 = sqrt(std::max(stats->l2, 0.0));
+  return true;
 }
 
-void ComputeBestKTermRepresentation(const std::vector<std::complex<double>>& x,
-                                    size_t k,
-                                    std::vector<std::complex<double>>* x_k) {
-  size_t n = x.size();
-  x_k->resize(n);
-  x_k->assign(n, std::complex<double>(0.0, 0.0));
+void ComputeTopKErrorStatistics(const std::vector<std::complex<double>>& output,
+    const ReferenceSummary& reference,
+    double l0_epsilon, size_t k, SignalStatistics* stats) {
+  std::vector<size_t> top;
+  SelectTopK(output.data(), output.size(), k, &top);
+  SparseSignal output_topk;
+  for (size_t ii = 0; ii < top.size(); ++ii) {
+    output_topk.Add(top[ii], output[top[ii]]);
+  }
+  output_topk.Normalize();
+
+  SparseSignal ref_output_topk;
+  ComputeBestKTermRepresentation(reference, k, &ref_output_topk);
+
+  ComputeDifferenceStatistics(ref_output_topk, output_topk, l0_epsilon, stats);
+}
+
+void ComputeTopKErrorStatistics(const SparseSignal& output,
+    const ReferenceSummary& reference,
+    double l0_epsilon, size_t k, SignalStatistics* stats) {
+  SparseSignal output_topk;
+  ComputeBestKTermRepresentation(output, k, &output_topk);
+
+  SparseSignal ref_output_topk;
+  ComputeBestKTermRepresentation(reference, k, &ref_output_topk);
+
+  ComputeDifferenceStatistics(ref_output_topk, output_topk, l0_epsilon, stats);
+}
 
-  std::vector<std::pair<double, size_t>> coeffs;
-  coeffs.reserve(n);
-  for (size_t ii = 0; ii < n; ++ii) {
-    coeffs.push_back(std::make_pair(std::abs(x[ii]), ii));
+void ComputeReferenceStatistics(const ReferenceSummary& reference,
+                                double l0_epsilon,
+                                SignalStatistics* stats) {
+  *stats = reference.tail_statistics;
+  for (size_t ii = 0; ii < reference.head.size(); ++ii) {
+    AddEntry(std::abs(reference.head.values[ii]), l0_epsilon, stats);
   }
-  std::sort(coeffs.begin(), coeffs.end());
-  for (size_t ii = n - 1; ii >= n - k; --ii) {
-    (*x_k)[coeffs[ii].second] = x[coeffs[ii].second];
+  stats->l2 = sqrt(stats->l2);
+}
+
+void ComputeBestKTermStatistics(const ReferenceSummary& reference,
+                                size_t k,
+                                double l0_epsilon,
+                                SignalStatistics* best_k_term_stats,
+                                SignalStatistics* best_k_term_error_stats) {
+  size_t num_terms = std::min(k, reference.head.size());
+  ClearStatistics(best_k_term_stats);
+  for (size_t ii = 0; ii < num_terms; ++ii) {
+    AddEntry(std::abs(reference.head.values[ii]), l0_epsilon,
+             best_k_term_stats);
+  }
+  best_k_term_stats->l2 = sqrt(best_k_term_stats->l2);
+
+  // The error consists of the remaining head entries and the tail.
+  *best_k_term_error_stats = reference.tail_statistics;
+  for (size_t ii = num_terms; ii < reference.head.size(); ++ii) {
+    AddEntry(std::abs(reference.head.values[ii]), l0_epsilon,
+             best_k_term_error_stats);
   }
+  best_k_term_error_stats->l2 = sqrt(best_k_term_error_stats->l2);
+}
+
+void ComputeSignalStatistics(const SparseSignal& signal,
+                             double l0_epsilon,
+                             SignalStatistics* stats) {
+  ComputeSignalStatistics(signal.values.data(), signal.values.size(),
+                          l0_epsilon, stats);
 }
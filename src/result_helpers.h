@@ -7,6 +7,10 @@
 #include <ostream>
 #include <vector>
 
+#include "perf_counters.h"
+#include "phase_timing.h"
+#include "sparse_signal.h"
+
 struct SignalStatistics {
   size_t l0;
   double l1;
@@ -19,26 +23,94 @@ struct RunResult {
   SignalStatistics error_statistics;
   SignalStatistics topk_error_statistics;
   SignalStatistics output_statistics;
+  // Hardware counters of the timed region (valid only with --perf_counters).
+  PerfCounterValues perf_counters;
+  // Time per phase of the sparse FFT (valid only with --phase_timing).
+  PhaseTimes phase_times;
 };
 
 void ComputeSignalStatistics(const std::vector<std::complex<double>>& signal,
                              double l0_epsilon,
                              SignalStatistics* stats);
 
+void ComputeSignalStatistics(const std::complex<double>* signal,
+                             size_t n,
+                             double l0_epsilon,
+                             SignalStatistics* stats);
+
 void ComputeErrorStatistics(const std::vector<std::complex<double>>& output,
     const std::vector<std::complex<double>>& reference_output,
     double l0_epsilon, SignalStatistics* stats);
 
-void ComputeTopKErrorStatistics(const std::vector<std::complex<double>>& output,
-    const std::vector<std::complex<double>>& reference_output,
-    double l0_epsilon, int k, SignalStatistics* stats);
-
 void WriteStatisticsJSONToStream(const SignalStatistics& stats,
                                  size_t indent,
                                  std::ostream* out);
 
-void ComputeBestKTermRepresentation(const std::vector<std::complex<double>>& x,
-                                    size_t k,
-                                    std::vector<std::complex<double>>* x_k);
+// Precomputed information about a reference output. It is computed once per
+// input and contains the reference's best k-term representation, so that
+// outputs can be compared to the reference without sorting or selecting in
+// the reference again. Sparse outputs can be compared in time proportional to
+// the size of the output (instead of n).
+struct ReferenceSummary {
+  size_t n;
+  // The largest entries of the reference, sorted by decreasing magnitude
+  // (ties are broken by decreasing index, see SelectTopK). The first k
+  // entries form the best k-term representation.
+  SparseSignal head;
+  // The head entries, sorted by index.
+  SparseSignal head_by_index;
+  // Statistics of all entries that are not in the head. The l2 field
+  // contains the squared l2-norm. tail_linf_index is the index of the entry
+  // with largest magnitude in the tail (or n if the tail is empty).
+  SignalStatistics tail_statistics;
+  size_t tail_linf_index;
+};
+
+// The head contains the largest max(2 * k, 64) entries (or all n entries if n
+// is smaller).
+void SummarizeReference(const std::vector<std::complex<double>>& reference,
+                        size_t k,
+                        double l0_epsilon,
+                        ReferenceSummary* summary);
+
+// Error statistics of a sparse output relative to the reference. Entries of
+// the reference outside the summary's head are looked up in reference_output
+// when the output contains them. The result matches the dense
+// ComputeErrorStatistics up to floating point rounding.
+// reference_output can be nullptr if the full reference output is not
+// available (e.g., because the summary was loaded from the reference cache).
+// In this case, the function returns false if the output contains entries
+// outside the head, and true otherwise.
+bool ComputeErrorStatistics(const SparseSignal& output,
+    const ReferenceSummary& reference,
+    const std::vector<std::complex<double>>* reference_output,
+    double l0_epsilon, SignalStatistics* stats);
+
+// Error statistics of the best k-term representation of the output relative
+// to the best k-term representation of the reference.
+void ComputeTopKErrorStatistics(const std::vector<std::complex<double>>& output,
+    const ReferenceSummary& reference,
+    double l0_epsilon, size_t k, SignalStatistics* stats);
+
+void ComputeTopKErrorStatistics(const SparseSignal& output,
+    const ReferenceSummary& reference,
+    double l0_epsilon, size_t k, SignalStatistics* stats);
+
+// Statistics of the full reference output.
+void ComputeReferenceStatistics(const ReferenceSummary& reference,
+                                double l0_epsilon,
+                                SignalStatistics* stats);
+
+// Statistics of the best k-term representation of the reference and of the
+// error of this representation.
+void ComputeBestKTermStatistics(const ReferenceSummary& reference,
+                                size_t k,
+                                double l0_epsilon,
+                                SignalStatistics* best_k_term_stats,
+                                SignalStatistics* best_k_term_error_stats);
+
+void ComputeSignalStatistics(const SparseSignal& signal,
+                             double l0_epsilon,
+                             SignalStatistics* stats);
 
 #endif
@@ -0,0 +1,48 @@
+#ifndef __RESULTS_WRITER_H__
+#define __RESULTS_WRITER_H__
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#include "result_helpers.h"
+#include "timing_statistics.h"
+
+// Output format of run_experiment. OutputWriter writes JSON,
+// BinaryOutputWriter the binary results format.
+class ResultsWriter {
+ public:
+  virtual bool WritePrelude(int argc, char** argv) = 0;
+
+  virtual bool WriteInputResult(const std::string& input_name,
+                                const std::complex<double>* input_data,
+                                size_t input_size,
+                                const ReferenceSummary& reference,
+                                double reference_time,
+                                const std::vector<RunResult>& results,
+                                const TimingStatistics& timing,
+                                bool is_last) = 0;
+
+  // Writes the results of several algorithms on the same input. results[i]
+  // and timing[i] contain the trials of algorithms[i].
+  virtual bool WriteInputResults(const std::string& input_name,
+      const std::complex<double>* input_data,
+      size_t input_size,
+      const ReferenceSummary& reference,
+      double reference_time,
+      const std::vector<std::string>& algorithms,
+      const std::vector<std::vector<RunResult>>& results,
+      const std::vector<TimingStatistics>& timing,
+      bool is_last) = 0;
+
+  // Writes an input result that was formatted by another writer of the same
+  // format (e.g., one writing to a string stream in a worker thread). The
+  // formatted result must have been written with the correct is_last flag.
+  virtual bool WriteFormattedInputResult(const std::string& formatted) = 0;
+
+  virtual bool WriteEnd() = 0;
+
+  virtual ~ResultsWriter() {}
+};
+
+#endif
@@ -1,16 +1,33 @@
+#include <algorithm>
+#include <atomic>
 #include <complex>
 #include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 
+#include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
+#include <omp.h>
 
+#include "binary_output_writer.h"
 #include "fft_wrapper.h"
-#include "fftw_helper.h"
+#include "cpu_affinity.h"
+#include "fftw_interface.h"
+#include "fftw_reference.h"
+#include "fftw_threads.h"
+#include "fftw_wisdom.h"
+#include "input_signal.h"
 #include "output_writer.h"
+#include "perf_counters.h"
+#include "reference_cache.h"
 #include "result_helpers.h"
+#include "timing_statistics.h"
 
 namespace po = boost::program_options;
 
@@ -20,102 +37,677 @@ using std::cout;
 using std::endl;
 using std::getline;
 using std::ifstream;
-using std::istream;
 using std::round;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 typedef complex<double> dcomplex;
 
-bool ReadComplexBinaryData(FILE* file, size_t n, vector<dcomplex>* data) {
-  data->resize(n);
-  size_t num_read = fread(data->data(), 2 * sizeof(double), n, file);
-  if (num_read != n) {
-    fprintf(stderr, "Read only %lu input elements, not %lu.\n", num_read, n);
+// With float_input, binary input files contain complex floats.
+bool ReadInput(const string& src, size_t n, bool float_input,
+               InputSignal* data) {
+  if (src.length() == 0) {
+    return data->ReadText(&cin, n);
+  } else if (float_input) {
+    return data->ReadFloatBinaryFile(src, n);
+  } else {
+    return data->MapBinaryFile(src, n);
+  }
+}
+
+bool GetFileLines(const string& filename, vector<string>* lines) {
+  ifstream infile(filename);
+  if (!infile.good()) {
+    fprintf(stderr, "Could not open file %s.\n", filename.c_str());
+    return false;
+  }
+  string line;
+  while (getline(infile, line)) {
+    lines->push_back(line);
+  }
+  return true;
+}
+
+void RoundReal(vector<dcomplex>* data) {
+  for (size_t ii = 0; ii < data->size(); ++ii) {
+    (*data)[ii].real(round((*data)[ii].real()));
+    (*data)[ii].imag(0.0);
+  }
+}
+
+struct TrialOptions {
+  size_t k;
+  double l0_epsilon;
+  size_t num_trials;
+  size_t num_warmup_runs;
+  bool adaptive_warmup;
+  size_t max_warmup_runs;
+  double target_relative_ci;
+  size_t max_trials;
+  bool rounded_real_output;
+  // Time the phases of each trial in a separate run (see
+  // RunAndEvaluateTrial).
+  bool phase_timing;
+};
+
+// Reference information for one input. The summary is either computed in this
+// run or loaded from the reference cache. In the latter case, the full
+// reference output is only computed if it turns out to be needed.
+struct InputReference {
+  ReferenceSummary summary;
+  double time;
+  bool has_output;
+  vector<dcomplex> output;
+};
+
+// Computes the full reference output with the first slot of reference_fft.
+bool ComputeReferenceOutput(FFTWReference* reference_fft,
+                            const InputSignal& input_data,
+                            bool rounded_real_output,
+                            InputReference* reference) {
+  double tmp;
+  reference_fft->LoadInput(0, input_data.data());
+  if (!reference_fft->Execute(1, &tmp)) {
     return false;
   }
+  reference_fft->StoreOutput(0, &(reference->output));
+  if (rounded_real_output) {
+    RoundReal(&(reference->output));
+  }
+  reference->has_output = true;
   return true;
 }
 
-bool ReadComplexTextData(istream* input, size_t n, vector<dcomplex>* data) {
-  data->resize(n);
-  for (size_t ii = 0; ii < n; ++ii) {
-    if (!((*input) >> (*data)[ii])) {
-      fprintf(stderr, "Could not read element %lu from stdin.\n", ii);
+// Runs a trial of an algorithm with a dense output, on the single precision
+// copy of the input if the algorithm computes in single precision.
+bool RunDenseTrial(FFTWrapper* fft, const InputSignal& input_data,
+                   vector<dcomplex>* output, double* time) {
+  if (fft->UsesFloatInput()) {
+    return fft->RunTrial(input_data.float_data(), input_data.size(), output,
+                         time);
+  }
+  return fft->RunTrial(input_data.data(), input_data.size(), output, time);
+}
+
+// Runs one trial of one algorithm and evaluates its output. Sparse outputs are
+// evaluated against the reference summary, so that no n-sized output vector
+// is needed. The full reference output is computed on demand (using
+// reference_fft) if it is needed but not available. output and sparse_output
+// are buffers that are reused across trials.
+//
+// The phase timers add overhead to the timed region (SFFT-MIT even prints
+// them to stdout), so with options.phase_timing the phases are timed in a
+// second run of the algorithm whose running time and output are discarded.
+bool RunAndEvaluateTrial(FFTWrapper* fft,
+                         const InputSignal& input_data,
+                         FFTWReference* reference_fft,
+                         InputReference* reference,
+                         const TrialOptions& options,
+                         vector<dcomplex>* output,
+                         SparseSignal* sparse_output,
+                         RunResult* result) {
+  if (fft->HasSparseOutput()) {
+    if (!fft->RunTrialSparse(input_data.data(), input_data.size(),
+                             sparse_output, &(result->time))) {
+      return false;
+    }
+    PerfCounters::GetLastValues(&(result->perf_counters));
+
+    if (options.rounded_real_output) {
+      RoundReal(&(sparse_output->values));
+    }
+
+    if (!ComputeErrorStatistics(*sparse_output, reference->summary,
+            reference->has_output ? &(reference->output) : nullptr,
+            options.l0_epsilon, &(result->error_statistics))) {
+      // The output has entries outside the head of the cached reference
+      // summary, so we need the full reference output after all.
+      if (!ComputeReferenceOutput(reference_fft, input_data,
+                                  options.rounded_real_output, reference)) {
+        return false;
+      }
+      ComputeErrorStatistics(*sparse_output, reference->summary,
+          &(reference->output), options.l0_epsilon,
+          &(result->error_statistics));
+    }
+    ComputeTopKErrorStatistics(*sparse_output, reference->summary,
+        options.l0_epsilon, options.k, &(result->topk_error_statistics));
+    ComputeSignalStatistics(*sparse_output, options.l0_epsilon,
+                            &(result->output_statistics));
+  } else {
+    if (!RunDenseTrial(fft, input_data, output, &(result->time))) {
+      return false;
+    }
+    PerfCounters::GetLastValues(&(result->perf_counters));
+
+    if (options.rounded_real_output) {
+      RoundReal(output);
+    }
+
+    ComputeErrorStatistics(*output, reference->output, options.l0_epsilon,
+        &(result->error_statistics));
+    ComputeTopKErrorStatistics(*output, reference->summary,
+        options.l0_epsilon, options.k, &(result->topk_error_statistics));
+    ComputeSignalStatistics(*output, options.l0_epsilon,
+                            &(result->output_statistics));
+  }
+
+  result->phase_times.valid = false;
+  if (options.phase_timing && fft->SetPhaseTiming(true)) {
+    double phase_run_time;
+    bool success;
+    if (fft->HasSparseOutput()) {
+      success = fft->RunTrialSparse(input_data.data(), input_data.size(),
+                                    sparse_output, &phase_run_time);
+    } else {
+      success = RunDenseTrial(fft, input_data, output, &phase_run_time);
+    }
+    fft->GetLastPhaseTimes(&(result->phase_times));
+    fft->SetPhaseTiming(false);
+    if (!success) {
       return false;
     }
   }
-  return true; 
+  return true;
 }
 
-bool ReadInput(const string& src, size_t n, vector<dcomplex>* data) {
-  if (src.length() == 0) {
-    return ReadComplexTextData(&cin, n, data);
-  } else {
-    FILE* input = fopen(src.c_str(), "rb");
-    if (input == nullptr) {
-      fprintf(stderr, "Could not open file %s.\n", src.c_str());
+// Runs the warm-up runs and the trials of one algorithm on one input.
+//
+// The warm-up phase consists of at least num_warmup_runs runs. With
+// adaptive_warmup, it continues until the median running time of the last
+// kWarmupWindow runs is within kWarmupTolerance of the window before (or
+// max_warmup_runs is reached).
+//
+// At least num_trials trials are run. With target_relative_ci > 0, further
+// trials are run until the 95% confidence interval of the median running
+// time is narrower than target_relative_ci times the median (or max_trials is
+// reached).
+bool RunTrials(FFTWrapper* fft,
+               const InputSignal& input_data,
+               FFTWReference* reference_fft,
+               InputReference* reference,
+               const TrialOptions& options,
+               vector<RunResult>* results,
+               TimingStatistics* timing) {
+  const size_t kWarmupWindow = 5;
+  const double kWarmupTolerance = 0.05;
+
+  RunResult current_result;
+  vector<dcomplex> output;
+  SparseSignal sparse_output;
+  bool sparse = fft->HasSparseOutput();
+
+  if (!sparse && !reference->has_output) {
+    if (!ComputeReferenceOutput(reference_fft, input_data,
+                                options.rounded_real_output, reference)) {
       return false;
     }
-    if (!ReadComplexBinaryData(input, n, data)) {
-      fclose(input);
+  }
+
+  // Warm-up runs
+  vector<double> warmup_times;
+  while (warmup_times.size() < options.num_warmup_runs
+         || (options.adaptive_warmup
+             && warmup_times.size() < options.max_warmup_runs
+             && !IsTimingStable(warmup_times, kWarmupWindow,
+                                kWarmupTolerance))) {
+    bool success;
+    if (sparse) {
+      success = fft->RunTrialSparse(input_data.data(), input_data.size(),
+                                    &sparse_output, &current_result.time);
+    } else {
+      success = RunDenseTrial(fft, input_data, &output,
+                              &current_result.time);
+    }
+    if (!success) {
+      return false;
+    }
+    warmup_times.push_back(current_result.time);
+  }
+
+  results->clear();
+  vector<double> times;
+  // The confidence interval is only recomputed after the number of trials has
+  // grown by 1/8, since the bootstrap is relatively expensive.
+  size_t next_ci_check = options.num_trials;
+  while (true) {
+    if (times.size() >= options.num_trials) {
+      if (options.target_relative_ci <= 0.0
+          || times.size() >= options.max_trials) {
+        break;
+      }
+      if (times.size() >= next_ci_check) {
+        if (times.size() >= 2 && RelativeMedianCIWidth(times)
+                                 <= options.target_relative_ci) {
+          break;
+        }
+        next_ci_check = times.size() + std::max<size_t>(1, times.size() / 8);
+      }
+    }
+
+    if (!RunAndEvaluateTrial(fft, input_data, reference_fft, reference,
+                             options, &output, &sparse_output,
+                             &current_result)) {
       return false;
     }
-    // Check if file is empty
-    uint8_t tmp;
-    if (fread(&tmp, sizeof(uint8_t), 1, input) != 0) {
-      fprintf(stderr, "Input not empty afer reading %lu complex numbers.\n", n);
+    results->push_back(current_result);
+    times.push_back(current_result.time);
+  }
+
+  ComputeTimingStatistics(times, warmup_times.size(), timing);
+  return true;
+}
+
+// State of one thread that runs experiments: an instance of each algorithm and
+// a reference FFT.
+struct Worker {
+  vector<unique_ptr<FFTWrapper>> ffts;
+  unique_ptr<FFTWReference> reference_fft;
+};
+
+struct ExperimentOptions {
+  size_t n;
+  // Number of rows of 2D inputs (1 for 1D inputs).
+  size_t rows;
+  vector<string> algorithm_names;
+  bool multiple_algorithms;
+  // Record hardware performance counters in each worker thread.
+  bool perf_counters;
+  // Write the binary results format instead of JSON.
+  bool binary_output;
+  // The binary input files contain complex floats.
+  bool float_input;
+  // One of the algorithms computes in single precision, so the inputs are
+  // also needed as complex floats.
+  bool need_float_input;
+  TrialOptions trial_options;
+};
+
+// Creates a results writer in the output format of the experiment. An empty
+// file name means stdout.
+unique_ptr<ResultsWriter> CreateResultsWriter(const ExperimentOptions& options,
+                                              const string& filename) {
+  size_t k = options.trial_options.k;
+  double l0_epsilon = options.trial_options.l0_epsilon;
+  if (options.binary_output) {
+    return unique_ptr<ResultsWriter>(new BinaryOutputWriter(filename,
+        options.n, k, l0_epsilon, options.algorithm_names));
+  }
+  return unique_ptr<ResultsWriter>(new OutputWriter(filename, k,
+                                                    l0_epsilon));
+}
+
+// Same as above, but the results are written to out.
+unique_ptr<ResultsWriter> CreateResultsWriter(const ExperimentOptions& options,
+                                              std::ostream* out) {
+  size_t k = options.trial_options.k;
+  double l0_epsilon = options.trial_options.l0_epsilon;
+  if (options.binary_output) {
+    return unique_ptr<ResultsWriter>(new BinaryOutputWriter(out, options.n, k,
+        l0_epsilon, options.algorithm_names));
+  }
+  return unique_ptr<ResultsWriter>(new OutputWriter(out, k, l0_epsilon));
+}
+
+// Reads the inputs batch_start, ..., batch_end - 1 into batch_input_data.
+bool ReadBatch(const vector<string>& input_file_names,
+               size_t batch_start,
+               size_t batch_end,
+               const ExperimentOptions& options,
+               vector<InputSignal>* batch_input_data) {
+  vector<InputSignal>(batch_end - batch_start).swap(*batch_input_data);
+  for (size_t jj = batch_start; jj < batch_end; ++jj) {
+    const string& in_file_name = input_file_names[jj];
+    InputSignal& input_data = (*batch_input_data)[jj - batch_start];
+    if (!ReadInput(in_file_name, options.n, options.float_input,
+                   &input_data)) {
+      fprintf(stderr, "Could not read input file %s.\n",
+          in_file_name.c_str());
       return false;
     }
-    if (fclose(input) != 0) {
-      fprintf(stderr, "Could not close input.\n");
+    if (options.need_float_input) {
+      input_data.MakeFloatCopy();
     }
   }
   return true;
 }
 
-bool GetFileLines(const string& filename, vector<string>* lines) {
-  ifstream infile(filename);
-  if (!infile.good()) {
-    fprintf(stderr, "Could not open file %s.\n", filename.c_str());
-    return false;
+// Computes the references of the inputs batch_start, ..., batch_end - 1 (read
+// by ReadBatch) in one batched FFT (or loads them from the reference cache),
+// runs the trials of all algorithms, and writes the results to owriter.
+bool ProcessBatch(const vector<string>& input_file_names,
+                  size_t batch_start,
+                  size_t batch_end,
+                  const vector<InputSignal>& batch_input_data,
+                  const ExperimentOptions& options,
+                  const ReferenceCache& reference_cache,
+                  Worker* worker,
+                  ResultsWriter* owriter) {
+  // The full reference output is only needed if one of the algorithms has a
+  // dense output.
+  bool need_full_reference = false;
+  for (size_t ii = 0; ii < worker->ffts.size(); ++ii) {
+    if (!worker->ffts[ii]->HasSparseOutput()) {
+      need_full_reference = true;
+    }
   }
-  string line;
-  while (getline(infile, line)) {
-    lines->push_back(line);
+
+  size_t batch_size = batch_end - batch_start;
+  vector<InputReference> batch_references(batch_size);
+  vector<ReferenceCache::Key> cache_keys(batch_size);
+  vector<bool> cached(batch_size, false);
+  // Batch positions of the inputs whose reference is computed now, in the
+  // order of the reference_fft slots.
+  vector<size_t> reference_slots;
+
+  for (size_t pos = 0; pos < batch_size; ++pos) {
+    const InputSignal& input_data = batch_input_data[pos];
+    InputReference& reference = batch_references[pos];
+    reference.has_output = false;
+
+    if (reference_cache.enabled()) {
+      ReferenceCache::Key& key = cache_keys[pos];
+      key.input_hash = ReferenceCache::HashInput(input_data.data(),
+                                                 input_data.size());
+      key.n = options.n;
+      key.rows = options.rows;
+      key.k = options.trial_options.k;
+      key.l0_epsilon = options.trial_options.l0_epsilon;
+      key.rounded_real_output = options.trial_options.rounded_real_output;
+      cached[pos] = reference_cache.Load(key, &reference.summary,
+                                         &reference.time);
+    }
+
+    // Dense outputs are always compared to the full reference output.
+    if (!cached[pos] || need_full_reference) {
+      worker->reference_fft->LoadInput(reference_slots.size(),
+                                       input_data.data());
+      reference_slots.push_back(pos);
+    }
+  }
+
+  if (!reference_slots.empty()) {
+    double reference_time;
+    if (!worker->reference_fft->Execute(reference_slots.size(),
+                                        &reference_time)) {
+      fprintf(stderr, "Could not compute reference output.\n");
+      return false;
+    }
+    for (size_t slot = 0; slot < reference_slots.size(); ++slot) {
+      size_t pos = reference_slots[slot];
+      InputReference& reference = batch_references[pos];
+      worker->reference_fft->StoreOutput(slot, &(reference.output));
+      if (options.trial_options.rounded_real_output) {
+        RoundReal(&(reference.output));
+      }
+      reference.has_output = true;
+      if (!cached[pos]) {
+        reference.time = reference_time;
+        SummarizeReference(reference.output, options.trial_options.k,
+            options.trial_options.l0_epsilon, &(reference.summary));
+        if (reference_cache.enabled()) {
+          reference_cache.Store(cache_keys[pos], reference.summary,
+                                reference.time);
+        }
+      }
+    }
+  }
+
+  for (size_t jj = batch_start; jj < batch_end; ++jj) {
+    const string& in_file_name = input_file_names[jj];
+    const InputSignal& input_data = batch_input_data[jj - batch_start];
+    InputReference& reference = batch_references[jj - batch_start];
+
+    // The algorithms run back-to-back on the same input data.
+    vector<vector<RunResult>> results(worker->ffts.size());
+    vector<TimingStatistics> timing(worker->ffts.size());
+    for (size_t ii = 0; ii < worker->ffts.size(); ++ii) {
+      if (!RunTrials(worker->ffts[ii].get(), input_data,
+                     worker->reference_fft.get(), &reference,
+                     options.trial_options, &(results[ii]),
+                     &(timing[ii]))) {
+        fprintf(stderr, "Error while running trials of %s on input %s.\n",
+            options.algorithm_names[ii].c_str(), in_file_name.c_str());
+        return false;
+      }
+    }
+
+    bool is_last = (jj == input_file_names.size() - 1);
+    bool success;
+    if (options.multiple_algorithms) {
+      success = owriter->WriteInputResults(in_file_name, input_data.data(),
+          input_data.size(), reference.summary, reference.time,
+          options.algorithm_names, results, timing, is_last);
+    } else {
+      success = owriter->WriteInputResult(in_file_name, input_data.data(),
+          input_data.size(), reference.summary, reference.time, results[0],
+          timing[0], is_last);
+    }
+    if (!success) {
+      fprintf(stderr, "Could not write output.\n");
+      return false;
+    }
+    // Release the reference output early, it can be large.
+    vector<dcomplex>().swap(reference.output);
+    reference.has_output = false;
   }
   return true;
 }
 
-void RoundReal(vector<dcomplex>* data) {
-  for (size_t ii = 0; ii < data->size(); ++ii) {
-    (*data)[ii].real(round((*data)[ii].real()));
-    (*data)[ii].imag(0.0);
+// Runs the experiments on workers->size() threads. Each thread takes the next
+// input from a shared counter and formats its results in memory. The results
+// are written to owriter in input order. Thread i is pinned to
+// cpus[i % cpus.size()] unless cpus is empty.
+bool RunParallel(const vector<string>& input_file_names,
+                 const ExperimentOptions& options,
+                 const ReferenceCache& reference_cache,
+                 const vector<int>& cpus,
+                 vector<Worker>* workers,
+                 ResultsWriter* owriter) {
+  size_t num_inputs = input_file_names.size();
+  std::atomic<size_t> next_input(0);
+  std::atomic<bool> failed(false);
+
+  std::mutex output_mutex;
+  vector<string> formatted_results(num_inputs);
+  vector<bool> finished(num_inputs, false);
+  size_t next_output = 0;
+
+  auto run_worker = [&](size_t worker_index) {
+    if (!cpus.empty() && !PinCurrentThread(cpus[worker_index % cpus.size()])) {
+      fprintf(stderr, "Could not pin worker %lu.\n", worker_index);
+    }
+    // The workers already use all cores, so the statistics kernels should not
+    // start additional OpenMP threads.
+    omp_set_num_threads(1);
+    // Performance counters only count the thread that opened them.
+    PerfCounters perf_counters;
+    if (options.perf_counters && perf_counters.Open()) {
+      PerfCounters::SetCurrent(&perf_counters);
+    }
+
+    while (!failed) {
+      size_t input = next_input++;
+      if (input >= num_inputs) {
+        break;
+      }
+      std::ostringstream formatted;
+      unique_ptr<ResultsWriter> input_writer = CreateResultsWriter(options,
+                                                                   &formatted);
+      vector<InputSignal> input_data;
+      if (!ReadBatch(input_file_names, input, input + 1, options, &input_data)
+          || !ProcessBatch(input_file_names, input, input + 1, input_data,
+                           options, reference_cache,
+                           &((*workers)[worker_index]), input_writer.get())) {
+        failed = true;
+        break;
+      }
+
+      std::lock_guard<std::mutex> lock(output_mutex);
+      formatted_results[input] = formatted.str();
+      finished[input] = true;
+      while (next_output < num_inputs && finished[next_output]) {
+        if (!owriter->WriteFormattedInputResult(
+            formatted_results[next_output])) {
+          fprintf(stderr, "Could not write output.\n");
+          failed = true;
+        }
+        string().swap(formatted_results[next_output]);
+        ++next_output;
+      }
+    }
+  };
+
+  vector<std::thread> threads;
+  for (size_t ii = 0; ii < workers->size(); ++ii) {
+    threads.push_back(std::thread(run_worker, ii));
+  }
+  for (size_t ii = 0; ii < threads.size(); ++ii) {
+    threads[ii].join();
   }
+  return !failed;
 }
 
+// Processes the inputs in batches of batch_size inputs. With read_ahead, the
+// next batch is read by a separate thread while the current one is processed.
+// The reader then uses a single thread (also for decompressing signal
+// containers), but it still competes with the timed trials for memory
+// bandwidth.
+bool RunSequential(const vector<string>& input_file_names,
+                   const ExperimentOptions& options,
+                   const ReferenceCache& reference_cache,
+                   size_t batch_size,
+                   bool read_ahead,
+                   Worker* worker,
+                   ResultsWriter* owriter) {
+  size_t num_inputs = input_file_names.size();
+  vector<InputSignal> batch_input_data;
+  vector<InputSignal> next_input_data;
+  if (!ReadBatch(input_file_names, 0, std::min(batch_size, num_inputs),
+                 options, &batch_input_data)) {
+    return false;
+  }
+  for (size_t batch_start = 0; batch_start < num_inputs;
+       batch_start += batch_size) {
+    size_t batch_end = std::min(batch_start + batch_size, num_inputs);
+    size_t next_end = std::min(batch_end + batch_size, num_inputs);
+    std::thread reader;
+    bool next_read = false;
+    if (read_ahead && batch_end < num_inputs) {
+      reader = std::thread([&]() {
+        omp_set_num_threads(1);
+        next_read = ReadBatch(input_file_names, batch_end, next_end, options,
+                              &next_input_data);
+      });
+    }
+    bool success = ProcessBatch(input_file_names, batch_start, batch_end,
+                                batch_input_data, options, reference_cache,
+                                worker, owriter);
+    if (reader.joinable()) {
+      reader.join();
+    } else if (success && batch_end < num_inputs) {
+      vector<InputSignal>().swap(batch_input_data);
+      next_read = ReadBatch(input_file_names, batch_end, next_end, options,
+                            &next_input_data);
+    }
+    if (!success || (batch_end < num_inputs && !next_read)) {
+      return false;
+    }
+    batch_input_data.swap(next_input_data);
+  }
+  return true;
+}
+
+// Creates the FFTW plans for inputs of size n (with the given number of rows)
+// so that their wisdom can be saved: the plans of the FFTW backends, the
+// reference plans, and the plan of the inverse FFT in gen_input.
+bool WarmWisdom(size_t n,
+                size_t rows,
+                unsigned int fftw_flags,
+                unsigned int reference_flags,
+                size_t reference_batch_size,
+                size_t num_threads) {
+  FFTWInterface fftw(n, fftw_flags, 1, rows);
+  FFTWReference reference(n, true, true, reference_batch_size,
+                          reference_flags, num_threads, rows);
+  FFTWReference inverse(n, false, true, 1, fftw_flags, num_threads, rows);
+  if (!fftw.Setup() || !reference.Setup() || !inverse.Setup()) {
+    return false;
+  }
+  if (num_threads > 1) {
+    FFTWInterface fftw_mt(n, fftw_flags, num_threads, rows);
+    return fftw_mt.Setup();
+  }
+  return true;
+}
 
 int main(int argc, char** argv) {
   string algorithm;
+  string algorithms;
   string input_file;
   string input_index;
   size_t k;
   double l0_epsilon;
   size_t n;
+  size_t rows;
   size_t num_trials;
   size_t num_warmup_runs;
+  size_t reference_batch_size;
+  string reference_cache_dir;
   bool rounded_real_output;
   string output_file;
+  string output_format;
+  string input_precision;
   size_t seed;
+  string fftw_planning;
+  string reference_planning;
+  string tuning_db;
+  string filter_cache_dir;
+  string warm_wisdom;
+  string wisdom_file;
+  size_t num_threads;
+  size_t parallel_inputs;
+  size_t max_warmup_runs;
+  double target_relative_ci;
+  size_t max_trials;
 
   po::options_description desc("Allowed options");
   desc.add_options()
+      ("adaptive_warmup", "Continue the warm-up phase (after "
+          "--num_warmup_runs runs) until the median running time of the last "
+          "5 runs is within 5% of the 5 runs before.")
       ("algorithm", po::value<string>(&algorithm)->default_value(""),
-          "FFT algorithm to benchmark. Options: fftw, sfft3, sfft3-eth.")
+          "FFT algorithm to benchmark. Options: aafft, fftw, fftw-mt, "
+          "fftwf, fftwf-mt (single precision FFTW), sfft1-eth, sfft1-mit, "
+          "sfft1-native, sfft2-eth, sfft2-mit, sfft2-native, sfft3-eth, "
+          "sfft2d-native (2D signals, see --rows).")
+      ("algorithms", po::value<string>(&algorithms)->default_value(""),
+          "Comma-separated list of FFT algorithms to benchmark on the same "
+          "inputs (instead of --algorithm). Each input is read and its "
+          "reference computed only once. The results of all algorithms are "
+          "written to one output file.")
+      ("fftw_planning",
+          po::value<string>(&fftw_planning)->default_value("measure"),
+          "FFTW planner rigor for the fftw algorithms and the bucket FFTs of "
+          "the native sparse FFTs: estimate, measure, patient, or "
+          "exhaustive. The default is measure.")
+      ("filter_cache_dir",
+          po::value<string>(&filter_cache_dir)->default_value(""),
+          "Directory for caching the filters of the sfft1-mit and sfft2-mit "
+          "algorithms across runs (keyed by n and the filter parameters). "
+          "The cached filters are memory-mapped instead of recomputed. Empty "
+          "string if no cache should be used. The default is \"\".")
       ("help", "Show help message.")
       ("input_file", po::value<string>(&input_file)->default_value(""),
           "Input file name for binary input (or \"\" for text data from "
           "stdin). The default is \"\".")
+      ("input_precision",
+          po::value<string>(&input_precision)->default_value("double"),
+          "Precision of the binary input files: double or float (complex "
+          "floats, e.g., from --output_format float in gen_input). The "
+          "reference FFT and the statistics are computed in double precision "
+          "in both cases. The default is double.")
       ("input_index", po::value<string>(&input_index)->default_value(""),
           "File name of the input index file, which contains one input file "
           "name per line. Empty string if no index file should be used. The "
@@ -123,17 +715,100 @@ int main(int argc, char** argv) {
       ("k", po::value<size_t>(&k)->default_value(0), "Sparsity")
       ("l0_epsilon", po::value<double>(&l0_epsilon)->default_value(1e-8),
           "Threshold for l0-norm computation.")
+      ("max_trials", po::value<size_t>(&max_trials)->default_value(1000),
+          "Maximum number of trials with --target_relative_ci. The default "
+          "is 1000.")
+      ("max_warmup_runs",
+          po::value<size_t>(&max_warmup_runs)->default_value(100),
+          "Maximum number of warm-up runs with --adaptive_warmup. The default "
+          "is 100.")
       ("n", po::value<size_t>(&n)->default_value(0),
           "Number of elements in the input.")
       ("num_trials", po::value<size_t>(&num_trials)->default_value(1),
-          "Number of trials.")
+          "(Minimum) number of trials.")
       ("num_warmup_runs", po::value<size_t>(&num_warmup_runs)->default_value(1),
-          "Number of warm-up runs.")
+          "(Minimum) number of warm-up runs.")
+      ("reference_batch_size",
+          po::value<size_t>(&reference_batch_size)->default_value(1),
+          "Number of inputs for which the reference FFT is computed in one "
+          "batched FFTW call. The default is 1.")
+      ("reference_cache_dir",
+          po::value<string>(&reference_cache_dir)->default_value(""),
+          "Directory for caching reference summaries across runs (keyed by "
+          "the input data, n, rows, k, l0_epsilon, and rounded_real_output). "
+          "Empty string if no cache should be used. The default is \"\".")
+      ("reference_planning",
+          po::value<string>(&reference_planning)->default_value("estimate"),
+          "FFTW planner rigor for the reference FFT. The default is estimate.")
+      ("one_worker_per_core", "With --parallel_inputs, pin the workers to "
+          "different physical cores (no two workers share a core via SMT).")
+      ("parallel_inputs",
+          po::value<size_t>(&parallel_inputs)->default_value(1),
+          "Number of inputs processed concurrently, each by a worker thread "
+          "with its own instances of the algorithms. The workers are pinned "
+          "to different CPUs. CAUTION: concurrent workers compete for memory "
+          "bandwidth, shared caches, and (without --one_worker_per_core) SMT "
+          "cores, and they reduce the turbo frequency. Running times are "
+          "therefore not comparable to sequential runs. Use this for sweeps "
+          "where the error statistics matter, or measure the interference "
+          "before relying on the timings. The default is 1.")
+      ("perf_counters", "Record hardware performance counters (cycles, "
+          "instructions, cache, TLB, and branch misses) for the timed region "
+          "of each trial. Skipped with a warning if perf_event_open is not "
+          "available.")
+      ("phase_timing", "Record the time spent in each phase (permute + "
+          "filter, bucket FFT, location, estimation) of the sparse FFT "
+          "algorithms that report it (currently sfft1-mit, sfft2-mit, "
+          "sfft1-native, sfft2-native, and sfft2d-native). "
+          "The phases are timed in an extra run after each trial, which is "
+          "not part of the running times and timing statistics.")
+      ("pin_threads", "Pin the threads used by fftw-mt and the reference FFT "
+          "to one CPU each.")
+      ("read_ahead", "Read (and decompress) the next input while the "
+          "algorithms run on the current one. This hides the time for "
+          "reading compressed inputs, but the reader thread competes with "
+          "the timed trials for memory bandwidth. Ignored with "
+          "--parallel_inputs.")
+      ("rows", po::value<size_t>(&rows)->default_value(1),
+          "Number of rows of 2D inputs: with rows > 1, the inputs are rows x "
+          "(n / rows) arrays in row-major order (e.g., from gen_input --rows), "
+          "the reference is their 2D DFT, and the output frequencies are "
+          "row-major indices. Supported by the fftw algorithms and "
+          "sfft2d-native. The default is 1 (1D inputs).")
       ("rounded_real_output", "Keep only the rounded real part of the output.")
       ("output_file", po::value<string>(&output_file)->default_value(""),
           "Output file name (or \"\" for stdout). The default is \"\".")
+      ("output_format",
+          po::value<string>(&output_format)->default_value("json"),
+          "Format of the output file: json, or binary for the compact binary "
+          "results format (see binary_output_writer.h and "
+          "experiments/binary_results.py). The default is json.")
       ("seed", po::value<size_t>(&seed)->default_value(3492858),
-          "Seed for the standard C PRNG.");
+          "Seed for the standard C PRNG.")
+      ("sfft_eth_measure", "Plan the FFTs in the SFFT-ETH algorithms with "
+          "FFTW_MEASURE instead of FFTW_ESTIMATE.")
+      ("target_relative_ci",
+          po::value<double>(&target_relative_ci)->default_value(0.0),
+          "After --num_trials trials, run further trials until the width of "
+          "the 95% bootstrap confidence interval of the median running time "
+          "is at most this fraction of the median (e.g., 0.02). 0 disables "
+          "this. The default is 0.")
+      ("threads", po::value<size_t>(&num_threads)->default_value(1),
+          "Number of threads for the fftw-mt algorithm and the reference FFT. "
+          "The default is 1.")
+      ("tuning_db", po::value<string>(&tuning_db)->default_value(""),
+          "Tuning database written by tune_parameters. The sparse FFT "
+          "algorithms use the tuned parameters for n and k if the database "
+          "has an entry for them. The default is \"\" (built-in "
+          "parameters).")
+      ("warm_wisdom", po::value<string>(&warm_wisdom)->default_value(""),
+          "Comma-separated list of sizes n. Instead of running experiments, "
+          "create the FFTW plans for these sizes with the given planning "
+          "options and save the wisdom to --wisdom_file.")
+      ("wisdom_file", po::value<string>(&wisdom_file)->default_value(""),
+          "File for loading and saving FFTW wisdom (or \"\" for no wisdom "
+          "file). The file can be shared by concurrent runs. The default is "
+          "\"\".");
   po::variables_map vm;
   po::store(po::parse_command_line(argc, argv, desc), vm);
   po::notify(vm);
@@ -145,14 +820,128 @@ int main(int argc, char** argv) {
 
   srand(seed);
 
+  if (rows == 0 || (n > 0 && n % rows != 0)) {
+    fprintf(stderr, "The number of rows must divide n.\n");
+    return 1;
+  }
+
   rounded_real_output = vm.count("rounded_real_output");
 
-  FFTWrapper::Type fft_type;
-  if (!FFTWrapper::ParseType(algorithm, &fft_type)) {
-    fprintf(stderr, "Unknown algorithm type \"%s\".", algorithm.c_str());
+  if (num_threads == 0) {
+    fprintf(stderr, "The number of threads must be positive.\n");
+    return 1;
+  }
+  // FFTW's threading has to be initialized before any other FFTW call.
+  if (num_threads > 1 && !InitFFTWThreads()) {
+    return 1;
+  }
+  if (parallel_inputs == 0) {
+    fprintf(stderr, "The number of parallel inputs must be positive.\n");
+    return 1;
+  }
+  if (output_format != "json" && output_format != "binary") {
+    fprintf(stderr, "Unknown output format \"%s\".\n", output_format.c_str());
+    return 1;
+  }
+  if (input_precision != "double" && input_precision != "float") {
+    fprintf(stderr, "Unknown input precision \"%s\".\n",
+        input_precision.c_str());
+    return 1;
+  }
+  // Some algorithms create FFTW plans during their trials, which then happens
+  // in several workers concurrently.
+  if (parallel_inputs > 1 && !MakeFFTWPlannerThreadSafe()) {
+    return 1;
+  }
+  if (vm.count("pin_threads") && !PinOpenMPThreads(num_threads)) {
+    return 1;
+  }
+
+  FFTWrapper::PlanningOptions planning_options;
+  planning_options.fftw_threads = num_threads;
+  planning_options.sfft_eth_measure = vm.count("sfft_eth_measure");
+  planning_options.tuning_database = tuning_db;
+  planning_options.filter_cache_dir = filter_cache_dir;
+  planning_options.rows = rows;
+  if (!FFTWWisdom::ParsePlanningFlags(fftw_planning,
+                                      &planning_options.fftw_flags)) {
+    fprintf(stderr, "Unknown FFTW planning mode \"%s\".\n",
+        fftw_planning.c_str());
+    return 1;
+  }
+  unsigned int reference_flags;
+  if (!FFTWWisdom::ParsePlanningFlags(reference_planning, &reference_flags)) {
+    fprintf(stderr, "Unknown FFTW planning mode \"%s\".\n",
+        reference_planning.c_str());
+    return 1;
+  }
+
+  if (reference_batch_size == 0) {
+    fprintf(stderr, "The reference batch size must be positive.\n");
+    return 1;
+  }
+
+  FFTWWisdom wisdom(wisdom_file);
+  if (!wisdom.Load()) {
     return 1;
   }
 
+  if (!warm_wisdom.empty()) {
+    if (!wisdom.enabled()) {
+      fprintf(stderr, "--warm_wisdom requires a wisdom file.\n");
+      return 1;
+    }
+    vector<string> sizes;
+    boost::split(sizes, warm_wisdom, boost::is_any_of(","));
+    for (size_t ii = 0; ii < sizes.size(); ++ii) {
+      char* end;
+      size_t size = strtoull(sizes[ii].c_str(), &end, 10);
+      if (sizes[ii].empty() || *end != '\0' || size == 0) {
+        fprintf(stderr, "Invalid size \"%s\".\n", sizes[ii].c_str());
+        return 1;
+      }
+      if (size % rows != 0) {
+        fprintf(stderr, "The number of rows must divide n = %lu.\n", size);
+        return 1;
+      }
+      if (!WarmWisdom(size, rows, planning_options.fftw_flags,
+                      reference_flags, reference_batch_size, num_threads)) {
+        fprintf(stderr, "Could not create the FFTW plans for n = %lu.\n",
+            size);
+        return 1;
+      }
+    }
+    return wisdom.Save() ? 0 : 1;
+  }
+
+  vector<string> algorithm_names;
+  bool multiple_algorithms = !algorithms.empty();
+  if (multiple_algorithms) {
+    if (!algorithm.empty()) {
+      fprintf(stderr, "Error: cannot use --algorithm and --algorithms at the "
+          "same time.\n");
+      return 1;
+    }
+    boost::split(algorithm_names, algorithms, boost::is_any_of(","));
+  } else {
+    algorithm_names.push_back(algorithm);
+  }
+
+  vector<FFTWrapper::Type> fft_types(algorithm_names.size());
+  for (size_t ii = 0; ii < algorithm_names.size(); ++ii) {
+    if (!FFTWrapper::ParseType(algorithm_names[ii], &(fft_types[ii]))) {
+      fprintf(stderr, "Unknown algorithm type \"%s\".",
+          algorithm_names[ii].c_str());
+      return 1;
+    }
+    if (std::find(fft_types.begin(), fft_types.begin() + ii, fft_types[ii])
+        != fft_types.begin() + ii) {
+      fprintf(stderr, "Algorithm \"%s\" is listed twice.\n",
+          algorithm_names[ii].c_str());
+      return 1;
+    }
+  }
+
   vector<string> input_file_names;
   if (!input_index.empty()) {
     if (!input_file.empty()) {
@@ -168,71 +957,115 @@ int main(int argc, char** argv) {
     input_file_names.push_back(input_file);
   }
 
-  FFTWrapper fft(n, k, fft_type);
-  if (!fft.Setup()) {
-    fprintf(stderr, "Could not set up algorithm.\n"); 
+  size_t num_workers = std::min(parallel_inputs, input_file_names.size());
+  if (num_workers > 1 && reference_batch_size > 1) {
+    fprintf(stderr, "Error: cannot use --parallel_inputs and "
+        "--reference_batch_size at the same time.\n");
     return 1;
   }
-
-  OutputWriter owriter(output_file, k, l0_epsilon);
-  if (!owriter.WritePrelude(argc, argv)) {
-    fprintf(stderr, "Could not write output.\n");
+  // The phase timers are captured from the stdout file descriptor, which is
+  // shared by all workers.
+  bool phase_timing = vm.count("phase_timing");
+  if (num_workers > 1 && phase_timing) {
+    fprintf(stderr, "Error: cannot use --parallel_inputs and --phase_timing "
+        "at the same time.\n");
     return 1;
   }
 
-  for (size_t jj = 0; jj < input_file_names.size(); ++jj) {
-    const string& in_file_name = input_file_names[jj];
-    vector<dcomplex> input_data;
-    double reference_time;
-    vector<dcomplex> reference_output;
-
-    if (!ReadInput(in_file_name, n, &input_data)) {
-      fprintf(stderr, "Could not read input file %s.\n", in_file_name.c_str());
+  // All workers are set up before the first input is read. The setup runs in
+  // this thread, so the FFTW planner is never called concurrently by our own
+  // code.
+  vector<Worker> workers(std::max<size_t>(num_workers, 1));
+  for (size_t ww = 0; ww < workers.size(); ++ww) {
+    Worker& worker = workers[ww];
+    worker.reference_fft.reset(new FFTWReference(n, true, true,
+        reference_batch_size, reference_flags, num_threads, rows));
+    if (!worker.reference_fft->Setup()) {
+      fprintf(stderr, "Could not set up the reference FFT.\n");
       return 1;
     }
 
-    if (!ApplyFFTW(input_data, true, true, false, &reference_time,
-                   &reference_output)) {
-      fprintf(stderr, "Could not compute reference output.\n");
-      return 1;
-    }
-    if (rounded_real_output) {
-      RoundReal(&reference_output);
+    for (size_t ii = 0; ii < fft_types.size(); ++ii) {
+      worker.ffts.emplace_back(new FFTWrapper(n, k, fft_types[ii],
+                                              planning_options));
+      if (!worker.ffts.back()->Setup()) {
+        fprintf(stderr, "Could not set up algorithm %s.\n",
+            algorithm_names[ii].c_str());
+        return 1;
+      }
+      if (phase_timing && !worker.ffts.back()->SetPhaseTiming(false)
+          && ww == 0) {
+        fprintf(stderr, "Warning: algorithm %s does not report phase "
+            "times.\n", algorithm_names[ii].c_str());
+      }
     }
+  }
 
-    RunResult current_result;
-    vector<dcomplex> output;
+  // All plans exist at this point, so later runs can reuse their wisdom.
+  if (!wisdom.Save()) {
+    return 1;
+  }
 
-    // Warm-up runs
-    for (size_t ii = 0; ii < num_warmup_runs; ++ii) {
-      fft.RunTrial(input_data, &output, &current_result.time);
+  ExperimentOptions options;
+  options.n = n;
+  options.rows = rows;
+  options.algorithm_names = algorithm_names;
+  options.multiple_algorithms = multiple_algorithms;
+  options.perf_counters = vm.count("perf_counters");
+  options.binary_output = (output_format == "binary");
+  options.float_input = (input_precision == "float");
+  options.need_float_input = false;
+  for (size_t ii = 0; ii < workers[0].ffts.size(); ++ii) {
+    if (workers[0].ffts[ii]->UsesFloatInput()) {
+      options.need_float_input = true;
     }
+  }
+  options.trial_options.k = k;
+  options.trial_options.l0_epsilon = l0_epsilon;
+  options.trial_options.num_trials = num_trials;
+  options.trial_options.num_warmup_runs = num_warmup_runs;
+  options.trial_options.adaptive_warmup = vm.count("adaptive_warmup");
+  options.trial_options.max_warmup_runs = max_warmup_runs;
+  options.trial_options.target_relative_ci = target_relative_ci;
+  options.trial_options.max_trials = max_trials;
+  options.trial_options.rounded_real_output = rounded_real_output;
+  options.trial_options.phase_timing = phase_timing;
 
-    vector<RunResult> results;
-    for (size_t ii = 0; ii < num_trials; ++ii) {
-      fft.RunTrial(input_data, &output, &current_result.time);
-
-      if (rounded_real_output) {
-        RoundReal(&output);
-      }
+  unique_ptr<ResultsWriter> owriter = CreateResultsWriter(options,
+                                                         output_file);
+  if (!owriter->WritePrelude(argc, argv)) {
+    fprintf(stderr, "Could not write output.\n");
+    return 1;
+  }
 
-      ComputeErrorStatistics(output, reference_output, l0_epsilon,
-          &(current_result.error_statistics));
-      ComputeTopKErrorStatistics(output, reference_output, l0_epsilon, k,
-          &(current_result.topk_error_statistics));
-      ComputeSignalStatistics(output, l0_epsilon,
-                              &(current_result.output_statistics));
-      results.push_back(current_result);
-    }
+  ReferenceCache reference_cache(reference_cache_dir);
 
-    if (!owriter.WriteInputResult(in_file_name, input_data, reference_output,
-        reference_time, results, (jj == input_file_names.size() - 1))) {
-      fprintf(stderr, "Could not write output.\n");
+  bool success;
+  if (workers.size() > 1) {
+    vector<int> cpus;
+    if (!GetAllowedCPUs(vm.count("one_worker_per_core"), &cpus)) {
       return 1;
     }
+    if (cpus.size() < workers.size()) {
+      fprintf(stderr, "Warning: %lu workers share %lu CPUs.\n",
+          workers.size(), cpus.size());
+    }
+    success = RunParallel(input_file_names, options, reference_cache, cpus,
+                          &workers, owriter.get());
+  } else {
+    PerfCounters perf_counters;
+    if (options.perf_counters && perf_counters.Open()) {
+      PerfCounters::SetCurrent(&perf_counters);
+    }
+    success = RunSequential(input_file_names, options, reference_cache,
+                            reference_batch_size, vm.count("read_ahead"),
+                            &(workers[0]), owriter.get());
   }
- 
-  if (!owriter.WriteEnd()) {
+  if (!success) {
+    return 1;
+  }
+
+  if (!owriter->WriteEnd()) {
     fprintf(stderr, "Could not write output.\n");
     return 1;
   }
@@ -0,0 +1,236 @@
+#include <complex>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+#include "fft_wrapper.h"
+#include "fftw_wisdom.h"
+#include "helpers.h"
+#include "sparse_signal.h"
+#include "stream_reader.h"
+#include "timer.h"
+
+namespace po = boost::program_options;
+
+using std::cout;
+using std::ostream;
+using std::scientific;
+using std::string;
+
+struct StreamSummary {
+  size_t num_windows;
+  // Number of stream elements covered by the windows.
+  size_t num_samples;
+  // Wall-clock time of the whole stream (reading, windowing, FFTs, output).
+  double total_time;
+  // Sum of the running times of the algorithm.
+  double compute_time;
+};
+
+void WriteStreamPrelude(int argc, char** argv, const string& algorithm,
+                        size_t n, size_t k, size_t hop_size, ostream* out) {
+  ostream& oref = *out;
+  oref << "{\n";
+  oref << "  \"command\": \"" << CollapseCommand(argc, argv) << "\",\n";
+  oref << "  \"algorithm\": \"" << algorithm << "\",\n";
+  oref << "  \"n\": " << n << ",\n";
+  oref << "  \"k\": " << k << ",\n";
+  oref << "  \"hop_size\": " << hop_size << ",\n";
+  oref << "  \"windows\": [";
+}
+
+// Windows are separated by a comma before each window except the first, so
+// that the stream can end at any window.
+void WriteWindow(size_t index, size_t offset, double running_time,
+                 const SparseSignal* spectrum, ostream* out) {
+  ostream& oref = *out;
+  oref << (index == 0 ? "\n" : ",\n");
+  oref << "    {\n";
+  oref << "      \"offset\": " << offset << ",\n";
+  oref << "      \"running_time\": " << scientific << running_time;
+  if (spectrum != nullptr) {
+    oref << ",\n      \"spectrum\": [";
+    for (size_t ii = 0; ii < spectrum->size(); ++ii) {
+      oref << (ii == 0 ? "" : ", ") << "[" << spectrum->indices[ii] << ", "
+           << scientific << spectrum->values[ii].real() << ", "
+           << spectrum->values[ii].imag() << "]";
+    }
+    oref << "]";
+  }
+  oref << "\n    }";
+}
+
+void WriteStreamEnd(const StreamSummary& summary, ostream* out) {
+  ostream& oref = *out;
+  oref << "\n  ],\n";
+  oref << "  \"num_windows\": " << summary.num_windows << ",\n";
+  oref << "  \"num_samples\": " << summary.num_samples << ",\n";
+  oref << "  \"total_time\": " << scientific << summary.total_time << ",\n";
+  oref << "  \"compute_time\": " << summary.compute_time << ",\n";
+  oref << "  \"samples_per_second\": "
+       << summary.num_samples / summary.total_time << ",\n";
+  oref << "  \"compute_samples_per_second\": "
+       << summary.num_samples / summary.compute_time << "\n";
+  oref << "}" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  string algorithm;
+  size_t n;
+  size_t k;
+  string input_file;
+  size_t hop_size;
+  size_t chunk_size;
+  size_t max_windows;
+  string output_file;
+  string fftw_planning;
+  string wisdom_file;
+  string tuning_db;
+  string filter_cache_dir;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+      ("algorithm", po::value<string>(&algorithm), "Algorithm to run.")
+      ("chunk_size", po::value<size_t>(&chunk_size)->default_value(1 << 20),
+          "Number of complex numbers per read from the input file. Two chunks "
+          "are in memory at a time: one is read while the windows of the "
+          "other are processed. The default is 1048576.")
+      ("fftw_planning",
+          po::value<string>(&fftw_planning)->default_value("measure"),
+          "FFTW planner rigor for the fftw, fftw-mt, fftwf, and fftwf-mt "
+          "backends: estimate, measure, patient, or exhaustive. The default "
+          "is measure.")
+      ("filter_cache_dir",
+          po::value<string>(&filter_cache_dir)->default_value(""),
+          "Directory for caching the filters of the sfft1-mit and sfft2-mit "
+          "algorithms across runs (keyed by n and the filter parameters). "
+          "The cached filters are memory-mapped instead of recomputed. Empty "
+          "string if no cache should be used. The default is \"\".")
+      ("help", "Show help message.")
+      ("hop_size", po::value<size_t>(&hop_size)->default_value(0),
+          "Distance between the starts of consecutive windows (or 0 for n, "
+          "i.e., non-overlapping windows). The default is 0.")
+      ("input_file", po::value<string>(&input_file),
+          "Binary file (or pipe) containing the stream of complex doubles.")
+      ("k", po::value<size_t>(&k), "Sparsity")
+      ("max_windows", po::value<size_t>(&max_windows)->default_value(0),
+          "Stop after this many windows (or 0 for the whole stream). The "
+          "default is 0.")
+      ("n", po::value<size_t>(&n), "Window size")
+      ("output_file", po::value<string>(&output_file)->default_value(""),
+          "Output file name (or \"\" for stdout). The default is \"\".")
+      ("sfft_eth_measure", "Use FFTW_MEASURE for the plans of the SFFT-ETH "
+          "backends.")
+      ("skip_spectra", "Write only the offset and running time of each "
+          "window, not its sparse spectrum.")
+      ("tuning_db", po::value<string>(&tuning_db)->default_value(""),
+          "Tuning database written by tune_parameters (or \"\" for the "
+          "built-in parameters of the sparse FFT algorithms). The default is "
+          "\"\".")
+      ("wisdom_file", po::value<string>(&wisdom_file)->default_value(""),
+          "File for loading and saving FFTW wisdom (or \"\" for no wisdom "
+          "file). The default is \"\".");
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    cout << desc << std::endl;
+    return 0;
+  }
+
+  if (!vm.count("algorithm") || !vm.count("n") || !vm.count("k")
+      || !vm.count("input_file")) {
+    fprintf(stderr, "The options algorithm, n, k, and input_file are "
+        "required.\n");
+    return 1;
+  }
+  if (n == 0) {
+    fprintf(stderr, "n must be positive.\n");
+    return 1;
+  }
+  if (hop_size == 0) {
+    hop_size = n;
+  }
+
+  FFTWrapper::Type type;
+  if (!FFTWrapper::ParseType(algorithm, &type)) {
+    fprintf(stderr, "Unknown algorithm type \"%s\".\n", algorithm.c_str());
+    return 1;
+  }
+  FFTWrapper::PlanningOptions planning_options;
+  planning_options.sfft_eth_measure = vm.count("sfft_eth_measure");
+  planning_options.tuning_database = tuning_db;
+  planning_options.filter_cache_dir = filter_cache_dir;
+  if (!FFTWWisdom::ParsePlanningFlags(fftw_planning,
+                                      &planning_options.fftw_flags)) {
+    fprintf(stderr, "Unknown FFTW planning mode \"%s\".\n",
+        fftw_planning.c_str());
+    return 1;
+  }
+
+  FFTWWisdom wisdom(wisdom_file);
+  if (!wisdom.Load()) {
+    return 1;
+  }
+  FFTWrapper fft(n, k, type, planning_options);
+  if (!fft.Setup()) {
+    fprintf(stderr, "Could not set up algorithm %s.\n", algorithm.c_str());
+    return 1;
+  }
+  if (!wisdom.Save()) {
+    return 1;
+  }
+
+  std::unique_ptr<std::ofstream> file_output;
+  ostream* out = &cout;
+  if (!output_file.empty()) {
+    file_output.reset(new std::ofstream(output_file));
+    out = file_output.get();
+  }
+  if (!out->good()) {
+    fprintf(stderr, "Could not open the output file.\n");
+    return 1;
+  }
+
+  StreamReader reader(chunk_size);
+  if (!reader.Open(input_file)) {
+    return 1;
+  }
+  SlidingWindow window(&reader, n, hop_size);
+
+  WriteStreamPrelude(argc, argv, algorithm, n, k, hop_size, out);
+  StreamSummary summary = {0, 0, 0.0, 0.0};
+  SparseSignal spectrum;
+  Timer timer;
+  while ((max_windows == 0 || summary.num_windows < max_windows)
+         && window.Next()) {
+    double running_time;
+    if (!fft.RunTrialSparse(window.data(), n, &spectrum, &running_time)) {
+      fprintf(stderr, "Error while running %s on the window at offset "
+          "%lu.\n", algorithm.c_str(), window.offset());
+      return 1;
+    }
+    WriteWindow(summary.num_windows, window.offset(), running_time,
+                vm.count("skip_spectra") ? nullptr : &spectrum, out);
+    summary.compute_time += running_time;
+    summary.num_samples = window.offset() + n;
+    ++summary.num_windows;
+  }
+  summary.total_time = timer.GetElapsedSeconds();
+  if (window.failed()) {
+    return 1;
+  }
+  reader.Close();
+
+  WriteStreamEnd(summary, out);
+  if (!out->good()) {
+    fprintf(stderr, "Could not write output.\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,403 @@
+#include "sfft2d_native_interface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "perf_counters.h"
+#include "timer.h"
+#include "top_k.h"
+
+namespace {
+
+const uint64_t kSeed = 0x2df7a71e;
+// The vote count is stored in the low kScoreBits bits of a score.
+const int kScoreBits = 8;
+const uint32_t kMaxEpoch = (1u << (32 - kScoreBits)) - 1;
+
+// Splits about total buckets between the axes in proportion to their lengths
+// (B_row / rows ~ B_col / cols), with divisors of rows and cols.
+void SplitBuckets(size_t rows, size_t cols, double total, size_t* B_row,
+                  size_t* B_col) {
+  *B_row = FloorToDivisor(rows, std::sqrt(total * rows / cols));
+  *B_col = FloorToDivisor(cols, total / *B_row);
+}
+
+// Bucket of the permuted frequency f (of an axis with the given bucket width)
+// and the offset of f from the bucket center.
+inline size_t BucketOf(uint64_t f, size_t width, size_t B, int64_t* offset) {
+  uint64_t center = (f + width / 2) / width;
+  *offset = static_cast<int64_t>(f) - static_cast<int64_t>(center * width);
+  return center == B ? 0 : center;
+}
+
+}  // namespace
+
+std::vector<TunableParameter> SFFT2DNativeInterface::TunableParameters(
+    size_t /* n */, size_t /* k */) {
+  // The filters are products of two 1D filters, so the cost of the bucketing
+  // grows with the square of their support. The default tolerance is
+  // therefore lower than in 1D. A bucket also collects the transition bands
+  // of its neighbors along both axes, so the estimation uses twice as many
+  // buckets as the location to keep the estimates exact.
+  return {
+    {"Bcst_loc", 1.0, {0.25, 0.5, 1.0, 2.0, 4.0}},
+    {"Bcst_est", 2.0, {0.25, 0.5, 1.0, 2.0, 4.0}},
+    {"loops_loc", 4, {2, 3, 4, 5, 6, 8}},
+    {"loops_est", 12, {0, 2, 4, 8, 12, 16}},
+    {"loops_thresh", 3, {1, 2, 3, 4, 5, 6}},
+    {"tolerance_loc", 1e-6, {1e-4, 1e-6, 1e-8}},
+    {"tolerance_est", 1e-6, {1e-4, 1e-6, 1e-8}},
+    {"transition", 1.0, {0.5, 1.0, 2.0}},
+  };
+}
+
+bool SFFT2DNativeInterface::GetParameters(size_t rows, size_t cols, size_t k,
+                                          const TuningParameters& tuning,
+                                          Parameters* parameters) {
+  size_t n = rows * cols;
+  std::vector<TunableParameter> space = TunableParameters(n, k);
+  if (!CheckTuningParameters(tuning, space, "sfft2d-native")) {
+    return false;
+  }
+  TuningParameters values;
+  for (size_t ii = 0; ii < space.size(); ++ii) {
+    values[space[ii].name] = GetTuningParameter(tuning, space[ii].name,
+                                                space[ii].initial);
+  }
+
+  double log_n = std::max(1.0, std::log2(static_cast<double>(n)));
+  double B = std::sqrt(static_cast<double>(n) * k / log_n);
+  SplitBuckets(rows, cols, values["Bcst_loc"] * B, &parameters->B_row_loc,
+               &parameters->B_col_loc);
+  SplitBuckets(rows, cols, values["Bcst_est"] * B, &parameters->B_row_est,
+               &parameters->B_col_est);
+  // Each frequency is spread over about (1 + transition)^2 buckets.
+  parameters->B_thresh = 4 * k;
+  parameters->loops_loc = values["loops_loc"];
+  parameters->loops_est = values["loops_est"];
+  parameters->loops_thresh = values["loops_thresh"];
+  parameters->tolerance_loc = values["tolerance_loc"];
+  parameters->tolerance_est = values["tolerance_est"];
+  parameters->transition = values["transition"];
+  return true;
+}
+
+SFFT2DNativeInterface::SFFT2DNativeInterface(size_t rows, size_t cols,
+                                             size_t k,
+                                             unsigned int planning_flags,
+                                             const TuningParameters& tuning)
+    : rows_(rows), cols_(cols), n_(rows * cols), k_(k),
+      planning_flags_(planning_flags), tuning_(tuning),
+      cols_power_of_two_(false), buckets_(nullptr), plan_loc_(nullptr),
+      plan_est_(nullptr), rng_(kSeed), epoch_(0), phase_timing_(false) {}
+
+bool SFFT2DNativeInterface::Setup() {
+  if (rows_ < 2 || cols_ < 2 || n_ >= kSFFTMaxSize) {
+    fprintf(stderr, "The native 2D sparse FFT requires at least two rows and "
+                    "columns and n < 2^32 (rows = %lu, cols = %lu).\n",
+            rows_, cols_);
+    return false;
+  }
+  if (!GetParameters(rows_, cols_, k_, tuning_, &parameters_)) {
+    return false;
+  }
+  const Parameters& p = parameters_;
+  cols_power_of_two_ = ((cols_ & (cols_ - 1)) == 0);
+  size_t B_loc = p.B_row_loc * p.B_col_loc;
+  size_t B_est = p.B_row_est * p.B_col_est;
+  if (p.B_thresh == 0 || p.B_thresh >= B_loc || p.loops_loc == 0
+      || p.loops_thresh == 0 || p.loops_thresh > p.loops_loc
+      || p.loops_thresh >= (1u << kScoreBits)) {
+    fprintf(stderr, "Invalid location parameters: B_thresh = %lu, "
+                    "loops_loc = %lu, loops_thresh = %lu (B_loc = %lu x "
+                    "%lu).\n", p.B_thresh, p.loops_loc, p.loops_thresh,
+            p.B_row_loc, p.B_col_loc);
+    return false;
+  }
+
+  if (!row_filter_loc_.Create(rows_, p.B_row_loc, p.tolerance_loc,
+                              p.transition)
+      || !col_filter_loc_.Create(cols_, p.B_col_loc, p.tolerance_loc,
+                                 p.transition)) {
+    return false;
+  }
+  if (p.loops_est > 0
+      && (!row_filter_est_.Create(rows_, p.B_row_est, p.tolerance_est,
+                                  p.transition)
+          || !col_filter_est_.Create(cols_, p.B_col_est, p.tolerance_est,
+                                     p.transition))) {
+    return false;
+  }
+
+  size_t num_buckets = p.loops_loc * B_loc + p.loops_est * B_est;
+  buckets_ = fftw_alloc_complex(num_buckets);
+  if (buckets_ == nullptr) {
+    return false;
+  }
+  std::complex<double>* buckets =
+      reinterpret_cast<std::complex<double>*>(buckets_);
+  loops_.resize(p.loops_loc + p.loops_est);
+  for (size_t ii = 0; ii < loops_.size(); ++ii) {
+    Loop& loop = loops_[ii];
+    if (ii < p.loops_loc) {
+      loop.row_filter = &row_filter_loc_;
+      loop.col_filter = &col_filter_loc_;
+      loop.buckets = buckets + ii * B_loc;
+    } else {
+      loop.row_filter = &row_filter_est_;
+      loop.col_filter = &col_filter_est_;
+      loop.buckets = buckets + p.loops_loc * B_loc
+                     + (ii - p.loops_loc) * B_est;
+    }
+    loop.tile_size = FloorToDivisor(loop.col_filter->B(), kSFFTTileSize);
+  }
+
+  // Batched in-place 2D plans for the bucket FFTs of all loops.
+  int dims_loc[2] = {static_cast<int>(p.B_row_loc),
+                     static_cast<int>(p.B_col_loc)};
+  plan_loc_ = fftw_plan_many_dft(2, dims_loc, p.loops_loc, buckets_, nullptr,
+      1, B_loc, buckets_, nullptr, 1, B_loc, FFTW_FORWARD, planning_flags_);
+  if (plan_loc_ == nullptr) {
+    return false;
+  }
+  if (p.loops_est > 0) {
+    int dims_est[2] = {static_cast<int>(p.B_row_est),
+                       static_cast<int>(p.B_col_est)};
+    fftw_complex* est = buckets_ + p.loops_loc * B_loc;
+    plan_est_ = fftw_plan_many_dft(2, dims_est, p.loops_est, est, nullptr, 1,
+        B_est, est, nullptr, 1, B_est, FFTW_FORWARD, planning_flags_);
+    if (plan_est_ == nullptr) {
+      return false;
+    }
+  }
+
+  // The phase factor of (f_row, f_col) is e^{-2 pi i m / n} with
+  // m = f_row tau_row cols + f_col tau_col rows (mod n).
+  twiddles_.Create(n_);
+
+  tile_.resize(kSFFTTileSize);
+  row_buckets_.resize(std::max(p.B_col_loc, p.B_col_est));
+  scores_.assign(n_, 0);
+  median_real_.resize(loops_.size());
+  median_imag_.resize(loops_.size());
+  return true;
+}
+
+void SFFT2DNativeInterface::DrawPermutation(size_t n,
+                                            AxisPermutation* permutation) {
+  do {
+    permutation->sigma = (rng_() | 1) % n;
+  } while (Gcd(permutation->sigma, n) != 1);
+  permutation->sigma_inverse = InverseMod(permutation->sigma, n);
+  permutation->tau = rng_() % n;
+}
+
+template <typename Modulus>
+void SFFT2DNativeInterface::PermuteFilterLoop(
+    const std::complex<double>* input, const Loop& loop) {
+  const FlatFilter& row_filter = *loop.row_filter;
+  size_t B_row = row_filter.B();
+  size_t B_col = loop.col_filter->B();
+  GeneralModulus rows(rows_);
+  Modulus cols(cols_);
+  std::fill(loop.buckets, loop.buckets + B_row * B_col,
+            std::complex<double>(0.0, 0.0));
+
+  uint64_t row = rows.Add(loop.row.tau, rows_ - rows.Mul(loop.row.sigma,
+      static_cast<uint64_t>(-row_filter.first())));
+  const double* g = row_filter.time();
+  for (size_t tt = 0; tt < row_filter.size(); ++tt) {
+    // The support is padded with zeros to a multiple of 2 B_row.
+    if (g[tt] != 0.0) {
+      PermuteFilterKernel(input + row * cols_, cols, *loop.col_filter,
+                          loop.tile_size, loop.col.sigma, loop.col.tau,
+                          tile_.data(), row_buckets_.data());
+      // The row filter starts at a multiple of B_row.
+      double* z = reinterpret_cast<double*>(loop.buckets
+                                            + (tt % B_row) * B_col);
+      const double* y = reinterpret_cast<const double*>(row_buckets_.data());
+      double weight = g[tt];
+      #pragma omp simd
+      for (size_t ii = 0; ii < 2 * B_col; ++ii) {
+        z[ii] += weight * y[ii];
+      }
+    }
+    row = rows.Add(row, loop.row.sigma);
+  }
+}
+
+void SFFT2DNativeInterface::PermuteFilter(const std::complex<double>* input) {
+  for (size_t ii = 0; ii < loops_.size(); ++ii) {
+    Loop& loop = loops_[ii];
+    DrawPermutation(rows_, &loop.row);
+    DrawPermutation(cols_, &loop.col);
+    if (cols_power_of_two_) {
+      PermuteFilterLoop<PowerOfTwoModulus>(input, loop);
+    } else {
+      PermuteFilterLoop<GeneralModulus>(input, loop);
+    }
+  }
+}
+
+void SFFT2DNativeInterface::BucketFFT() {
+  fftw_execute(plan_loc_);
+  if (plan_est_ != nullptr) {
+    fftw_execute(plan_est_);
+  }
+}
+
+template <typename Modulus>
+void SFFT2DNativeInterface::Vote(const Loop& loop, size_t bucket_row,
+                                 size_t bucket_col) {
+  GeneralModulus rows(rows_);
+  Modulus cols(cols_);
+  size_t width_row = rows_ / loop.row_filter->B();
+  size_t width_col = cols_ / loop.col_filter->B();
+  // The frequencies whose permuted coordinates round to the bucket.
+  uint64_t f_row = rows.Mul(loop.row.sigma_inverse,
+      rows.Add(bucket_row * width_row, rows_ - width_row / 2));
+  uint64_t first_col = cols.Mul(loop.col.sigma_inverse,
+      cols.Add(bucket_col * width_col, cols_ - width_col / 2));
+  uint32_t threshold = parameters_.loops_thresh;
+  uint32_t epoch_base = epoch_ << kScoreBits;
+  for (size_t ii = 0; ii < width_row; ++ii) {
+    uint32_t* row_scores = scores_.data() + f_row * cols_;
+    uint64_t f_col = first_col;
+    for (size_t jj = 0; jj < width_col; ++jj) {
+      uint32_t score = row_scores[f_col];
+      if ((score >> kScoreBits) != epoch_) {
+        score = epoch_base;
+      }
+      ++score;
+      row_scores[f_col] = score;
+      if ((score & ((1u << kScoreBits) - 1)) == threshold) {
+        candidates_.push_back(f_row * cols_ + f_col);
+      }
+      f_col = cols.Add(f_col, loop.col.sigma_inverse);
+    }
+    f_row = rows.Add(f_row, loop.row.sigma_inverse);
+  }
+}
+
+void SFFT2DNativeInterface::Locate() {
+  const Parameters& p = parameters_;
+  if (epoch_ == kMaxEpoch) {
+    std::fill(scores_.begin(), scores_.end(), 0);
+    epoch_ = 0;
+  }
+  ++epoch_;
+  candidates_.clear();
+
+  for (size_t ll = 0; ll < p.loops_loc; ++ll) {
+    SelectTopK(loops_[ll].buckets, p.B_row_loc * p.B_col_loc, p.B_thresh,
+               &selected_);
+    for (size_t ii = 0; ii < selected_.size(); ++ii) {
+      size_t bucket_row = selected_[ii] / p.B_col_loc;
+      size_t bucket_col = selected_[ii] % p.B_col_loc;
+      if (cols_power_of_two_) {
+        Vote<PowerOfTwoModulus>(loops_[ll], bucket_row, bucket_col);
+      } else {
+        Vote<GeneralModulus>(loops_[ll], bucket_row, bucket_col);
+      }
+    }
+  }
+}
+
+template <typename Modulus>
+void SFFT2DNativeInterface::EstimateCandidates() {
+  GeneralModulus rows(rows_);
+  Modulus cols(cols_);
+  GeneralModulus n(n_);
+  double scale = std::sqrt(static_cast<double>(n_));
+  estimates_.resize(candidates_.size());
+  for (size_t cc = 0; cc < candidates_.size(); ++cc) {
+    uint64_t f_row = candidates_[cc] / cols_;
+    uint64_t f_col = candidates_[cc] % cols_;
+    for (size_t ll = 0; ll < loops_.size(); ++ll) {
+      const Loop& loop = loops_[ll];
+      size_t B_row = loop.row_filter->B();
+      size_t B_col = loop.col_filter->B();
+      int64_t offset_row, offset_col;
+      size_t bucket_row = BucketOf(rows.Mul(loop.row.sigma, f_row),
+                                   rows_ / B_row, B_row, &offset_row);
+      size_t bucket_col = BucketOf(cols.Mul(loop.col.sigma, f_col),
+                                   cols_ / B_col, B_col, &offset_col);
+      // Undo the phase shift of tau and the filter attenuation.
+      uint64_t shift = n.Add(rows.Mul(f_row, loop.row.tau) * cols_,
+                             cols.Mul(f_col, loop.col.tau) * rows_);
+      std::complex<double> value = loop.buckets[bucket_row * B_col
+                                                + bucket_col]
+          * twiddles_[shift]
+          * (scale / (loop.row_filter->freq(offset_row)
+                      * loop.col_filter->freq(offset_col)));
+      median_real_[ll] = value.real();
+      median_imag_[ll] = value.imag();
+    }
+    estimates_[cc] = std::complex<double>(Median(&median_real_),
+                                          Median(&median_imag_));
+  }
+}
+
+void SFFT2DNativeInterface::Estimate(SparseSignal* output) {
+  if (cols_power_of_two_) {
+    EstimateCandidates<PowerOfTwoModulus>();
+  } else {
+    EstimateCandidates<GeneralModulus>();
+  }
+
+  // Keep the k largest estimates.
+  SelectTopK(estimates_.data(), estimates_.size(), k_, &selected_);
+  output->Clear();
+  for (size_t ii = 0; ii < selected_.size(); ++ii) {
+    output->Add(candidates_[selected_[ii]], estimates_[selected_[ii]]);
+  }
+  output->Normalize();
+}
+
+bool SFFT2DNativeInterface::RunTrialSparse(const std::complex<double>* input,
+                                           SparseSignal* output,
+                                           double* running_time) {
+  // The phase timers are only read if phase timing is enabled.
+  PerfCounters::StartRegion();
+  Timer timer;
+  Timer phase_timer;
+  PermuteFilter(input);
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_PERMUTE_FILTER] =
+        phase_timer.GetElapsedSeconds();
+    phase_timer = Timer();
+  }
+  BucketFFT();
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_BUCKET_FFT] =
+        phase_timer.GetElapsedSeconds();
+    phase_timer = Timer();
+  }
+  Locate();
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_LOCATION] = phase_timer.GetElapsedSeconds();
+    phase_timer = Timer();
+  }
+  Estimate(output);
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_ESTIMATION] =
+        phase_timer.GetElapsedSeconds();
+    last_phase_times_.valid = true;
+  }
+  *running_time = timer.GetElapsedSeconds();
+  PerfCounters::StopRegion();
+  return true;
+}
+
+SFFT2DNativeInterface::~SFFT2DNativeInterface() {
+  if (plan_est_ != nullptr) {
+    fftw_destroy_plan(plan_est_);
+  }
+  if (plan_loc_ != nullptr) {
+    fftw_destroy_plan(plan_loc_);
+  }
+  if (buckets_ != nullptr) {
+    fftw_free(buckets_);
+  }
+}
@@ -0,0 +1,162 @@
+#ifndef __SFFT2D_NATIVE_INTERFACE_H__
+#define __SFFT2D_NATIVE_INTERFACE_H__
+
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <fftw3.h>
+
+#include "fft_interface.h"
+#include "flat_filter.h"
+#include "sfft_native_kernels.h"
+#include "tuning_database.h"
+
+// Sparse FFT of a rows x cols signal in row-major order (the 2D analogue of
+// the native SFFT 1.0 in SFFTNativeInterface). Frequencies are reported as
+// row-major indices f_row * cols + f_col.
+//
+// Each loop permutes the two axes independently, (t_row, t_col) ->
+// (sigma_row t_row + tau_row, sigma_col t_col + tau_col), multiplies with
+// the product of a flat window filter per axis, and folds the result into
+// B_row x B_col buckets, whose 2D FFT hashes every frequency into one bucket.
+// Location and estimation work as in 1D. Since the permutation is separable,
+// two frequencies in the same row (or column) collide with probability
+// 1 / B_col (1 / B_row) instead of 1 / (B_row B_col).
+//
+// The bucketing runs over the rows in the support of the row filter; each of
+// these rows is folded with the 1D permute-and-filter kernel and added to
+// the buckets with the weight of the row filter. The column gathers stay
+// within one row, so for moderate row lengths they hit the L2 cache.
+class SFFT2DNativeInterface : public FFTInterface {
+ public:
+  struct Parameters {
+    // Buckets per axis of the location and estimation loops (divisors of
+    // rows and cols).
+    size_t B_row_loc;
+    size_t B_col_loc;
+    size_t B_row_est;
+    size_t B_col_est;
+    // Number of buckets selected per location loop.
+    size_t B_thresh;
+    size_t loops_loc;
+    size_t loops_est;
+    // Minimum number of votes of a candidate frequency.
+    size_t loops_thresh;
+    // Leakage of the location and estimation filters (per axis).
+    double tolerance_loc;
+    double tolerance_est;
+    // Width of the filter transition band relative to the width of a bucket.
+    double transition;
+  };
+
+  // The tunable parameters and their defaults. The total numbers of buckets
+  // are Bcst_loc * sqrt(nk / log2 n) and Bcst_est * sqrt(nk / log2 n)
+  // (n = rows * cols), split between the axes in proportion to their
+  // lengths.
+  static std::vector<TunableParameter> TunableParameters(size_t n, size_t k);
+
+  static bool GetParameters(size_t rows, size_t cols, size_t k,
+                            const TuningParameters& tuning,
+                            Parameters* parameters);
+
+  // planning_flags is the FFTW planner rigor of the bucket FFTs.
+  SFFT2DNativeInterface(size_t rows, size_t cols, size_t k,
+                        unsigned int planning_flags,
+                        const TuningParameters& tuning = TuningParameters());
+
+  bool Setup();
+
+  bool HasSparseOutput() const {
+    return true;
+  }
+
+  bool RunTrialSparse(const std::complex<double>* input,
+                      SparseSignal* output,
+                      double* running_time);
+
+  bool SetPhaseTiming(bool enabled) {
+    phase_timing_ = enabled;
+    last_phase_times_.valid = false;
+    return true;
+  }
+
+  bool GetLastPhaseTimes(PhaseTimes* times) const {
+    *times = last_phase_times_;
+    return last_phase_times_.valid;
+  }
+
+  ~SFFT2DNativeInterface();
+
+ private:
+  // The permutation of one axis, x -> sigma x + tau modulo the axis length.
+  struct AxisPermutation {
+    uint64_t sigma;
+    uint64_t sigma_inverse;
+    uint64_t tau;
+  };
+
+  struct Loop {
+    AxisPermutation row;
+    AxisPermutation col;
+    const FlatFilter* row_filter;
+    const FlatFilter* col_filter;
+    // Number of positions per gathered tile (a divisor of the col filter's B).
+    size_t tile_size;
+    // B_row x B_col buckets in row-major order.
+    std::complex<double>* buckets;
+  };
+
+  size_t rows_;
+  size_t cols_;
+  size_t n_;
+  size_t k_;
+  unsigned int planning_flags_;
+  TuningParameters tuning_;
+  Parameters parameters_;
+  bool cols_power_of_two_;
+
+  FlatFilter row_filter_loc_;
+  FlatFilter col_filter_loc_;
+  FlatFilter row_filter_est_;
+  FlatFilter col_filter_est_;
+  std::vector<Loop> loops_;
+  fftw_complex* buckets_;
+  fftw_plan plan_loc_;
+  fftw_plan plan_est_;
+  std::mt19937_64 rng_;
+  TwiddleTable twiddles_;
+
+  std::vector<std::complex<double>> tile_;
+  // Buckets of one folded row.
+  std::vector<std::complex<double>> row_buckets_;
+  // Vote counts with epochs, as in SFFTNativeInterface.
+  std::vector<uint32_t> scores_;
+  uint32_t epoch_;
+  std::vector<size_t> selected_;
+  std::vector<size_t> candidates_;
+  std::vector<std::complex<double>> estimates_;
+  std::vector<double> median_real_;
+  std::vector<double> median_imag_;
+
+  bool phase_timing_;
+  PhaseTimes last_phase_times_;
+
+  void DrawPermutation(size_t n, AxisPermutation* permutation);
+  template <typename Modulus>
+  void PermuteFilterLoop(const std::complex<double>* input, const Loop& loop);
+  void PermuteFilter(const std::complex<double>* input);
+  void BucketFFT();
+  void Locate();
+  void Estimate(SparseSignal* output);
+  template <typename Modulus>
+  void EstimateCandidates();
+  template <typename Modulus>
+  void Vote(const Loop& loop, size_t bucket_row, size_t bucket_col);
+
+  SFFT2DNativeInterface(const SFFT2DNativeInterface&) = delete;
+  SFFT2DNativeInterface& operator=(const SFFT2DNativeInterface&) = delete;
+};
+
+#endif
@@ -3,9 +3,15 @@
 #include <cstdio>
 #include <cstring>
 
+#include "perf_counters.h"
 #include "timer.h"
 
 bool SFFTETHInterface::Setup() {
+  if ((n_ & (n_ - 1)) != 0) {
+    fprintf(stderr, "SFFT-ETH requires n to be a power of two (n = %lu). "
+                    "Use sfft1-native or sfft2-native for other n.\n", n_);
+    return false;
+  }
   input_ = (complex_t*) sfft_malloc(sizeof(complex_t) * n_);
   if (input_ == nullptr) {
     return false;
@@ -37,31 +43,31 @@ bool SFFTETHInterface::Setup() {
   return true;
 }
 
-bool SFFTETHInterface::RunTrial(const std::vector<std::complex<double>>& input,
-                                std::vector<std::complex<double>>* output,
-                                double* running_time) {
-  if (input.size() != n_) {
-    return false;
-  }
-  memcpy(input_, input.data(), sizeof(complex_t) * n_);
-
+bool SFFTETHInterface::RunTrialSparse(const std::complex<double>* input,
+                                      SparseSignal* output,
+                                      double* running_time) {
+  // Copy and rescale the input in a single pass.
   double rescaling = sqrt(n_); 
-  for (size_t ii = 0; ii < n_; ++ii) {
-    input_[ii] *= rescaling;
+  const double* src = reinterpret_cast<const double*>(input);
+  double* dst = reinterpret_cast<double*>(input_);
+  for (size_t ii = 0; ii < 2 * n_; ++ii) {
+    dst[ii] = rescaling * src[ii];
   }
 
   output_.clear();
 
+  PerfCounters::StartRegion();
   Timer timer; 
   sfft_exec(plan_, input_, &output_);
   *running_time = timer.GetElapsedSeconds();
+  PerfCounters::StopRegion();
 
-  output->resize(n_);
-  output->assign(n_, std::complex<double>(0.0, 0.0));
+  output->Clear();
   for (auto kv : output_) {
-    (*output)[kv.first].real(creal(kv.second));
-    (*output)[kv.first].imag(cimag(kv.second));
+    output->Add(kv.first, std::complex<double>(creal(kv.second),
+                                               cimag(kv.second)));
   }
+  output->Normalize();
   return true;
 }
 
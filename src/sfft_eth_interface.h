@@ -18,9 +18,13 @@ class SFFTETHInterface : public FFTInterface {
 
   bool Setup();
 
-  bool RunTrial(const std::vector<std::complex<double>>& input,
-                std::vector<std::complex<double>>* output,
-                double* running_time);
+  bool HasSparseOutput() const {
+    return true;
+  }
+
+  bool RunTrialSparse(const std::complex<double>* input,
+                      SparseSignal* output,
+                      double* running_time);
 
   ~SFFTETHInterface();
 
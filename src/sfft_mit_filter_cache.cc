@@ -0,0 +1,189 @@
+#include "sfft_mit_filter_cache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'S', 'F', 'T', 'F', 'L', 'T', '0', '1'};
+const size_t kAlignment = 64;
+
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t DoubleBits(double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+uint64_t KeyHash(const SFFTMITFilterCache::Key& key) {
+  uint64_t h = Mix(key.n);
+  h = Mix(h ^ DoubleBits(key.lobefrac));
+  h = Mix(h ^ DoubleBits(key.tolerance));
+  h = Mix(h ^ static_cast<uint64_t>(key.b));
+  return h;
+}
+
+// File header (kAlignment bytes). All entries are stored in native byte
+// order.
+struct Header {
+  char magic[8];
+  uint64_t key_hash;
+  uint64_t n;
+  double lobefrac;
+  double tolerance;
+  int64_t b;
+  uint64_t sizet;
+  uint64_t reserved;
+};
+
+static_assert(sizeof(Header) == kAlignment, "Unexpected header size.");
+
+size_t RoundUp(size_t x) {
+  return (x + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+size_t FreqOffset(size_t sizet) {
+  return sizeof(Header) + RoundUp(sizet * sizeof(complex_t));
+}
+
+size_t FileLength(size_t n, size_t sizet) {
+  return FreqOffset(sizet) + n * sizeof(complex_t);
+}
+
+}  // namespace
+
+void ReleaseFilter(CachedFilter* filter) {
+  if (filter->mapping != nullptr) {
+    munmap(filter->mapping, filter->mapping_length);
+  } else {
+    if (filter->filter.time != nullptr) {
+      free(filter->filter.time);
+    }
+    if (filter->filter.freq != nullptr) {
+      free(filter->filter.freq);
+    }
+  }
+  *filter = CachedFilter();
+}
+
+std::string SFFTMITFilterCache::GetFilename(const Key& key) const {
+  std::ostringstream name;
+  name << directory_ << "/sfft_mit_filter_n_" << key.n << "_b_" << key.b
+       << "_" << std::hex << KeyHash(key) << ".bin";
+  return name.str();
+}
+
+bool SFFTMITFilterCache::Load(const Key& key, CachedFilter* filter) const {
+  if (!enabled()) {
+    return false;
+  }
+  std::string filename = GetFilename(key);
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  bool valid = (fstat(fd, &file_stat) == 0
+                && static_cast<size_t>(file_stat.st_size) >= sizeof(Header));
+  void* data = MAP_FAILED;
+  size_t length = 0;
+  if (valid) {
+    length = file_stat.st_size;
+    // Private and writable, so the filters have the same access as when they
+    // are computed (the library does not modify them).
+    data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    valid = (data != MAP_FAILED);
+  }
+  close(fd);
+
+  if (valid) {
+    const Header* header = static_cast<const Header*>(data);
+    valid = memcmp(header->magic, kMagic, sizeof(kMagic)) == 0
+        && header->key_hash == KeyHash(key)
+        && header->n == key.n
+        && header->lobefrac == key.lobefrac
+        && header->tolerance == key.tolerance
+        && header->b == key.b
+        && header->sizet > 0 && header->sizet <= key.n
+        && length == FileLength(key.n, header->sizet);
+  }
+  if (!valid) {
+    if (data != MAP_FAILED) {
+      munmap(data, length);
+    }
+    fprintf(stderr, "Ignoring invalid filter cache entry %s.\n",
+        filename.c_str());
+    return false;
+  }
+
+  const Header* header = static_cast<const Header*>(data);
+  char* bytes = static_cast<char*>(data);
+  filter->filter.time = reinterpret_cast<complex_t*>(bytes + sizeof(Header));
+  filter->filter.sizet = header->sizet;
+  filter->filter.freq = reinterpret_cast<complex_t*>(
+      bytes + FreqOffset(header->sizet));
+  filter->mapping = data;
+  filter->mapping_length = length;
+  return true;
+}
+
+bool SFFTMITFilterCache::Store(const Key& key, const Filter& filter) const {
+  if (!enabled()) {
+    return false;
+  }
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.key_hash = KeyHash(key);
+  header.n = key.n;
+  header.lobefrac = key.lobefrac;
+  header.tolerance = key.tolerance;
+  header.b = key.b;
+  header.sizet = filter.sizet;
+
+  size_t time_bytes = filter.sizet * sizeof(complex_t);
+  char padding[kAlignment];
+  memset(padding, 0, sizeof(padding));
+
+  std::string filename = GetFilename(key);
+  std::ostringstream tmp_name;
+  tmp_name << filename << ".tmp." << getpid() << "."
+           << std::this_thread::get_id();
+  FILE* file = fopen(tmp_name.str().c_str(), "wb");
+  if (file == nullptr) {
+    fprintf(stderr, "Could not open file %s.\n", tmp_name.str().c_str());
+    return false;
+  }
+  size_t num_padding = RoundUp(time_bytes) - time_bytes;
+  bool success = (fwrite(&header, sizeof(header), 1, file) == 1)
+      && (fwrite(filter.time, 1, time_bytes, file) == time_bytes)
+      && (fwrite(padding, 1, num_padding, file) == num_padding)
+      && (fwrite(filter.freq, sizeof(complex_t), key.n, file) == key.n);
+  if (fclose(file) != 0) {
+    success = false;
+  }
+  if (!success || rename(tmp_name.str().c_str(), filename.c_str()) != 0) {
+    fprintf(stderr, "Could not write filter cache entry %s.\n",
+        filename.c_str());
+    remove(tmp_name.str().c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,63 @@
+#ifndef __SFFT_MIT_FILTER_CACHE_H__
+#define __SFFT_MIT_FILTER_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "sfft_mit/filters.h"
+
+// A filter of the SFFT-MIT library. The arrays are either allocated with
+// malloc (as returned by make_multiple_t) or point into a memory-mapped
+// cache file (mapping is not null).
+struct CachedFilter {
+  CachedFilter() : filter(), mapping(nullptr), mapping_length(0) {}
+
+  Filter filter;
+  void* mapping;
+  size_t mapping_length;
+};
+
+// Frees the arrays of the filter or unmaps its cache file.
+void ReleaseFilter(CachedFilter* filter);
+
+// Persistent cache for the SFFT-MIT filters. Computing a filter
+// (make_dolphchebyshev_t and make_multiple_t) costs two n-point FFTs and
+// n-element allocations in every process; with the cache, Setup maps the
+// time and frequency arrays of an earlier run instead.
+//
+// Entries are keyed by n, lobefrac, tolerance, and b, which determine the
+// filter. Each entry is a file with a header followed by the time array
+// (sizet elements) and the frequency array (n elements), each aligned to 64
+// bytes. Files are mapped copy-on-write, so processes using the same filter
+// share its pages. As in ReferenceCache, files are written to a temporary
+// file first and then renamed.
+class SFFTMITFilterCache {
+ public:
+  struct Key {
+    size_t n;
+    double lobefrac;
+    double tolerance;
+    int b;
+  };
+
+  // An empty directory disables the cache.
+  explicit SFFTMITFilterCache(const std::string& directory)
+      : directory_(directory) {}
+
+  bool enabled() const {
+    return !directory_.empty();
+  }
+
+  // Maps the entry for key. Returns false if there is no (valid) entry.
+  bool Load(const Key& key, CachedFilter* filter) const;
+
+  bool Store(const Key& key, const Filter& filter) const;
+
+ private:
+  std::string directory_;
+
+  std::string GetFilename(const Key& key) const;
+};
+
+#endif
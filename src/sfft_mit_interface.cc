@@ -1,17 +1,43 @@
 #include "sfft_mit_interface.h"
 
-#include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "sfft_mit/computefourier.h"
 #include "sfft_mit/parameters.h"
 #include "sfft_mit/utils.h"
 
+#include "perf_counters.h"
+#include "phase_timing.h"
 #include "timer.h"
 
+std::vector<TunableParameter> SFFTMITInterface::TunableParameters(
+    size_t /* n */, size_t /* k */, Version version) {
+  std::vector<TunableParameter> space = {
+    {"Bcst_loc", 1.0, {0.25, 0.5, 1.0, 2.0, 4.0}},
+    {"Bcst_est", 1.0, {0.25, 0.5, 1.0, 2.0, 4.0}},
+    {"loops_loc", 4, {1, 2, 3, 4, 5, 6, 8}},
+    {"loops_est", 16, {2, 4, 8, 12, 16, 24}},
+    {"loops_thresh", 3, {1, 2, 3, 4, 5, 6}},
+    {"tolerance_loc", 1e-8, {1e-4, 1e-6, 1e-8, 1e-10}},
+    {"tolerance_est", 1e-8, {1e-4, 1e-6, 1e-8, 1e-10}},
+  };
+  if (version == Version::SFFT_2) {
+    space.push_back({"Comb_cst", 2.0, {1.0, 2.0, 4.0, 8.0, 16.0}});
+    space.push_back({"Comb_loops", 1, {1, 2, 4}});
+  }
+  return space;
+}
+
 bool SFFTMITInterface::InternalSetup() {
+  if ((n_ & (n_ - 1)) != 0) {
+    fprintf(stderr, "SFFT-MIT requires n to be a power of two (n = %lu). "
+                    "Use sfft1-native or sfft2-native for other n.\n", n_);
+    return false;
+  }
   input_ = (complex_t*) malloc(sizeof(complex_t) * n_);
   if (input_ == nullptr) {
     return false;
@@ -34,29 +60,50 @@ bool SFFTMITInterface::InternalSetup() {
   double tolerance_loc = 1.0e-8;
   double tolerance_est = 1.0e-8;
 
-  loops_loc_ = -1;
-
-  if (k_ == 50) {
-    get_expermient_vs_N_parameters(n_, use_comb, Bcst_loc, Bcst_est, Comb_cst,
-        loops_loc_, loops_est_, loops_thresh_, Comb_loops_, tolerance_loc,
-        tolerance_est);
-  } else if (n_ == 4194304) {
-    get_expermient_vs_K_parameters(k_, use_comb, Bcst_loc, Bcst_est, Comb_cst,
-        loops_loc_, loops_est_, loops_thresh_, Comb_loops_, tolerance_loc,
-        tolerance_est);
+  if (!tuning_.empty()) {
+    std::vector<TunableParameter> space = TunableParameters(n_, k_, version_);
+    if (!CheckTuningParameters(tuning_, space,
+                               use_comb ? "sfft2-mit" : "sfft1-mit")) {
+      return false;
+    }
+    Bcst_loc = GetTuningParameter(tuning_, "Bcst_loc", Bcst_loc);
+    Bcst_est = GetTuningParameter(tuning_, "Bcst_est", Bcst_est);
+    Comb_cst = GetTuningParameter(tuning_, "Comb_cst", Comb_cst);
+    loops_loc_ = GetTuningParameter(tuning_, "loops_loc", loops_loc_);
+    loops_est_ = GetTuningParameter(tuning_, "loops_est", loops_est_);
+    loops_thresh_ = GetTuningParameter(tuning_, "loops_thresh",
+                                       loops_thresh_);
+    Comb_loops_ = GetTuningParameter(tuning_, "Comb_loops", Comb_loops_);
+    tolerance_loc = GetTuningParameter(tuning_, "tolerance_loc",
+                                       tolerance_loc);
+    tolerance_est = GetTuningParameter(tuning_, "tolerance_est",
+                                       tolerance_est);
   } else {
-    fprintf(stderr, "Set of parameters n, k for which SFFT_MIT parameters are "
-                    "not known.\n");
-    return false;
-  }
-
-  if (loops_loc_ == -1) {
-    fprintf(stderr, "Set of parameters n, k for which SFFT_MIT parameters are "
-        "not known.\n");
+    loops_loc_ = -1;
+    if (k_ == 50) {
+      get_expermient_vs_N_parameters(n_, use_comb, Bcst_loc, Bcst_est,
+          Comb_cst, loops_loc_, loops_est_, loops_thresh_, Comb_loops_,
+          tolerance_loc, tolerance_est);
+    } else if (n_ == 4194304) {
+      get_expermient_vs_K_parameters(k_, use_comb, Bcst_loc, Bcst_est,
+          Comb_cst, loops_loc_, loops_est_, loops_thresh_, Comb_loops_,
+          tolerance_loc, tolerance_est);
+    }
+    if (loops_loc_ == -1) {
+      fprintf(stderr, "Set of parameters n, k for which SFFT_MIT parameters "
+          "are not known. Tune them with tune_parameters and pass the "
+          "tuning database with --tuning_db.\n");
+      return false;
+    }
   }
 
   real_t BB_loc = (unsigned) (Bcst_loc * sqrt((double) n_ * k_ / log2(n_)));
   real_t BB_est = (unsigned) (Bcst_est * sqrt((double) n_ * k_ / log2(n_)));
+  if (BB_loc < 1 || BB_est < 1) {
+    fprintf(stderr, "Invalid SFFT-MIT parameters for n = %lu, k = %lu.\n",
+            n_, k_);
+    return false;
+  }
 
   double lobefrac_loc = 0.5 / (BB_loc);
   double lobefrac_est = 0.5 / (BB_est);
@@ -69,40 +116,51 @@ bool SFFTMITInterface::InternalSetup() {
 
   W_Comb_ = sfft_mit::floor_to_pow2(Comb_cst * n_ / B_loc_);
 
-  if (use_comb) {
-    assert(B_thresh_ < W_Comb_);
+  // Tuned parameters can violate the assumptions of the library, which it
+  // only checks with asserts.
+  if ((use_comb && (B_thresh_ >= W_Comb_ || Comb_loops_ < 1))
+      || B_thresh_ >= B_loc_ || loops_loc_ < 1 || loops_thresh_ < 1
+      || loops_thresh_ > loops_loc_ || loops_est_ < 0
+      || b_loc >= static_cast<int>(n_)
+      || b_est >= static_cast<int>(n_)) {
+    fprintf(stderr, "Invalid SFFT-MIT parameters for n = %lu, k = %lu.\n",
+            n_, k_);
+    return false;
   }
-  assert(B_thresh_ < B_loc_);
-  assert(loops_thresh_ <= loops_loc_);
-
-  int w_loc;
-  complex_t* filtert = make_dolphchebyshev_t(lobefrac_loc, tolerance_loc,
-      w_loc);
-  filter_ = make_multiple_t(filtert, w_loc, n_, b_loc);
 
-  int w_est;
-  complex_t* filtert_est = make_dolphchebyshev_t(lobefrac_est, tolerance_est,
-      w_est);
-  filter_est_ = make_multiple_t(filtert_est, w_est, n_, b_est);
+  GetFilter(lobefrac_loc, tolerance_loc, b_loc, &filter_storage_);
+  filter_ = filter_storage_.filter;
+  GetFilter(lobefrac_est, tolerance_est, b_est, &filter_est_storage_);
+  filter_est_ = filter_est_storage_.filter;
 
   return true;
 }
 
+void SFFTMITInterface::GetFilter(double lobefrac, double tolerance, int b,
+                                 CachedFilter* filter) {
+  SFFTMITFilterCache::Key key = {n_, lobefrac, tolerance, b};
+  if (filter_cache_.Load(key, filter)) {
+    return;
+  }
+  int w;
+  complex_t* filtert = make_dolphchebyshev_t(lobefrac, tolerance, w);
+  filter->filter = make_multiple_t(filtert, w, n_, b);
+  filter_cache_.Store(key, filter->filter);
+}
+
 bool SFFTMITInterface::Setup() {
   return InternalSetup();
 }
 
-bool SFFTMITInterface::RunTrial(const std::vector<std::complex<double>>& input,
-                                std::vector<std::complex<double>>* output,
-                                double* running_time) {
-  if (input.size() != n_) {
-    return false;
-  }
-  memcpy(input_, input.data(), sizeof(complex_t) * n_);
-
+bool SFFTMITInterface::RunTrialSparse(const std::complex<double>* input,
+                                      SparseSignal* output,
+                                      double* running_time) {
+  // Copy and rescale the input in a single pass.
   double rescaling = sqrt(n_); 
-  for (size_t ii = 0; ii < n_; ++ii) {
-    input_[ii] *= rescaling;
+  const double* src = reinterpret_cast<const double*>(input);
+  double* dst = reinterpret_cast<double*>(input_);
+  for (size_t ii = 0; ii < 2 * n_; ++ii) {
+    dst[ii] = rescaling * src[ii];
   }
 
   output_.clear();
@@ -120,19 +178,46 @@ bool SFFTMITInterface::RunTrial(const std::vector<std::complex<double>>& input,
       cimag(filter_est_.time[10]), creal(filter_est_.freq[10]),
       creal(filter_est_.freq[10]));*/
 
+  // The TIMING flag is global, so it is only set for the duration of the
+  // trial (another instance may not use phase timing).
+  StdoutCapture capture;
+  if (phase_timing_) {
+    if (!capture.Start()) {
+      fprintf(stderr, "Could not capture the SFFT-MIT timers.\n");
+      return false;
+    }
+    sfft_mit::TIMING = true;
+  }
+
+  PerfCounters::StartRegion();
   Timer timer; 
   output_ = outer_loop(input_, n_, filter_, filter_est_, B_est_, B_thresh_,
       B_loc_, W_Comb_, Comb_loops_, loops_thresh_, loops_loc_,
       loops_loc_ + loops_est_);
   *running_time = timer.GetElapsedSeconds();
+  PerfCounters::StopRegion();
+
+  if (phase_timing_) {
+    sfft_mit::TIMING = false;
+    std::string timers;
+    if (!capture.Stop(&timers)) {
+      return false;
+    }
+    static bool warned = false;
+    if (!ParseSFFTMITTimingOutput(timers, &last_phase_times_) && !warned) {
+      fprintf(stderr, "Warning: no SFFT-MIT timers in the output of "
+                      "outer_loop.\n");
+      warned = true;
+    }
+  }
 
-  output->resize(n_);
-  output->assign(n_, std::complex<double>(0.0, 0.0));
+  // output_ is a std::map and hence already sorted by frequency.
+  output->Clear();
   for (auto kv : output_) {
-    (*output)[kv.first].real(creal(kv.second));
-    (*output)[kv.first].imag(cimag(kv.second));
+    output->Add(kv.first, std::complex<double>(creal(kv.second),
+                                               cimag(kv.second)));
   }
-  
+
   return true;
 }
 
@@ -144,16 +229,6 @@ void SFFTMITInterface::InternalTearDown() {
   if (input_ != nullptr) {
     free(input_);
   }
-  if (filter_.freq != nullptr) {
-    free(filter_.freq);
-  }
-  if (filter_.time != nullptr) {
-    free(filter_.time);
-  }
-  if (filter_est_.freq != nullptr) {
-    free(filter_est_.freq);
-  }
-  if (filter_est_.time != nullptr) {
-    free(filter_est_.time);
-  }
+  ReleaseFilter(&filter_storage_);
+  ReleaseFilter(&filter_est_storage_);
 }
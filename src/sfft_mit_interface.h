@@ -2,11 +2,15 @@
 #define __SFFT_MIT_INTERFACE_H__
 
 #include <map>
+#include <string>
+#include <vector>
 
 #include "sfft_mit/fft.h"
 #include "sfft_mit/filters.h"
 
 #include "fft_interface.h"
+#include "sfft_mit_filter_cache.h"
+#include "tuning_database.h"
 
 class SFFTMITInterface : public FFTInterface {
  public:
@@ -15,14 +19,46 @@ class SFFTMITInterface : public FFTInterface {
     SFFT_2,
   };
 
-  SFFTMITInterface(size_t n, size_t k, Version version) : version_(version),
-      n_(n), k_(k) {};
+  // The library only has parameters for k = 50 or n = 2^22. For other n
+  // and k, tuned parameters are required (all parameters that are not set
+  // keep the defaults of the parameter space). If filter_cache_dir is not
+  // empty, the filters are loaded from (and stored in) the filter cache in
+  // that directory.
+  SFFTMITInterface(size_t n, size_t k, Version version,
+                   const TuningParameters& tuning = TuningParameters(),
+                   const std::string& filter_cache_dir = "")
+      : version_(version), n_(n), k_(k), tuning_(tuning),
+        filter_cache_(filter_cache_dir), input_(nullptr), filter_(),
+        filter_est_(), phase_timing_(false) {};
+
+  // The tunable parameters of the library and their generic defaults.
+  static std::vector<TunableParameter> TunableParameters(size_t n, size_t k,
+                                                         Version version);
 
   bool Setup();
 
-  bool RunTrial(const std::vector<std::complex<double>>& input,
-                std::vector<std::complex<double>>* output,
-                double* running_time);
+  bool HasSparseOutput() const {
+    return true;
+  }
+
+  bool RunTrialSparse(const std::complex<double>* input,
+                      SparseSignal* output,
+                      double* running_time);
+
+  // Sets sfft_mit::TIMING during the trials and parses the timers that the
+  // library prints to stdout. The library keeps no other record of them, and
+  // the printing is part of the timed region, so run_experiment only enables
+  // this for separate runs whose running times are discarded.
+  bool SetPhaseTiming(bool enabled) {
+    phase_timing_ = enabled;
+    last_phase_times_.valid = false;
+    return true;
+  }
+
+  bool GetLastPhaseTimes(PhaseTimes* times) const {
+    *times = last_phase_times_;
+    return last_phase_times_.valid;
+  }
 
   ~SFFTMITInterface();
 
@@ -30,6 +66,8 @@ class SFFTMITInterface : public FFTInterface {
   Version version_;
   size_t n_;
   size_t k_;
+  TuningParameters tuning_;
+  SFFTMITFilterCache filter_cache_;
   complex_t* input_;
   std::map<int, complex_t> output_;
 
@@ -41,11 +79,20 @@ class SFFTMITInterface : public FFTInterface {
   int loops_thresh_;
   int loops_loc_;
   int loops_est_;
+  // The filters passed to the library (views of the storage below).
   Filter filter_;
   Filter filter_est_;
+  CachedFilter filter_storage_;
+  CachedFilter filter_est_storage_;
+  bool phase_timing_;
+  PhaseTimes last_phase_times_;
 
   bool InternalSetup();
 
+  // Loads the filter from the cache or computes (and caches) it.
+  void GetFilter(double lobefrac, double tolerance, int b,
+                 CachedFilter* filter);
+
   void InternalTearDown();
 };
 
@@ -0,0 +1,403 @@
+#include "sfft_native_interface.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "perf_counters.h"
+#include "sfft_native_kernels.h"
+#include "timer.h"
+#include "top_k.h"
+
+namespace {
+
+const uint64_t kSeed = 0x5ff7a71e;
+// The vote count is stored in the low kScoreBits bits of a score.
+const int kScoreBits = 8;
+const uint32_t kMaxEpoch = (1u << (32 - kScoreBits)) - 1;
+
+}  // namespace
+
+std::vector<TunableParameter> SFFTNativeInterface::TunableParameters(
+    size_t /* n */, size_t /* k */, Version version) {
+  std::vector<TunableParameter> space = {
+    {"Bcst_loc", 1.0, {0.25, 0.5, 1.0, 2.0, 4.0}},
+    {"Bcst_est", 1.0, {0.25, 0.5, 1.0, 2.0, 4.0}},
+    {"loops_est", 16, {0, 2, 4, 8, 12, 16, 24}},
+    {"tolerance_loc", 1e-8, {1e-4, 1e-6, 1e-8, 1e-10}},
+    {"tolerance_est", 1e-8, {1e-4, 1e-6, 1e-8, 1e-10}},
+    {"transition", 1.0, {0.5, 1.0, 2.0}},
+  };
+  if (version == Version::SFFT_2) {
+    // The comb filter removes most false candidates, so fewer location loops
+    // are needed. Frequencies congruent modulo W_comb can cancel in one comb
+    // loop, hence two loops by default.
+    space.push_back({"loops_loc", 2, {1, 2, 3, 4}});
+    space.push_back({"loops_thresh", 2, {1, 2, 3, 4}});
+    space.push_back({"Comb_cst", 2.0, {1.0, 2.0, 4.0, 8.0, 16.0}});
+    space.push_back({"Comb_loops", 2, {1, 2, 4}});
+  } else {
+    space.push_back({"loops_loc", 4, {2, 3, 4, 5, 6, 8}});
+    space.push_back({"loops_thresh", 3, {1, 2, 3, 4, 5, 6}});
+  }
+  return space;
+}
+
+bool SFFTNativeInterface::GetParameters(size_t n, size_t k, Version version,
+                                        const TuningParameters& tuning,
+                                        Parameters* parameters) {
+  std::vector<TunableParameter> space = TunableParameters(n, k, version);
+  const char* algorithm = (version == Version::SFFT_2 ? "sfft2-native"
+                                                      : "sfft1-native");
+  if (!CheckTuningParameters(tuning, space, algorithm)) {
+    return false;
+  }
+  TuningParameters values;
+  for (size_t ii = 0; ii < space.size(); ++ii) {
+    values[space[ii].name] = GetTuningParameter(tuning, space[ii].name,
+                                                space[ii].initial);
+  }
+
+  double log_n = std::max(1.0, std::log2(static_cast<double>(n)));
+  double B = std::sqrt(static_cast<double>(n) * k / log_n);
+  parameters->B_loc = FloorToDivisor(n, values["Bcst_loc"] * B);
+  parameters->B_est = FloorToDivisor(n, values["Bcst_est"] * B);
+  parameters->B_thresh = 2 * k;
+  parameters->loops_loc = values["loops_loc"];
+  parameters->loops_est = values["loops_est"];
+  parameters->loops_thresh = values["loops_thresh"];
+  parameters->tolerance_loc = values["tolerance_loc"];
+  parameters->tolerance_est = values["tolerance_est"];
+  parameters->transition = values["transition"];
+  if (version == Version::SFFT_2) {
+    parameters->W_comb = FloorToDivisor(n,
+        values["Comb_cst"] * n / parameters->B_loc);
+    parameters->comb_loops = values["Comb_loops"];
+  } else {
+    parameters->W_comb = 0;
+    parameters->comb_loops = 0;
+  }
+  return true;
+}
+
+SFFTNativeInterface::SFFTNativeInterface(size_t n, size_t k, Version version,
+                                         unsigned int planning_flags,
+                                         const TuningParameters& tuning)
+    : n_(n), k_(k), version_(version), planning_flags_(planning_flags),
+      tuning_(tuning), use_comb_(version == Version::SFFT_2),
+      power_of_two_(false),
+      buckets_(nullptr), comb_(nullptr), plan_loc_(nullptr),
+      plan_est_(nullptr), plan_comb_(nullptr), rng_(kSeed),
+      epoch_(0), phase_timing_(false) {}
+
+bool SFFTNativeInterface::Setup() {
+  if (!GetParameters(n_, k_, version_, tuning_, &parameters_)) {
+    return false;
+  }
+  const Parameters& p = parameters_;
+  if (n_ < 2 || n_ >= kSFFTMaxSize) {
+    fprintf(stderr, "The native sparse FFT requires 2 <= n < 2^32 "
+                    "(n = %lu).\n", n_);
+    return false;
+  }
+  power_of_two_ = ((n_ & (n_ - 1)) == 0);
+  if (n_ % p.B_loc != 0 || n_ % p.B_est != 0 || p.B_loc >= n_
+      || p.B_est >= n_) {
+    fprintf(stderr, "Invalid numbers of buckets B_loc = %lu, B_est = %lu "
+                    "(n = %lu).\n", p.B_loc, p.B_est, n_);
+    return false;
+  }
+  if (p.B_thresh == 0 || p.B_thresh >= p.B_loc || p.loops_loc == 0
+      || p.loops_thresh == 0 || p.loops_thresh > p.loops_loc
+      || p.loops_thresh >= (1u << kScoreBits)) {
+    fprintf(stderr, "Invalid location parameters: B_thresh = %lu, "
+                    "loops_loc = %lu, loops_thresh = %lu (B_loc = %lu).\n",
+            p.B_thresh, p.loops_loc, p.loops_thresh, p.B_loc);
+    return false;
+  }
+  if (use_comb_ && (n_ % p.W_comb != 0 || p.W_comb > n_
+                    || p.B_thresh >= p.W_comb || p.comb_loops == 0)) {
+    fprintf(stderr, "Invalid comb parameters: W_comb = %lu, comb_loops = %lu "
+                    "(B_thresh = %lu).\n", p.W_comb, p.comb_loops,
+            p.B_thresh);
+    return false;
+  }
+
+  if (!filter_loc_.Create(n_, p.B_loc, p.tolerance_loc, p.transition)) {
+    return false;
+  }
+  if (p.loops_est > 0
+      && !filter_est_.Create(n_, p.B_est, p.tolerance_est, p.transition)) {
+    return false;
+  }
+
+  size_t num_buckets = p.loops_loc * p.B_loc + p.loops_est * p.B_est;
+  buckets_ = fftw_alloc_complex(num_buckets);
+  if (buckets_ == nullptr) {
+    return false;
+  }
+  std::complex<double>* buckets =
+      reinterpret_cast<std::complex<double>*>(buckets_);
+  loops_.resize(p.loops_loc + p.loops_est);
+  for (size_t ii = 0; ii < loops_.size(); ++ii) {
+    if (ii < p.loops_loc) {
+      loops_[ii].filter = &filter_loc_;
+      loops_[ii].buckets = buckets + ii * p.B_loc;
+    } else {
+      loops_[ii].filter = &filter_est_;
+      loops_[ii].buckets = buckets + p.loops_loc * p.B_loc
+                           + (ii - p.loops_loc) * p.B_est;
+    }
+    loops_[ii].tile_size = FloorToDivisor(loops_[ii].filter->B(),
+                                          kSFFTTileSize);
+  }
+
+  // Batched in-place plans for the bucket FFTs of all loops.
+  int B_loc = p.B_loc;
+  plan_loc_ = fftw_plan_many_dft(1, &B_loc, p.loops_loc, buckets_, nullptr, 1,
+      B_loc, buckets_, nullptr, 1, B_loc, FFTW_FORWARD, planning_flags_);
+  if (plan_loc_ == nullptr) {
+    return false;
+  }
+  if (p.loops_est > 0) {
+    int B_est = p.B_est;
+    fftw_complex* est = buckets_ + p.loops_loc * p.B_loc;
+    plan_est_ = fftw_plan_many_dft(1, &B_est, p.loops_est, est, nullptr, 1,
+        B_est, est, nullptr, 1, B_est, FFTW_FORWARD, planning_flags_);
+    if (plan_est_ == nullptr) {
+      return false;
+    }
+  }
+  if (use_comb_) {
+    comb_ = fftw_alloc_complex(p.comb_loops * p.W_comb);
+    if (comb_ == nullptr) {
+      return false;
+    }
+    int W = p.W_comb;
+    plan_comb_ = fftw_plan_many_dft(1, &W, p.comb_loops, comb_, nullptr, 1, W,
+        comb_, nullptr, 1, W, FFTW_FORWARD, planning_flags_);
+    if (plan_comb_ == nullptr) {
+      return false;
+    }
+    comb_allowed_.resize(p.W_comb);
+  }
+
+  twiddles_.Create(n_);
+
+  tile_.resize(kSFFTTileSize);
+  scores_.assign(n_, 0);
+  median_real_.resize(loops_.size());
+  median_imag_.resize(loops_.size());
+  return true;
+}
+
+void SFFTNativeInterface::PermuteFilter(const std::complex<double>* input) {
+  for (size_t ii = 0; ii < loops_.size(); ++ii) {
+    Loop& loop = loops_[ii];
+    // sigma must be invertible modulo n. For n a power of two, the first
+    // (odd) candidate always is.
+    do {
+      loop.sigma = (rng_() | 1) % n_;
+    } while (Gcd(loop.sigma, n_) != 1);
+    loop.sigma_inverse = InverseMod(loop.sigma, n_);
+    loop.tau = rng_() % n_;
+    if (power_of_two_) {
+      PermuteFilterKernel(input, PowerOfTwoModulus(n_), *loop.filter,
+                          loop.tile_size, loop.sigma, loop.tau, tile_.data(),
+                          loop.buckets);
+    } else {
+      PermuteFilterKernel(input, GeneralModulus(n_), *loop.filter,
+                          loop.tile_size, loop.sigma, loop.tau, tile_.data(),
+                          loop.buckets);
+    }
+  }
+
+  if (use_comb_) {
+    // Subsampling with stride n / W_comb aliases the spectrum modulo W_comb.
+    size_t W = parameters_.W_comb;
+    size_t stride = n_ / W;
+    GeneralModulus n(n_);
+    std::complex<double>* comb = reinterpret_cast<std::complex<double>*>(
+        comb_);
+    for (size_t ll = 0; ll < parameters_.comb_loops; ++ll) {
+      uint64_t tau = rng_() % n_;
+      for (size_t ii = 0; ii < W; ++ii) {
+        comb[ll * W + ii] = input[n.Add(tau, ii * stride)];
+      }
+    }
+  }
+}
+
+void SFFTNativeInterface::BucketFFT() {
+  fftw_execute(plan_loc_);
+  if (plan_est_ != nullptr) {
+    fftw_execute(plan_est_);
+  }
+  if (plan_comb_ != nullptr) {
+    fftw_execute(plan_comb_);
+  }
+}
+
+template <typename Modulus>
+void SFFTNativeInterface::Vote(const Loop& loop, size_t bucket) {
+  Modulus n(n_);
+  size_t width = n_ / loop.filter->B();
+  // The permuted frequencies f with round(f B / n) = bucket.
+  uint64_t f = n.Add(bucket * width, n_ - width / 2);
+  uint64_t frequency = n.Mul(loop.sigma_inverse, f);
+  uint32_t threshold = parameters_.loops_thresh;
+  uint32_t epoch_base = epoch_ << kScoreBits;
+  // The residue of the frequency modulo W_comb (a divisor of n, hence a power
+  // of two if n is), updated along with the frequency.
+  Modulus W(use_comb_ ? parameters_.W_comb : 1);
+  uint64_t residue = frequency % W.n();
+  uint64_t residue_step = loop.sigma_inverse % W.n();
+  for (size_t ii = 0; ii < width; ++ii) {
+    if (!use_comb_ || comb_allowed_[residue]) {
+      uint32_t score = scores_[frequency];
+      if ((score >> kScoreBits) != epoch_) {
+        score = epoch_base;
+      }
+      ++score;
+      scores_[frequency] = score;
+      if ((score & ((1u << kScoreBits) - 1)) == threshold) {
+        candidates_.push_back(frequency);
+      }
+    }
+    frequency = n.Add(frequency, loop.sigma_inverse);
+    residue = W.Add(residue, residue_step);
+  }
+}
+
+void SFFTNativeInterface::Locate() {
+  const Parameters& p = parameters_;
+  if (epoch_ == kMaxEpoch) {
+    std::fill(scores_.begin(), scores_.end(), 0);
+    epoch_ = 0;
+  }
+  ++epoch_;
+  candidates_.clear();
+
+  if (use_comb_) {
+    std::fill(comb_allowed_.begin(), comb_allowed_.end(), 0);
+    const std::complex<double>* comb =
+        reinterpret_cast<const std::complex<double>*>(comb_);
+    for (size_t ll = 0; ll < p.comb_loops; ++ll) {
+      SelectTopK(comb + ll * p.W_comb, p.W_comb, p.B_thresh, &selected_);
+      for (size_t ii = 0; ii < selected_.size(); ++ii) {
+        comb_allowed_[selected_[ii]] = 1;
+      }
+    }
+  }
+
+  for (size_t ll = 0; ll < p.loops_loc; ++ll) {
+    SelectTopK(loops_[ll].buckets, p.B_loc, p.B_thresh, &selected_);
+    for (size_t ii = 0; ii < selected_.size(); ++ii) {
+      if (power_of_two_) {
+        Vote<PowerOfTwoModulus>(loops_[ll], selected_[ii]);
+      } else {
+        Vote<GeneralModulus>(loops_[ll], selected_[ii]);
+      }
+    }
+  }
+}
+
+template <typename Modulus>
+void SFFTNativeInterface::EstimateCandidates() {
+  Modulus n(n_);
+  double scale = std::sqrt(static_cast<double>(n_));
+  estimates_.resize(candidates_.size());
+  for (size_t cc = 0; cc < candidates_.size(); ++cc) {
+    uint64_t frequency = candidates_[cc];
+    for (size_t ll = 0; ll < loops_.size(); ++ll) {
+      const Loop& loop = loops_[ll];
+      size_t B = loop.filter->B();
+      size_t width = n_ / B;
+      // The bucket of the permuted frequency and its offset from the bucket
+      // center.
+      uint64_t f = n.Mul(loop.sigma, frequency);
+      uint64_t center = (f + width / 2) / width;
+      int64_t offset = static_cast<int64_t>(f)
+                       - static_cast<int64_t>(center * width);
+      size_t bucket = (center == B ? 0 : center);
+      // Undo the phase shift of tau and the filter attenuation.
+      uint64_t shift = n.Mul(frequency, loop.tau);
+      std::complex<double> value = loop.buckets[bucket]
+          * twiddles_[shift]
+          * (scale / loop.filter->freq(offset));
+      median_real_[ll] = value.real();
+      median_imag_[ll] = value.imag();
+    }
+    estimates_[cc] = std::complex<double>(Median(&median_real_),
+                                          Median(&median_imag_));
+  }
+}
+
+void SFFTNativeInterface::Estimate(SparseSignal* output) {
+  if (power_of_two_) {
+    EstimateCandidates<PowerOfTwoModulus>();
+  } else {
+    EstimateCandidates<GeneralModulus>();
+  }
+
+  // Keep the k largest estimates.
+  SelectTopK(estimates_.data(), estimates_.size(), k_, &selected_);
+  output->Clear();
+  for (size_t ii = 0; ii < selected_.size(); ++ii) {
+    output->Add(candidates_[selected_[ii]], estimates_[selected_[ii]]);
+  }
+  output->Normalize();
+}
+
+bool SFFTNativeInterface::RunTrialSparse(const std::complex<double>* input,
+                                         SparseSignal* output,
+                                         double* running_time) {
+  // The phase timers are only read if phase timing is enabled.
+  PerfCounters::StartRegion();
+  Timer timer;
+  Timer phase_timer;
+  PermuteFilter(input);
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_PERMUTE_FILTER] =
+        phase_timer.GetElapsedSeconds();
+    phase_timer = Timer();
+  }
+  BucketFFT();
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_BUCKET_FFT] =
+        phase_timer.GetElapsedSeconds();
+    phase_timer = Timer();
+  }
+  Locate();
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_LOCATION] = phase_timer.GetElapsedSeconds();
+    phase_timer = Timer();
+  }
+  Estimate(output);
+  if (phase_timing_) {
+    last_phase_times_.times[PHASE_ESTIMATION] =
+        phase_timer.GetElapsedSeconds();
+    last_phase_times_.valid = true;
+  }
+  *running_time = timer.GetElapsedSeconds();
+  PerfCounters::StopRegion();
+  return true;
+}
+
+SFFTNativeInterface::~SFFTNativeInterface() {
+  if (plan_comb_ != nullptr) {
+    fftw_destroy_plan(plan_comb_);
+  }
+  if (plan_est_ != nullptr) {
+    fftw_destroy_plan(plan_est_);
+  }
+  if (plan_loc_ != nullptr) {
+    fftw_destroy_plan(plan_loc_);
+  }
+  if (comb_ != nullptr) {
+    fftw_free(comb_);
+  }
+  if (buckets_ != nullptr) {
+    fftw_free(buckets_);
+  }
+}
@@ -0,0 +1,176 @@
+#ifndef __SFFT_NATIVE_INTERFACE_H__
+#define __SFFT_NATIVE_INTERFACE_H__
+
+#include <complex>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <fftw3.h>
+
+#include "fft_interface.h"
+#include "flat_filter.h"
+#include "sfft_native_kernels.h"
+#include "tuning_database.h"
+
+// In-tree implementation of the sparse FFT algorithms SFFT 1.0 and 2.0
+// (Hassanieh, Indyk, Katabi, Price 2012) for any n < 2^32. The numbers of
+// buckets are divisors of n, so n should be smooth (e.g., 3 * 2^20) for them
+// to be close to their targets.
+//
+// Each loop permutes the spectrum with a random (sigma, tau), multiplies the
+// permuted input with a flat window filter, and folds the result into B
+// buckets, whose B-point FFT hashes every frequency into one bucket. The first
+// loops_loc loops locate the large frequencies: each selects the B_thresh
+// largest buckets and votes for all frequencies hashing into them. The
+// frequencies with at least loops_thresh votes are estimated as the median
+// over all loops. SFFT 2.0 additionally only votes for the frequencies whose
+// residue modulo W_comb is among the B_thresh largest entries of an aliased
+// W_comb-point FFT (the comb filter).
+//
+// The permutation and filter step gathers the permuted input in tiles of
+// consecutive filter positions (with software prefetching, since the
+// accesses are strided by sigma), so that the multiply-add into the buckets
+// runs on contiguous memory. The bucket FFTs of all loops run as one batched
+// FFTW plan.
+class SFFTNativeInterface : public FFTInterface {
+ public:
+  enum class Version {
+    SFFT_1,
+    SFFT_2,
+  };
+
+  // The names follow the SFFT-MIT implementation.
+  struct Parameters {
+    // Number of buckets of the location and estimation loops (divisors of n).
+    size_t B_loc;
+    size_t B_est;
+    // Number of buckets (comb residues) selected per location loop.
+    size_t B_thresh;
+    size_t loops_loc;
+    size_t loops_est;
+    // Minimum number of votes of a candidate frequency.
+    size_t loops_thresh;
+    // Size of the comb filter FFT (divisor of n, SFFT 2.0 only).
+    size_t W_comb;
+    size_t comb_loops;
+    // Leakage of the location and estimation filters.
+    double tolerance_loc;
+    double tolerance_est;
+    // Width of the filter transition band relative to the width of a bucket.
+    double transition;
+  };
+
+  // The tunable parameters and their defaults, in the style of SFFT-MIT:
+  // B_loc = Bcst_loc * sqrt(nk / log2 n) and B_est = Bcst_est *
+  // sqrt(nk / log2 n) rounded down to divisors of n, W_comb = Comb_cst *
+  // n / B_loc (also rounded down to a divisor), and B_thresh = 2k.
+  static std::vector<TunableParameter> TunableParameters(size_t n, size_t k,
+                                                         Version version);
+
+  // Computes the parameters from the tuned values (the defaults for values
+  // that are not set).
+  static bool GetParameters(size_t n, size_t k, Version version,
+                            const TuningParameters& tuning,
+                            Parameters* parameters);
+
+  // planning_flags is the FFTW planner rigor of the bucket FFTs.
+  SFFTNativeInterface(size_t n, size_t k, Version version,
+                      unsigned int planning_flags,
+                      const TuningParameters& tuning = TuningParameters());
+
+  bool Setup();
+
+  bool HasSparseOutput() const {
+    return true;
+  }
+
+  // The output contains the (at most) k located frequencies with the
+  // largest estimates.
+  bool RunTrialSparse(const std::complex<double>* input,
+                      SparseSignal* output,
+                      double* running_time);
+
+  bool SetPhaseTiming(bool enabled) {
+    phase_timing_ = enabled;
+    last_phase_times_.valid = false;
+    return true;
+  }
+
+  bool GetLastPhaseTimes(PhaseTimes* times) const {
+    *times = last_phase_times_;
+    return last_phase_times_.valid;
+  }
+
+  ~SFFTNativeInterface();
+
+ private:
+  // A hashing loop: the permutation x_t -> x_{sigma t + tau} (mod n, with
+  // sigma invertible) and the buckets of the permuted, filtered input.
+  struct Loop {
+    uint64_t sigma;
+    uint64_t sigma_inverse;
+    uint64_t tau;
+    const FlatFilter* filter;
+    // Number of positions per gathered tile (a divisor of the filter's B).
+    size_t tile_size;
+    std::complex<double>* buckets;
+  };
+
+  size_t n_;
+  size_t k_;
+  Version version_;
+  unsigned int planning_flags_;
+  TuningParameters tuning_;
+  Parameters parameters_;
+  bool use_comb_;
+  // Selects the modular arithmetic of the hot loops (masking for powers of
+  // two).
+  bool power_of_two_;
+
+  FlatFilter filter_loc_;
+  FlatFilter filter_est_;
+  std::vector<Loop> loops_;
+  // The buckets of all loops (location loops first).
+  fftw_complex* buckets_;
+  fftw_complex* comb_;
+  fftw_plan plan_loc_;
+  fftw_plan plan_est_;
+  fftw_plan plan_comb_;
+  std::mt19937_64 rng_;
+  TwiddleTable twiddles_;
+
+  // Gather buffer of the permutation and filter step.
+  std::vector<std::complex<double>> tile_;
+  // Vote counts in the low 8 bits; the high bits hold the epoch (trial) of
+  // the count, so that the table does not have to be cleared per trial.
+  std::vector<uint32_t> scores_;
+  uint32_t epoch_;
+  // Comb residues selected in the current trial.
+  std::vector<uint8_t> comb_allowed_;
+  std::vector<size_t> selected_;
+  std::vector<size_t> candidates_;
+  std::vector<std::complex<double>> estimates_;
+  std::vector<double> median_real_;
+  std::vector<double> median_imag_;
+
+  bool phase_timing_;
+  PhaseTimes last_phase_times_;
+
+  void PermuteFilter(const std::complex<double>* input);
+  void BucketFFT();
+  void Locate();
+  void Estimate(SparseSignal* output);
+  // Computes estimates_ for candidates_ (Modulus: arithmetic modulo n).
+  template <typename Modulus>
+  void EstimateCandidates();
+  // Adds a vote to every frequency hashing into the given bucket of a
+  // location loop.
+  template <typename Modulus>
+  void Vote(const Loop& loop, size_t bucket);
+
+  SFFTNativeInterface(const SFFTNativeInterface&) = delete;
+  SFFTNativeInterface& operator=(const SFFTNativeInterface&) = delete;
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "sfft_native_kernels.h"
+
+#include <cmath>
+
+size_t FloorToDivisor(size_t n, double x) {
+  size_t result = static_cast<size_t>(std::max(1.0, std::min(x, 1.0 * n)));
+  while (n % result != 0) {
+    --result;
+  }
+  return result;
+}
+
+uint64_t Gcd(uint64_t a, uint64_t b) {
+  while (b != 0) {
+    uint64_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+uint64_t InverseMod(uint64_t a, uint64_t n) {
+  int64_t r0 = n, r1 = a;
+  int64_t s0 = 0, s1 = 1;
+  while (r1 != 0) {
+    int64_t q = r0 / r1;
+    int64_t r = r0 - q * r1;
+    r0 = r1;
+    r1 = r;
+    int64_t s = s0 - q * s1;
+    s0 = s1;
+    s1 = s;
+  }
+  return s0 < 0 ? s0 + n : s0;
+}
+
+void TwiddleTable::Create(size_t n) {
+  bits_ = 0;
+  while ((size_t(1) << (2 * bits_)) < n) {
+    ++bits_;
+  }
+  size_t num_low = size_t(1) << bits_;
+  size_t num_high = (n + num_low - 1) / num_low;
+  mask_ = num_low - 1;
+  low_.resize(num_low);
+  for (size_t ii = 0; ii < num_low; ++ii) {
+    low_[ii] = std::polar(1.0, -2.0 * M_PI * ii / n);
+  }
+  high_.resize(num_high);
+  for (size_t ii = 0; ii < num_high; ++ii) {
+    high_[ii] = std::polar(1.0, -2.0 * M_PI * (ii * num_low) / n);
+  }
+}
@@ -0,0 +1,145 @@
+#ifndef __SFFT_NATIVE_KERNELS_H__
+#define __SFFT_NATIVE_KERNELS_H__
+
+#include <algorithm>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flat_filter.h"
+
+// Building blocks shared by the native 1D and 2D sparse FFTs: modular index
+// arithmetic, the permute-and-filter kernel, and phase factor tables.
+
+// Number of filter positions per gathered tile (4 KB of complex doubles, so
+// the tile and the buckets it is added to stay in the L1 cache).
+const size_t kSFFTTileSize = 256;
+// Number of elements by which the software prefetch runs ahead of the
+// gather.
+const size_t kSFFTPrefetchDistance = 32;
+// Bound on the signal size, so that products of two residues modulo n fit
+// into 64 bits.
+const uint64_t kSFFTMaxSize = uint64_t(1) << 32;
+
+// Largest divisor of n that is at most x (at least 1). For n a power of two,
+// this is the largest power of two <= x.
+size_t FloorToDivisor(size_t n, double x);
+
+uint64_t Gcd(uint64_t a, uint64_t b);
+
+// Inverse of a modulo n for gcd(a, n) = 1 (extended Euclidean algorithm).
+uint64_t InverseMod(uint64_t a, uint64_t n);
+
+// Arithmetic modulo n < kSFFTMaxSize on residues (a, b < n). The hot loops
+// are templates on the modulus, so that powers of two keep the cheaper
+// masking.
+class GeneralModulus {
+ public:
+  explicit GeneralModulus(uint64_t n) : n_(n) {}
+
+  uint64_t n() const {
+    return n_;
+  }
+
+  // Branch-free: in the strided loops, whether the sum wraps around is
+  // unpredictable.
+  uint64_t Add(uint64_t a, uint64_t b) const {
+    uint64_t sum = a + b;
+    return sum - (n_ & (0 - static_cast<uint64_t>(sum >= n_)));
+  }
+
+  uint64_t Mul(uint64_t a, uint64_t b) const {
+    return a * b % n_;
+  }
+
+ private:
+  uint64_t n_;
+};
+
+class PowerOfTwoModulus {
+ public:
+  explicit PowerOfTwoModulus(uint64_t n) : n_(n), mask_(n - 1) {}
+
+  uint64_t n() const {
+    return n_;
+  }
+
+  uint64_t Add(uint64_t a, uint64_t b) const {
+    return (a + b) & mask_;
+  }
+
+  uint64_t Mul(uint64_t a, uint64_t b) const {
+    return (a * b) & mask_;
+  }
+
+ private:
+  uint64_t n_;
+  uint64_t mask_;
+};
+
+// Folds the filtered, permuted input g_t x_{sigma t + tau} for the support of
+// the filter into the B buckets (t mod B). The input is gathered into tiles
+// of consecutive t, so the multiply-add is a contiguous loop. tile_size
+// divides B, so a tile never wraps around the buckets.
+template <typename Modulus>
+void PermuteFilterKernel(const std::complex<double>* x, const Modulus& n,
+                         const FlatFilter& filter, size_t tile_size,
+                         uint64_t sigma, uint64_t tau,
+                         std::complex<double>* tile,
+                         std::complex<double>* buckets) {
+  size_t B = filter.B();
+  uint64_t start_offset = n.Mul(sigma,
+                                static_cast<uint64_t>(-filter.first()));
+  uint64_t index = n.Add(tau, n.n() - start_offset);
+  uint64_t prefetch = n.Add(index,
+                            n.Mul(kSFFTPrefetchDistance % n.n(), sigma));
+  std::fill(buckets, buckets + B, std::complex<double>(0.0, 0.0));
+
+  const double* y = reinterpret_cast<const double*>(tile);
+  for (size_t start = 0; start < filter.size(); start += tile_size) {
+    for (size_t ii = 0; ii < tile_size; ++ii) {
+      __builtin_prefetch(x + prefetch);
+      tile[ii] = x[index];
+      index = n.Add(index, sigma);
+      prefetch = n.Add(prefetch, sigma);
+    }
+    // The filter starts at a multiple of B, so position start falls into
+    // bucket start mod B.
+    const double* g = filter.time() + start;
+    double* z = reinterpret_cast<double*>(buckets + start % B);
+    #pragma omp simd
+    for (size_t ii = 0; ii < tile_size; ++ii) {
+      z[2 * ii] += g[ii] * y[2 * ii];
+      z[2 * ii + 1] += g[ii] * y[2 * ii + 1];
+    }
+  }
+}
+
+// Median of the values (reorders them).
+inline double Median(std::vector<double>* values) {
+  size_t middle = values->size() / 2;
+  std::nth_element(values->begin(), values->begin() + middle, values->end());
+  return (*values)[middle];
+}
+
+// The phase factors e^{-2 pi i m / n} for 0 <= m < n as the product of two
+// tables of about sqrt(n) entries each.
+class TwiddleTable {
+ public:
+  TwiddleTable() : bits_(0), mask_(0) {}
+
+  void Create(size_t n);
+
+  std::complex<double> operator[](uint64_t m) const {
+    return low_[m & mask_] * high_[m >> bits_];
+  }
+
+ private:
+  int bits_;
+  uint64_t mask_;
+  std::vector<std::complex<double>> low_;
+  std::vector<std::complex<double>> high_;
+};
+
+#endif
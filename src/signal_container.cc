@@ -0,0 +1,357 @@
+#include "signal_container.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include "compression.h"
+
+using std::complex;
+using std::string;
+using std::vector;
+
+typedef complex<double> dcomplex;
+
+// The header and chunks are written in the byte order of the machine.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "The signal container format is little-endian.");
+
+namespace {
+
+const char kMagic[] = "SFFTSIG1";
+const size_t kMagicSize = sizeof(kMagic) - 1;
+const size_t kChunkHeaderSize = 2 * sizeof(uint32_t);
+const uint32_t kChunkStored = 1;
+
+template <typename T>
+void Append(T value, string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void AppendStatistics(const SignalStatistics& stats, string* buffer) {
+  Append<uint64_t>(stats.l0, buffer);
+  Append<double>(stats.l1, buffer);
+  Append<double>(stats.l2, buffer);
+  Append<double>(stats.linf, buffer);
+}
+
+template <typename T>
+T Read(const uint8_t** pos) {
+  T value;
+  memcpy(&value, *pos, sizeof(value));
+  *pos += sizeof(value);
+  return value;
+}
+
+void ReadStatistics(const uint8_t** pos, SignalStatistics* stats) {
+  stats->l0 = Read<uint64_t>(pos);
+  stats->l1 = Read<double>(pos);
+  stats->l2 = Read<double>(pos);
+  stats->linf = Read<double>(pos);
+}
+
+size_t ElementSize(SignalCodec codec) {
+  return codec == CODEC_FLOAT32 ? sizeof(float) : sizeof(double);
+}
+
+// Encodes count elements into out (chunk header and payload).
+void EncodeChunk(const dcomplex* data, size_t count, SignalCodec codec,
+                 vector<uint8_t>* out) {
+  size_t num_values = 2 * count;
+  size_t raw_size = num_values * ElementSize(codec);
+  vector<float> floats;
+  const uint8_t* raw = reinterpret_cast<const uint8_t*>(data);
+  if (codec == CODEC_FLOAT32) {
+    const double* values = reinterpret_cast<const double*>(data);
+    floats.resize(num_values);
+    for (size_t ii = 0; ii < num_values; ++ii) {
+      floats[ii] = static_cast<float>(values[ii]);
+    }
+    raw = reinterpret_cast<const uint8_t*>(floats.data());
+  }
+
+  uint32_t flags = kChunkStored;
+  size_t payload_size = raw_size;
+  out->resize(kChunkHeaderSize + LZCompressBound(raw_size));
+  uint8_t* payload = out->data() + kChunkHeaderSize;
+  if (codec != CODEC_RAW) {
+    vector<uint8_t> shuffled(raw_size);
+    ByteShuffle(raw, num_values, ElementSize(codec), shuffled.data());
+    size_t compressed_size = LZCompress(shuffled.data(), raw_size, payload);
+    if (compressed_size < raw_size) {
+      flags = 0;
+      payload_size = compressed_size;
+    }
+  }
+  if (flags & kChunkStored) {
+    memcpy(payload, raw, raw_size);
+  }
+
+  uint32_t size32 = payload_size;
+  memcpy(out->data(), &flags, sizeof(flags));
+  memcpy(out->data() + sizeof(flags), &size32, sizeof(size32));
+  out->resize(kChunkHeaderSize + payload_size);
+}
+
+bool DecodeChunk(const uint8_t* payload, size_t payload_size, uint32_t flags,
+                 SignalCodec codec, size_t count, dcomplex* out) {
+  size_t num_values = 2 * count;
+  size_t raw_size = num_values * ElementSize(codec);
+  vector<uint8_t> raw_buffer;
+  const uint8_t* raw = payload;
+  if (flags & kChunkStored) {
+    if (payload_size != raw_size) {
+      return false;
+    }
+  } else {
+    vector<uint8_t> shuffled(raw_size);
+    if (!LZDecompress(payload, payload_size, shuffled.data(), raw_size)) {
+      return false;
+    }
+    if (codec == CODEC_FLOAT32) {
+      raw_buffer.resize(raw_size);
+      ByteUnshuffle(shuffled.data(), num_values, sizeof(float),
+                    raw_buffer.data());
+      raw = raw_buffer.data();
+    } else {
+      ByteUnshuffle(shuffled.data(), num_values, sizeof(double),
+                    reinterpret_cast<uint8_t*>(out));
+      return true;
+    }
+  }
+
+  if (codec == CODEC_FLOAT32) {
+    double* values = reinterpret_cast<double*>(out);
+    for (size_t ii = 0; ii < num_values; ++ii) {
+      float value;
+      memcpy(&value, raw + ii * sizeof(float), sizeof(value));
+      values[ii] = value;
+    }
+  } else {
+    memcpy(out, raw, raw_size);
+  }
+  return true;
+}
+
+}  // namespace
+
+bool ParseSignalCodec(const string& str, SignalCodec* codec) {
+  if (str == "raw") {
+    *codec = CODEC_RAW;
+  } else if (str == "lossless") {
+    *codec = CODEC_LOSSLESS;
+  } else if (str == "float32") {
+    *codec = CODEC_FLOAT32;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool IsSignalContainer(const void* data, size_t length) {
+  return length >= kMagicSize && memcmp(data, kMagic, kMagicSize) == 0;
+}
+
+bool ParseSignalContainerHeader(const void* data, size_t length,
+                                SignalContainerHeader* header) {
+  if (!IsSignalContainer(data, length)
+      || length < kSignalContainerHeaderSize) {
+    fprintf(stderr, "Not a signal container.\n");
+    return false;
+  }
+  const uint8_t* pos = static_cast<const uint8_t*>(data) + kMagicSize;
+  uint32_t header_size = Read<uint32_t>(&pos);
+  uint32_t codec = Read<uint32_t>(&pos);
+  if (header_size < kSignalContainerHeaderSize || header_size > length) {
+    fprintf(stderr, "Invalid signal container header size %u.\n",
+        header_size);
+    return false;
+  }
+  if (codec > CODEC_FLOAT32) {
+    fprintf(stderr, "Unknown signal container codec %u.\n", codec);
+    return false;
+  }
+  header->codec = static_cast<SignalCodec>(codec);
+  header->n = Read<uint64_t>(&pos);
+  header->k = Read<uint64_t>(&pos);
+  header->seed = Read<uint64_t>(&pos);
+  header->chunk_size = Read<uint64_t>(&pos);
+  if (header->chunk_size == 0) {
+    fprintf(stderr, "Invalid signal container chunk size.\n");
+    return false;
+  }
+  ReadStatistics(&pos, &(header->pure_spectrum_stats));
+  ReadStatistics(&pos, &(header->spectrum_noise_stats));
+  ReadStatistics(&pos, &(header->final_signal_stats));
+  return true;
+}
+
+bool DecodeSignalContainer(const void* data, size_t length,
+                           const SignalContainerHeader& header,
+                           dcomplex* out) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint32_t header_size;
+  memcpy(&header_size, bytes + kMagicSize, sizeof(header_size));
+
+  // Locate the chunks.
+  size_t num_chunks = (header.n + header.chunk_size - 1) / header.chunk_size;
+  vector<size_t> offsets(num_chunks);
+  size_t offset = header_size;
+  for (size_t ii = 0; ii < num_chunks; ++ii) {
+    if (length - offset < kChunkHeaderSize) {
+      fprintf(stderr, "Signal container is truncated.\n");
+      return false;
+    }
+    uint32_t payload_size;
+    memcpy(&payload_size, bytes + offset + sizeof(uint32_t),
+           sizeof(payload_size));
+    offsets[ii] = offset;
+    offset += kChunkHeaderSize;
+    if (length - offset < payload_size) {
+      fprintf(stderr, "Signal container is truncated.\n");
+      return false;
+    }
+    offset += payload_size;
+  }
+  if (offset != length) {
+    fprintf(stderr, "Signal container has trailing data.\n");
+    return false;
+  }
+
+  std::atomic<bool> failed(false);
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t ii = 0; ii < static_cast<int64_t>(num_chunks); ++ii) {
+    const uint8_t* chunk = bytes + offsets[ii];
+    uint32_t flags;
+    uint32_t payload_size;
+    memcpy(&flags, chunk, sizeof(flags));
+    memcpy(&payload_size, chunk + sizeof(flags), sizeof(payload_size));
+    size_t start = ii * header.chunk_size;
+    size_t count = std::min<size_t>(header.chunk_size, header.n - start);
+    if (!DecodeChunk(chunk + kChunkHeaderSize, payload_size, flags,
+                     header.codec, count, out + start)) {
+      failed = true;
+    }
+  }
+  if (failed) {
+    fprintf(stderr, "Signal container is corrupted.\n");
+    return false;
+  }
+  return true;
+}
+
+bool SignalContainerWriter::Open(const string& filename,
+                                 const SignalContainerHeader& header) {
+  filename_ = filename;
+  header_ = header;
+  num_written_ = 0;
+  pending_.clear();
+  file_ = fopen(filename.c_str(), "wb");
+  if (file_ == nullptr) {
+    fprintf(stderr, "Error opening file \"%s\".\n", filename.c_str());
+    return false;
+  }
+  // The header is written again with the statistics in Close.
+  return WriteHeader();
+}
+
+bool SignalContainerWriter::WriteHeader() {
+  string buffer(kMagic, kMagicSize);
+  Append<uint32_t>(kSignalContainerHeaderSize, &buffer);
+  Append<uint32_t>(header_.codec, &buffer);
+  Append<uint64_t>(header_.n, &buffer);
+  Append<uint64_t>(header_.k, &buffer);
+  Append<uint64_t>(header_.seed, &buffer);
+  Append<uint64_t>(header_.chunk_size, &buffer);
+  AppendStatistics(header_.pure_spectrum_stats, &buffer);
+  AppendStatistics(header_.spectrum_noise_stats, &buffer);
+  AppendStatistics(header_.final_signal_stats, &buffer);
+  if (fwrite(buffer.data(), 1, buffer.size(), file_) != buffer.size()) {
+    fprintf(stderr, "Error writing file \"%s\".\n", filename_.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool SignalContainerWriter::WriteChunks(const dcomplex* data, size_t count) {
+  size_t chunk_size = header_.chunk_size;
+  size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+  vector<vector<uint8_t>> encoded(num_chunks);
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t ii = 0; ii < static_cast<int64_t>(num_chunks); ++ii) {
+    size_t start = ii * chunk_size;
+    EncodeChunk(data + start, std::min(chunk_size, count - start),
+                header_.codec, &(encoded[ii]));
+  }
+  for (size_t ii = 0; ii < num_chunks; ++ii) {
+    if (fwrite(encoded[ii].data(), 1, encoded[ii].size(), file_)
+        != encoded[ii].size()) {
+      fprintf(stderr, "Error writing file \"%s\".\n", filename_.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SignalContainerWriter::Write(const dcomplex* data, size_t count) {
+  if (num_written_ + count > header_.n) {
+    fprintf(stderr, "Signal container has only %lu elements.\n",
+        header_.n);
+    return false;
+  }
+  num_written_ += count;
+  size_t chunk_size = header_.chunk_size;
+  if (!pending_.empty()) {
+    size_t num_taken = std::min(count, chunk_size - pending_.size());
+    pending_.insert(pending_.end(), data, data + num_taken);
+    data += num_taken;
+    count -= num_taken;
+    if (pending_.size() < chunk_size) {
+      return true;
+    }
+    if (!WriteChunks(pending_.data(), pending_.size())) {
+      return false;
+    }
+    pending_.clear();
+  }
+  size_t num_full = count - count % chunk_size;
+  if (num_full > 0 && !WriteChunks(data, num_full)) {
+    return false;
+  }
+  pending_.insert(pending_.end(), data + num_full, data + count);
+  return true;
+}
+
+bool SignalContainerWriter::Close(const SignalStatistics& pure_spectrum_stats,
+                                  const SignalStatistics& spectrum_noise_stats,
+                                  const SignalStatistics& final_signal_stats) {
+  if (num_written_ != header_.n) {
+    fprintf(stderr, "Only %lu of %lu elements written to \"%s\".\n",
+        num_written_, header_.n, filename_.c_str());
+    return false;
+  }
+  if (!pending_.empty() && !WriteChunks(pending_.data(), pending_.size())) {
+    return false;
+  }
+  pending_.clear();
+  header_.pure_spectrum_stats = pure_spectrum_stats;
+  header_.spectrum_noise_stats = spectrum_noise_stats;
+  header_.final_signal_stats = final_signal_stats;
+  if (fseek(file_, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "Could not seek in \"%s\".\n", filename_.c_str());
+    return false;
+  }
+  bool success = WriteHeader();
+  if (fclose(file_) != 0) {
+    fprintf(stderr, "Error closing file \"%s\".\n", filename_.c_str());
+    success = false;
+  }
+  file_ = nullptr;
+  return success;
+}
+
+SignalContainerWriter::~SignalContainerWriter() {
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+}
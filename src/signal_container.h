@@ -0,0 +1,106 @@
+#ifndef __SIGNAL_CONTAINER_H__
+#define __SIGNAL_CONTAINER_H__
+
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "result_helpers.h"
+
+// Chunked container for complex double signals, so that corpora of inputs
+// are cheap enough to keep. All numbers are little-endian.
+//
+// The file starts with a header of kSignalContainerHeaderSize bytes: the magic
+// bytes "SFFTSIG1", a uint32 header size, a uint32 codec, n, k, the generator
+// seed, the chunk size in elements (uint64), and the pure spectrum, spectrum
+// noise, and final signal statistics (uint64 l0 and double l1, l2, linf). It
+// is followed by ceil(n / chunk_size) chunks, each consisting of a uint32
+// flags field (bit 0: stored without compression), a uint32 payload size, and
+// the payload. The chunks are independent, so they are compressed and
+// decompressed in parallel.
+//
+// Codecs:
+//  - RAW: the complex doubles.
+//  - LOSSLESS: the doubles are byte-shuffled (see compression.h) and
+//    LZ-compressed.
+//  - FLOAT32: the values are rounded to floats (relative error 2^-24), then
+//    byte-shuffled and LZ-compressed. Lossy, but half the size.
+// A chunk is stored uncompressed (as doubles or floats) if compression does
+// not make it smaller.
+enum SignalCodec {
+  CODEC_RAW = 0,
+  CODEC_LOSSLESS = 1,
+  CODEC_FLOAT32 = 2,
+};
+
+const size_t kSignalContainerHeaderSize = 144;
+
+// Parses "raw", "lossless", or "float32".
+bool ParseSignalCodec(const std::string& str, SignalCodec* codec);
+
+struct SignalContainerHeader {
+  SignalContainerHeader() : codec(CODEC_RAW), n(0), k(0), seed(0),
+      chunk_size(1 << 16) {}
+
+  SignalCodec codec;
+  uint64_t n;
+  uint64_t k;
+  uint64_t seed;
+  uint64_t chunk_size;
+  SignalStatistics pure_spectrum_stats;
+  SignalStatistics spectrum_noise_stats;
+  SignalStatistics final_signal_stats;
+};
+
+// Returns true if the data starts with the magic bytes of a container.
+bool IsSignalContainer(const void* data, size_t length);
+
+bool ParseSignalContainerHeader(const void* data, size_t length,
+                                SignalContainerHeader* header);
+
+// Decompresses the header.n elements of the container (the whole file in data)
+// into out. The chunks are decoded in parallel with OpenMP.
+bool DecodeSignalContainer(const void* data, size_t length,
+                           const SignalContainerHeader& header,
+                           std::complex<double>* out);
+
+// Writes a container. The elements are appended with Write, and the chunks
+// that are complete are compressed in parallel. The statistics in the header
+// are written by Close, so the file has to be seekable.
+class SignalContainerWriter {
+ public:
+  SignalContainerWriter() : file_(nullptr), num_written_(0) {}
+
+  bool Open(const std::string& filename, const SignalContainerHeader& header);
+
+  bool Write(const std::complex<double>* data, size_t count);
+
+  // Writes the last chunk and the header with the given statistics. All n
+  // elements must have been written.
+  bool Close(const SignalStatistics& pure_spectrum_stats,
+             const SignalStatistics& spectrum_noise_stats,
+             const SignalStatistics& final_signal_stats);
+
+  ~SignalContainerWriter();
+
+ private:
+  std::string filename_;
+  SignalContainerHeader header_;
+  FILE* file_;
+  // Number of elements passed to Write so far.
+  size_t num_written_;
+  // Elements of the current incomplete chunk.
+  std::vector<std::complex<double>> pending_;
+
+  bool WriteHeader();
+  // Encodes and writes the chunks of data (ceil(count / chunk_size) chunks,
+  // only the last one can be shorter).
+  bool WriteChunks(const std::complex<double>* data, size_t count);
+
+  SignalContainerWriter(const SignalContainerWriter&) = delete;
+  SignalContainerWriter& operator=(const SignalContainerWriter&) = delete;
+};
+
+#endif
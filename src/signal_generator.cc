@@ -0,0 +1,396 @@
+#include "signal_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+
+#include "fftw_threads.h"
+
+using std::complex;
+using std::vector;
+
+typedef complex<double> dcomplex;
+
+namespace {
+
+// Random number streams of the generator.
+const uint64_t kPositionStream = 0;
+const uint64_t kPhaseStream = 1;
+const uint64_t kNoiseStream = 2;
+const uint64_t kInstanceStream = 3;
+
+// Number of elements that are normalized, summarized, and written at a time.
+const size_t kChunkSize = 1 << 20;
+
+// Direct synthesis: number of samples after which the phasors of the tones
+// are recomputed from scratch instead of by the recurrence. The rounding
+// error of the recurrence grows linearly with the number of steps, so it stays
+// in the order of kAnchorInterval * 2^-53.
+const size_t kAnchorInterval = 1024;
+
+void AddStatisticsSums(const StatisticsSums& other, StatisticsSums* sums) {
+  sums->l0 += other.l0;
+  sums->l1 += other.l1;
+  sums->l2_squared += other.l2_squared;
+  sums->linf = std::max(sums->linf, other.linf);
+}
+
+void SumsToStatistics(const StatisticsSums& sums, SignalStatistics* stats) {
+  stats->l0 = sums.l0;
+  stats->l1 = sums.l1;
+  stats->l2 = sqrt(sums.l2_squared);
+  stats->linf = sums.linf;
+}
+
+}  // namespace
+
+void CounterRNG::Normal2(uint64_t index, double* x, double* y) const {
+  // 1 - Uniform is in (0, 1], so the logarithm is finite.
+  double radius = sqrt(-2.0 * log(1.0 - Uniform(2 * index)));
+  double angle = 2.0 * M_PI * Uniform(2 * index + 1);
+  *x = radius * cos(angle);
+  *y = radius * sin(angle);
+}
+
+uint64_t InstanceSeed(uint64_t base_seed, size_t instance) {
+  return CounterRNG(base_seed, kInstanceStream).Bits(instance);
+}
+
+void SampleDistinctPositions(size_t n, size_t k, const CounterRNG& rng,
+                             vector<size_t>* positions) {
+  positions->clear();
+  positions->reserve(k);
+  std::unordered_set<size_t> selected(2 * k);
+  uint64_t counter = 0;
+  for (size_t jj = n - k; jj < n; ++jj) {
+    size_t pos = rng.UniformInt(counter++, jj + 1);
+    if (!selected.insert(pos).second) {
+      // pos was already chosen, but jj cannot have been chosen so far.
+      pos = jj;
+      selected.insert(pos);
+    }
+    positions->push_back(pos);
+  }
+}
+
+bool SignalGenerator::Setup() {
+  size_t n = options_.n;
+  if (options_.direct_synthesis
+      && (!options_.apply_ifft || options_.noise_variance > 0.0)) {
+    fprintf(stderr, "Direct synthesis requires the inverse FFT and no "
+                    "noise.\n");
+    return false;
+  }
+  if (options_.rows == 0 || n % options_.rows != 0
+      || (options_.rows > 1 && options_.direct_synthesis)) {
+    fprintf(stderr, "The number of rows must divide n, and 2D signals do not "
+                    "support direct synthesis.\n");
+    return false;
+  }
+  size_t buffer_size = n;
+  size_t num_buffers = std::max<size_t>(options_.num_buffers, 1);
+  if (options_.direct_synthesis) {
+    buffer_size = std::min(n, kChunkSize);
+    num_buffers = 1;
+  }
+  for (size_t ii = 0; ii < num_buffers; ++ii) {
+    dcomplex* buffer = reinterpret_cast<dcomplex*>(
+        fftw_alloc_complex(buffer_size));
+    if (buffer == nullptr) {
+      fprintf(stderr, "Could not allocate the signal buffer.\n");
+      return false;
+    }
+    buffers_.push_back(buffer);
+  }
+  if (!options_.apply_ifft || options_.direct_synthesis) {
+    return true;
+  }
+
+  // The other buffers have the same alignment (fftw_alloc_complex), so they
+  // can use this plan with fftw_execute_dft.
+  fftw_complex* data = reinterpret_cast<fftw_complex*>(buffers_[0]);
+  if (options_.num_threads > 1) {
+    if (!InitFFTWThreads()) {
+      return false;
+    }
+    fftw_plan_with_nthreads(options_.num_threads);
+  }
+  if (options_.rows > 1) {
+    plan_ = fftw_plan_dft_2d(options_.rows, n / options_.rows, data, data,
+                             FFTW_BACKWARD, options_.planning_flags);
+  } else {
+    plan_ = fftw_plan_dft_1d(n, data, data, FFTW_BACKWARD,
+                             options_.planning_flags);
+  }
+  if (options_.num_threads > 1) {
+    fftw_plan_with_nthreads(1);
+  }
+  if (plan_ == nullptr) {
+    fprintf(stderr, "Could not create the inverse FFT plan.\n");
+    return false;
+  }
+  return true;
+}
+
+void SignalGenerator::GenerateSpectrum(uint64_t seed,
+                                       SparseSignal* spectrum) const {
+  vector<size_t> positions;
+  if (options_.firstk) {
+    for (size_t ii = 0; ii < options_.k; ++ii) {
+      positions.push_back(ii);
+    }
+  } else {
+    SampleDistinctPositions(options_.n, options_.k,
+                            CounterRNG(seed, kPositionStream), &positions);
+  }
+
+  CounterRNG phase_rng(seed, kPhaseStream);
+  spectrum->Clear();
+  for (size_t ii = 0; ii < positions.size(); ++ii) {
+    if (options_.randomize_phase) {
+      double phase = 2.0 * M_PI * phase_rng.Uniform(ii);
+      spectrum->Add(positions[ii], dcomplex(cos(phase), sin(phase)));
+    } else {
+      spectrum->Add(positions[ii], dcomplex(1.0, 0.0));
+    }
+  }
+}
+
+void SignalGenerator::Generate(uint64_t seed, size_t buffer,
+                               GeneratorStatistics* stats) {
+  SparseSignal spectrum;
+  GenerateSpectrum(seed, &spectrum);
+  ComputeSignalStatistics(spectrum, 0.0, &(stats->pure_spectrum));
+
+  if (options_.direct_synthesis) {
+    stats->spectrum_noise.l0 = 0;
+    stats->spectrum_noise.l1 = 0.0;
+    stats->spectrum_noise.l2 = 0.0;
+    stats->spectrum_noise.linf = 0.0;
+
+    // The inverse FFT (FFTW_BACKWARD) of the spectrum is
+    // x[t] = sum_j value_j * exp(2 pi i f_j t / n).
+    double scale = options_.normalize ? 1.0 / sqrt(options_.n) : 1.0;
+    size_t k = spectrum.size();
+    tone_frequencies_.assign(spectrum.indices.begin(), spectrum.indices.end());
+    tone_amplitude_re_.resize(k);
+    tone_amplitude_im_.resize(k);
+    tone_step_re_.resize(k);
+    tone_step_im_.resize(k);
+    for (size_t jj = 0; jj < k; ++jj) {
+      tone_amplitude_re_[jj] = scale * spectrum.values[jj].real();
+      tone_amplitude_im_[jj] = scale * spectrum.values[jj].imag();
+      double angle = 2.0 * M_PI * tone_frequencies_[jj] / options_.n;
+      tone_step_re_[jj] = cos(angle);
+      tone_step_im_[jj] = sin(angle);
+    }
+    return;
+  }
+
+  int64_t n = options_.n;
+  dcomplex* data = buffers_[buffer];
+  if (options_.noise_variance > 0.0) {
+    CounterRNG rng(seed, kNoiseStream);
+    double sigma = sqrt(options_.noise_variance);
+    #pragma omp parallel for schedule(static)
+    for (int64_t ii = 0; ii < n; ++ii) {
+      double re, im;
+      rng.Normal2(ii, &re, &im);
+      data[ii] = dcomplex(sigma * re, sigma * im);
+    }
+    ComputeSignalStatistics(data, n, 0.0, &(stats->spectrum_noise));
+  } else {
+    #pragma omp parallel for schedule(static)
+    for (int64_t ii = 0; ii < n; ++ii) {
+      data[ii] = dcomplex(0.0, 0.0);
+    }
+    stats->spectrum_noise.l0 = 0;
+    stats->spectrum_noise.l1 = 0.0;
+    stats->spectrum_noise.l2 = 0.0;
+    stats->spectrum_noise.linf = 0.0;
+  }
+
+  for (size_t ii = 0; ii < spectrum.size(); ++ii) {
+    data[spectrum.indices[ii]] += spectrum.values[ii];
+  }
+
+  if (options_.apply_ifft) {
+    fftw_complex* fftw_data = reinterpret_cast<fftw_complex*>(data);
+    fftw_execute_dft(plan_, fftw_data, fftw_data);
+  }
+}
+
+void SignalGenerator::SynthesizeChunk(size_t start, size_t count,
+                                      dcomplex* out) {
+  size_t k = tone_frequencies_.size();
+  uint64_t n = options_.n;
+  int64_t num_blocks = (count + kAnchorInterval - 1) / kAnchorInterval;
+  #pragma omp parallel
+  {
+    // Current phasor of each tone (structure of arrays so that the loop over
+    // the tones is vectorized).
+    vector<double> phasor_re(k);
+    vector<double> phasor_im(k);
+    const double* step_re = tone_step_re_.data();
+    const double* step_im = tone_step_im_.data();
+
+    #pragma omp for schedule(static)
+    for (int64_t block = 0; block < num_blocks; ++block) {
+      size_t block_start = block * kAnchorInterval;
+      size_t block_size = std::min(kAnchorInterval, count - block_start);
+      uint64_t t0 = start + block_start;
+      for (size_t jj = 0; jj < k; ++jj) {
+        // Reduce f * t0 modulo n exactly before converting it to an angle.
+        uint64_t residue = (static_cast<unsigned __int128>(
+            tone_frequencies_[jj]) * t0) % n;
+        double angle = 2.0 * M_PI * residue / n;
+        double c = cos(angle);
+        double s = sin(angle);
+        phasor_re[jj] = tone_amplitude_re_[jj] * c - tone_amplitude_im_[jj] * s;
+        phasor_im[jj] = tone_amplitude_re_[jj] * s + tone_amplitude_im_[jj] * c;
+      }
+
+      double* pre = phasor_re.data();
+      double* pim = phasor_im.data();
+      for (size_t tt = 0; tt < block_size; ++tt) {
+        double sum_re = 0.0;
+        double sum_im = 0.0;
+        #pragma omp simd reduction(+:sum_re, sum_im)
+        for (size_t jj = 0; jj < k; ++jj) {
+          double re = pre[jj];
+          double im = pim[jj];
+          sum_re += re;
+          sum_im += im;
+          pre[jj] = re * step_re[jj] - im * step_im[jj];
+          pim[jj] = re * step_im[jj] + im * step_re[jj];
+        }
+        out[block_start + tt] = dcomplex(sum_re, sum_im);
+      }
+    }
+  }
+}
+
+const dcomplex* SignalGenerator::FinishChunk(size_t buffer, size_t start,
+                                             size_t count,
+                                             StatisticsSums* sums) {
+  dcomplex* chunk;
+  if (options_.direct_synthesis) {
+    chunk = buffers_[0];
+    SynthesizeChunk(start, count, chunk);
+  } else {
+    chunk = buffers_[buffer] + start;
+  }
+  if (options_.apply_ifft && options_.normalize
+      && !options_.direct_synthesis) {
+    double normalization_factor = 1.0 / sqrt(options_.n);
+    #pragma omp parallel for schedule(static)
+    for (int64_t ii = 0; ii < static_cast<int64_t>(count); ++ii) {
+      chunk[ii] *= normalization_factor;
+    }
+  }
+  StatisticsSums chunk_sums;
+  ComputeStatisticsSums(chunk, nullptr, count, 0.0, &chunk_sums);
+  AddStatisticsSums(chunk_sums, sums);
+  return chunk;
+}
+
+bool SignalGenerator::GenerateBinary(uint64_t seed, FILE* out,
+                                     GeneratorStatistics* stats) {
+  Generate(seed, 0, stats);
+  return WriteBinary(0, out, stats);
+}
+
+bool SignalGenerator::WriteBinary(size_t buffer, FILE* out,
+                                  GeneratorStatistics* stats) {
+  StatisticsSums sums = {0, 0.0, 0.0, 0.0};
+  for (size_t start = 0; start < options_.n; start += kChunkSize) {
+    size_t count = std::min(kChunkSize, options_.n - start);
+    const dcomplex* chunk = FinishChunk(buffer, start, count, &sums);
+    size_t num_written = fwrite(chunk, sizeof(dcomplex), count, out);
+    if (num_written != count) {
+      fprintf(stderr, "Error writing data: %lu elements written, expected %lu."
+                      "\n", start + num_written, options_.n);
+      return false;
+    }
+  }
+  SumsToStatistics(sums, &(stats->final_signal));
+  return true;
+}
+
+bool SignalGenerator::WriteBinaryFloat(size_t buffer, FILE* out,
+                                       GeneratorStatistics* stats) {
+  StatisticsSums sums = {0, 0.0, 0.0, 0.0};
+  vector<complex<float>> float_chunk;
+  for (size_t start = 0; start < options_.n; start += kChunkSize) {
+    size_t count = std::min(kChunkSize, options_.n - start);
+    const dcomplex* chunk = FinishChunk(buffer, start, count, &sums);
+    float_chunk.resize(count);
+    for (size_t ii = 0; ii < count; ++ii) {
+      float_chunk[ii] = complex<float>(chunk[ii]);
+    }
+    size_t num_written = fwrite(float_chunk.data(), sizeof(complex<float>),
+                                count, out);
+    if (num_written != count) {
+      fprintf(stderr, "Error writing data: %lu elements written, expected %lu."
+                      "\n", start + num_written, options_.n);
+      return false;
+    }
+  }
+  SumsToStatistics(sums, &(stats->final_signal));
+  return true;
+}
+
+void SignalGenerator::CopySignal(size_t buffer, dcomplex* out,
+                                 GeneratorStatistics* stats) {
+  StatisticsSums sums = {0, 0.0, 0.0, 0.0};
+  for (size_t start = 0; start < options_.n; start += kChunkSize) {
+    size_t count = std::min(kChunkSize, options_.n - start);
+    const dcomplex* chunk = FinishChunk(buffer, start, count, &sums);
+    std::copy(chunk, chunk + count, out + start);
+  }
+  SumsToStatistics(sums, &(stats->final_signal));
+}
+
+bool SignalGenerator::WriteContainer(size_t buffer, SignalContainerWriter* out,
+                                     GeneratorStatistics* stats) {
+  StatisticsSums sums = {0, 0.0, 0.0, 0.0};
+  for (size_t start = 0; start < options_.n; start += kChunkSize) {
+    size_t count = std::min(kChunkSize, options_.n - start);
+    const dcomplex* chunk = FinishChunk(buffer, start, count, &sums);
+    if (!out->Write(chunk, count)) {
+      return false;
+    }
+  }
+  SumsToStatistics(sums, &(stats->final_signal));
+  return true;
+}
+
+bool SignalGenerator::GenerateText(uint64_t seed, std::ostream* out,
+                                   GeneratorStatistics* stats) {
+  Generate(seed, 0, stats);
+  StatisticsSums sums = {0, 0.0, 0.0, 0.0};
+  std::ostream& oref = *out;
+  for (size_t start = 0; start < options_.n; start += kChunkSize) {
+    size_t count = std::min(kChunkSize, options_.n - start);
+    const dcomplex* chunk = FinishChunk(0, start, count, &sums);
+    for (size_t ii = 0; ii < count; ++ii) {
+      if (start + ii != 0) {
+        oref << " ";
+      }
+      oref << chunk[ii];
+    }
+  }
+  oref << std::endl;
+  SumsToStatistics(sums, &(stats->final_signal));
+  return oref.good();
+}
+
+SignalGenerator::~SignalGenerator() {
+  if (plan_ != nullptr) {
+    fftw_destroy_plan(plan_);
+  }
+  for (size_t ii = 0; ii < buffers_.size(); ++ii) {
+    fftw_free(buffers_[ii]);
+  }
+}
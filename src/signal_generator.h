@@ -0,0 +1,183 @@
+#ifndef __SIGNAL_GENERATOR_H__
+#define __SIGNAL_GENERATOR_H__
+
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include <fftw3.h>
+
+#include "result_helpers.h"
+#include "signal_container.h"
+#include "sparse_signal.h"
+#include "statistics_kernels.h"
+
+// Counter-based random numbers: the value for a counter is a hash of the
+// seed, the stream, and the counter (SplitMix64). Values can therefore be
+// drawn in any order and by any number of threads, and the result only
+// depends on the seed.
+class CounterRNG {
+ public:
+  CounterRNG(uint64_t seed, uint64_t stream)
+      : key_(Mix(seed + Mix(stream + 1))) {}
+
+  uint64_t Bits(uint64_t counter) const {
+    return Mix(key_ + counter * 0x9e3779b97f4a7c15ULL);
+  }
+
+  // Uniform in [0, 1).
+  double Uniform(uint64_t counter) const {
+    return (Bits(counter) >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  // Uniform in {0, ..., bound - 1} (multiply-shift, bias below 2^-64 * bound).
+  uint64_t UniformInt(uint64_t counter, uint64_t bound) const {
+    return (static_cast<unsigned __int128>(Bits(counter)) * bound) >> 64;
+  }
+
+  // Two independent standard normal values from the counters 2 * index and
+  // 2 * index + 1 (Box-Muller).
+  void Normal2(uint64_t index, double* x, double* y) const;
+
+ private:
+  uint64_t key_;
+
+  static uint64_t Mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+};
+
+// Seed of the given instance in a batch of inputs generated from base_seed.
+uint64_t InstanceSeed(uint64_t base_seed, size_t instance);
+
+// Samples k distinct positions in {0, ..., n - 1} with Floyd's algorithm in
+// O(k) time and memory.
+void SampleDistinctPositions(size_t n, size_t k, const CounterRNG& rng,
+                             std::vector<size_t>* positions);
+
+struct GeneratorOptions {
+  GeneratorOptions() : n(0), k(0), noise_variance(-1.0), firstk(false),
+      randomize_phase(true), apply_ifft(true), normalize(true),
+      direct_synthesis(false), planning_flags(FFTW_ESTIMATE),
+      num_threads(1), num_buffers(1), rows(1) {}
+
+  size_t n;
+  size_t k;
+  // Variance of the real and imaginary part of the noise added to the
+  // spectrum (no noise if not positive).
+  double noise_variance;
+  // Use the positions 0, ..., k - 1 instead of random positions.
+  bool firstk;
+  bool randomize_phase;
+  bool apply_ifft;
+  // Normalize the inverse FFT by 1 / sqrt(n).
+  bool normalize;
+  // Evaluate the k tones of the signal directly instead of applying an
+  // inverse FFT to the spectrum. Requires apply_ifft and no noise.
+  bool direct_synthesis;
+  unsigned int planning_flags;
+  // Number of threads of the inverse FFT.
+  size_t num_threads;
+  // Number of n-element buffers (ignored with direct_synthesis). With two
+  // buffers, a signal can be generated while the previous one is written.
+  size_t num_buffers;
+  // With rows > 1, the signal is a rows x (n / rows) array in row-major order
+  // and its spectrum is the 2D DFT (the k positions are row-major indices).
+  // Requires that rows divides n and no direct synthesis.
+  size_t rows;
+};
+
+struct GeneratorStatistics {
+  SignalStatistics pure_spectrum;
+  SignalStatistics spectrum_noise;
+  SignalStatistics final_signal;
+};
+
+// Generates test signals with k nonzero frequencies (of magnitude 1, with
+// uniformly random phases) plus optional Gaussian noise in the spectrum. The
+// signal is the inverse FFT of this spectrum (or the spectrum itself if
+// apply_ifft is false).
+//
+// The generator uses a single n-element buffer (the inverse FFT runs in place
+// with a plan created in Setup), generates the noise in parallel from
+// counter-based random numbers (so the output does not depend on the number
+// of threads), and streams the output in chunks, normalizing each chunk and
+// computing the signal statistics on the way.
+//
+// With direct_synthesis, there is no n-element buffer: each output chunk is
+// computed as the sum of the k complex exponentials (O(k) per element), so
+// signals larger than the main memory can be generated.
+class SignalGenerator {
+ public:
+  explicit SignalGenerator(const GeneratorOptions& options)
+      : options_(options), plan_(nullptr) {}
+
+  // Allocates the buffers and plans the inverse FFT. All buffers share the
+  // plan.
+  bool Setup();
+
+  // Generates the signal for the given seed and writes it as binary complex
+  // doubles to out.
+  bool GenerateBinary(uint64_t seed, FILE* out, GeneratorStatistics* stats);
+
+  // Same as GenerateBinary, but writes the numbers in text format, separated
+  // by spaces and followed by a newline.
+  bool GenerateText(uint64_t seed, std::ostream* out,
+                    GeneratorStatistics* stats);
+
+  // The two steps of GenerateBinary on a given buffer. Generate fills the
+  // buffer with the signal, except for the final normalization (with
+  // direct_synthesis, it only prepares the tones, and the signal is computed
+  // in WriteBinary). Generate and WriteBinary can run concurrently on
+  // different buffers.
+  void Generate(uint64_t seed, size_t buffer, GeneratorStatistics* stats);
+  bool WriteBinary(size_t buffer, FILE* out, GeneratorStatistics* stats);
+
+  // Same as WriteBinary, but writes complex floats (the statistics are those
+  // of the signal before rounding).
+  bool WriteBinaryFloat(size_t buffer, FILE* out, GeneratorStatistics* stats);
+
+  // Same as WriteBinary, but copies the n elements of the signal to out.
+  void CopySignal(size_t buffer, std::complex<double>* out,
+                  GeneratorStatistics* stats);
+
+  // Same as WriteBinary, but appends the signal to a container (the caller
+  // closes the container with the statistics).
+  bool WriteContainer(size_t buffer, SignalContainerWriter* out,
+                      GeneratorStatistics* stats);
+
+  ~SignalGenerator();
+
+ private:
+  GeneratorOptions options_;
+  // The n-element buffers, or one chunk buffer with direct_synthesis.
+  std::vector<std::complex<double>*> buffers_;
+  fftw_plan plan_;
+  // Direct synthesis: frequency, amplitude (including the normalization),
+  // and per-sample phase rotation of each tone.
+  std::vector<uint64_t> tone_frequencies_;
+  std::vector<double> tone_amplitude_re_;
+  std::vector<double> tone_amplitude_im_;
+  std::vector<double> tone_step_re_;
+  std::vector<double> tone_step_im_;
+
+  // The k nonzero entries of the spectrum (without noise).
+  void GenerateSpectrum(uint64_t seed, SparseSignal* spectrum) const;
+
+  // Returns the output elements start, ..., start + count - 1 of the buffer
+  // (normalized) and adds their statistics to sums.
+  const std::complex<double>* FinishChunk(size_t buffer, size_t start,
+                                          size_t count, StatisticsSums* sums);
+
+  // Evaluates the tones at the positions start, ..., start + count - 1.
+  void SynthesizeChunk(size_t start, size_t count, std::complex<double>* out);
+
+  SignalGenerator(const SignalGenerator&) = delete;
+  SignalGenerator& operator=(const SignalGenerator&) = delete;
+};
+
+#endif
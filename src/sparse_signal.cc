@@ -0,0 +1,60 @@
+#include "sparse_signal.h"
+
+#include <algorithm>
+#include <utility>
+
+void SparseSignal::Normalize() {
+  bool sorted = true;
+  for (size_t ii = 1; ii < indices.size(); ++ii) {
+    if (indices[ii - 1] >= indices[ii]) {
+      sorted = false;
+      break;
+    }
+  }
+  if (sorted) {
+    return;
+  }
+
+  std::vector<size_t> order(indices.size());
+  for (size_t ii = 0; ii < order.size(); ++ii) {
+    order[ii] = ii;
+  }
+  // Sort by index and, for equal indices, put the value added last first.
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return indices[a] < indices[b] || (indices[a] == indices[b] && a > b);
+  });
+
+  std::vector<size_t> new_indices;
+  std::vector<std::complex<double>> new_values;
+  new_indices.reserve(order.size());
+  new_values.reserve(order.size());
+  for (size_t ii = 0; ii < order.size(); ++ii) {
+    size_t index = indices[order[ii]];
+    if (!new_indices.empty() && new_indices.back() == index) {
+      continue;
+    }
+    new_indices.push_back(index);
+    new_values.push_back(values[order[ii]]);
+  }
+  indices.swap(new_indices);
+  values.swap(new_values);
+}
+
+bool SparseSignal::Find(size_t index, std::complex<double>* value) const {
+  std::vector<size_t>::const_iterator it = std::lower_bound(indices.begin(),
+      indices.end(), index);
+  if (it == indices.end() || *it != index) {
+    return false;
+  }
+  *value = values[it - indices.begin()];
+  return true;
+}
+
+void SparseSignal::ToDense(size_t n,
+                           std::vector<std::complex<double>>* dense) const {
+  dense->resize(n);
+  dense->assign(n, std::complex<double>(0.0, 0.0));
+  for (size_t ii = 0; ii < indices.size(); ++ii) {
+    (*dense)[indices[ii]] = values[ii];
+  }
+}
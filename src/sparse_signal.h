@@ -0,0 +1,39 @@
+#ifndef __SPARSE_SIGNAL_H__
+#define __SPARSE_SIGNAL_H__
+
+#include <complex>
+#include <vector>
+
+// A sparse vector given by its (index, value) pairs. After Normalize() the
+// indices are strictly increasing. All other entries are zero.
+struct SparseSignal {
+  std::vector<size_t> indices;
+  std::vector<std::complex<double>> values;
+
+  void Clear() {
+    indices.clear();
+    values.clear();
+  }
+
+  void Add(size_t index, const std::complex<double>& value) {
+    indices.push_back(index);
+    values.push_back(value);
+  }
+
+  size_t size() const {
+    return indices.size();
+  }
+
+  // Sorts the entries by index. If an index occurs more than once, the value
+  // added last is kept (this matches scattering the pairs into a dense
+  // vector in the order in which they were added).
+  void Normalize();
+
+  // Returns true and sets *value if the given index is contained in the
+  // (normalized) signal.
+  bool Find(size_t index, std::complex<double>* value) const;
+
+  void ToDense(size_t n, std::vector<std::complex<double>>* dense) const;
+};
+
+#endif
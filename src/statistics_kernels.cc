@@ -0,0 +1,236 @@
+#include "statistics_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <immintrin.h>
+#include <omp.h>
+
+namespace {
+
+// Inputs smaller than this are processed by a single thread.
+const size_t kParallelThreshold = 1 << 16;
+
+typedef void (*KernelFunction)(const double* a, const double* b, size_t n,
+                               double l0_epsilon, StatisticsSums* sums);
+
+inline void AccumulateScalar(double re, double im, double l0_epsilon,
+                             StatisticsSums* sums) {
+  double squared = re * re + im * im;
+  double absval = std::sqrt(squared);
+  if (absval > l0_epsilon) {
+    ++(sums->l0);
+  }
+  sums->l1 += absval;
+  sums->l2_squared += squared;
+  sums->linf = std::max(sums->linf, absval);
+}
+
+// The kernels process n complex numbers stored as interleaved (re, im) pairs.
+// If kDifference is false, b is ignored.
+template <bool kDifference>
+void ScalarKernel(const double* a, const double* b, size_t n,
+                  double l0_epsilon, StatisticsSums* sums) {
+  for (size_t ii = 0; ii < n; ++ii) {
+    double re = a[2 * ii];
+    double im = a[2 * ii + 1];
+    if (kDifference) {
+      re -= b[2 * ii];
+      im -= b[2 * ii + 1];
+    }
+    AccumulateScalar(re, im, l0_epsilon, sums);
+  }
+}
+
+template <bool kDifference>
+__attribute__((target("avx2")))
+void AVX2Kernel(const double* a, const double* b, size_t n,
+                double l0_epsilon, StatisticsSums* sums) {
+  __m256d l1 = _mm256_setzero_pd();
+  __m256d l2 = _mm256_setzero_pd();
+  __m256d linf = _mm256_setzero_pd();
+  __m256d eps = _mm256_set1_pd(l0_epsilon);
+  size_t l0 = 0;
+
+  // Four complex numbers per iteration.
+  size_t num_blocks = n / 4;
+  for (size_t ii = 0; ii < num_blocks; ++ii) {
+    __m256d v0 = _mm256_loadu_pd(a + 8 * ii);
+    __m256d v1 = _mm256_loadu_pd(a + 8 * ii + 4);
+    if (kDifference) {
+      v0 = _mm256_sub_pd(v0, _mm256_loadu_pd(b + 8 * ii));
+      v1 = _mm256_sub_pd(v1, _mm256_loadu_pd(b + 8 * ii + 4));
+    }
+    // hadd yields the squared magnitudes of the four numbers (in the order
+    // 0, 2, 1, 3, which does not matter here).
+    __m256d squared = _mm256_hadd_pd(_mm256_mul_pd(v0, v0),
+                                     _mm256_mul_pd(v1, v1));
+    __m256d absval = _mm256_sqrt_pd(squared);
+    l0 += __builtin_popcount(_mm256_movemask_pd(
+        _mm256_cmp_pd(absval, eps, _CMP_GT_OQ)));
+    l1 = _mm256_add_pd(l1, absval);
+    l2 = _mm256_add_pd(l2, squared);
+    linf = _mm256_max_pd(linf, absval);
+  }
+
+  double l1_lanes[4];
+  double l2_lanes[4];
+  double linf_lanes[4];
+  _mm256_storeu_pd(l1_lanes, l1);
+  _mm256_storeu_pd(l2_lanes, l2);
+  _mm256_storeu_pd(linf_lanes, linf);
+  sums->l0 += l0;
+  for (int lane = 0; lane < 4; ++lane) {
+    sums->l1 += l1_lanes[lane];
+    sums->l2_squared += l2_lanes[lane];
+    sums->linf = std::max(sums->linf, linf_lanes[lane]);
+  }
+
+  size_t done = 4 * num_blocks;
+  const double* b_rest = (kDifference ? b + 2 * done : nullptr);
+  ScalarKernel<kDifference>(a + 2 * done, b_rest, n - done, l0_epsilon, sums);
+}
+
+template <bool kDifference>
+__attribute__((target("avx512f")))
+void AVX512Kernel(const double* a, const double* b, size_t n,
+                  double l0_epsilon, StatisticsSums* sums) {
+  __m512d l1 = _mm512_setzero_pd();
+  __m512d l2 = _mm512_setzero_pd();
+  __m512d linf = _mm512_setzero_pd();
+  __m512d eps = _mm512_set1_pd(l0_epsilon);
+  const __m512i real_index = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+  const __m512i imag_index = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+  size_t l0 = 0;
+
+  // Eight complex numbers per iteration, split into real and imaginary parts.
+  size_t num_blocks = n / 8;
+  for (size_t ii = 0; ii < num_blocks; ++ii) {
+    __m512d v0 = _mm512_loadu_pd(a + 16 * ii);
+    __m512d v1 = _mm512_loadu_pd(a + 16 * ii + 8);
+    if (kDifference) {
+      v0 = _mm512_sub_pd(v0, _mm512_loadu_pd(b + 16 * ii));
+      v1 = _mm512_sub_pd(v1, _mm512_loadu_pd(b + 16 * ii + 8));
+    }
+    __m512d re = _mm512_permutex2var_pd(v0, real_index, v1);
+    __m512d im = _mm512_permutex2var_pd(v0, imag_index, v1);
+    __m512d squared = _mm512_fmadd_pd(re, re, _mm512_mul_pd(im, im));
+    __m512d absval = _mm512_sqrt_pd(squared);
+    l0 += __builtin_popcount(_mm512_cmp_pd_mask(absval, eps, _CMP_GT_OQ));
+    l1 = _mm512_add_pd(l1, absval);
+    l2 = _mm512_add_pd(l2, squared);
+    linf = _mm512_max_pd(linf, absval);
+  }
+
+  double l1_lanes[8];
+  double l2_lanes[8];
+  double linf_lanes[8];
+  _mm512_storeu_pd(l1_lanes, l1);
+  _mm512_storeu_pd(l2_lanes, l2);
+  _mm512_storeu_pd(linf_lanes, linf);
+  sums->l0 += l0;
+  for (int lane = 0; lane < 8; ++lane) {
+    sums->l1 += l1_lanes[lane];
+    sums->l2_squared += l2_lanes[lane];
+    sums->linf = std::max(sums->linf, linf_lanes[lane]);
+  }
+
+  size_t done = 8 * num_blocks;
+  const double* b_rest = (kDifference ? b + 2 * done : nullptr);
+  ScalarKernel<kDifference>(a + 2 * done, b_rest, n - done, l0_epsilon, sums);
+}
+
+enum class KernelType {
+  SCALAR,
+  AVX2,
+  AVX512,
+};
+
+KernelType SelectKernelType() {
+  static KernelType type = []() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+      return KernelType::AVX512;
+    } else if (__builtin_cpu_supports("avx2")) {
+      return KernelType::AVX2;
+    } else {
+      return KernelType::SCALAR;
+    }
+  }();
+  return type;
+}
+
+KernelFunction SelectKernel(bool difference) {
+  KernelType type = SelectKernelType();
+  if (type == KernelType::AVX512) {
+    return difference ? AVX512Kernel<true> : AVX512Kernel<false>;
+  } else if (type == KernelType::AVX2) {
+    return difference ? AVX2Kernel<true> : AVX2Kernel<false>;
+  } else {
+    return difference ? ScalarKernel<true> : ScalarKernel<false>;
+  }
+}
+
+void ClearSums(StatisticsSums* sums) {
+  sums->l0 = 0;
+  sums->l1 = 0.0;
+  sums->l2_squared = 0.0;
+  sums->linf = 0.0;
+}
+
+}  // namespace
+
+void ComputeStatisticsSums(const std::complex<double>* a,
+                           const std::complex<double>* b,
+                           size_t n,
+                           double l0_epsilon,
+                           StatisticsSums* sums) {
+  KernelFunction kernel = SelectKernel(b != nullptr);
+  const double* a_data = reinterpret_cast<const double*>(a);
+  const double* b_data = reinterpret_cast<const double*>(b);
+  ClearSums(sums);
+
+  int max_threads = omp_get_max_threads();
+  if (n < kParallelThreshold || max_threads <= 1 || omp_in_parallel()) {
+    kernel(a_data, b_data, n, l0_epsilon, sums);
+    return;
+  }
+
+  std::vector<StatisticsSums> partial_sums(max_threads);
+  for (size_t ii = 0; ii < partial_sums.size(); ++ii) {
+    ClearSums(&(partial_sums[ii]));
+  }
+
+  #pragma omp parallel num_threads(max_threads)
+  {
+    size_t num_threads = omp_get_num_threads();
+    size_t thread_id = omp_get_thread_num();
+    // Chunks are multiples of 8 complex numbers so that only the last chunk
+    // has a remainder for the scalar loop.
+    size_t chunk = ((n + num_threads - 1) / num_threads + 7) / 8 * 8;
+    size_t begin = std::min(n, thread_id * chunk);
+    size_t end = std::min(n, begin + chunk);
+    const double* b_begin = (b_data == nullptr ? nullptr : b_data + 2 * begin);
+    kernel(a_data + 2 * begin, b_begin, end - begin, l0_epsilon,
+           &(partial_sums[thread_id]));
+  }
+
+  for (size_t ii = 0; ii < partial_sums.size(); ++ii) {
+    sums->l0 += partial_sums[ii].l0;
+    sums->l1 += partial_sums[ii].l1;
+    sums->l2_squared += partial_sums[ii].l2_squared;
+    sums->linf = std::max(sums->linf, partial_sums[ii].linf);
+  }
+}
+
+const char* StatisticsKernelName() {
+  KernelType type = SelectKernelType();
+  if (type == KernelType::AVX512) {
+    return "avx512";
+  } else if (type == KernelType::AVX2) {
+    return "avx2";
+  } else {
+    return "scalar";
+  }
+}
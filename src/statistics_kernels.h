@@ -0,0 +1,42 @@
+#ifndef __STATISTICS_KERNELS_H__
+#define __STATISTICS_KERNELS_H__
+
+#include <complex>
+
+// Single-pass, allocation-free kernels for the signal statistics in
+// result_helpers.h. The magnitude of each entry is computed as
+// sqrt(re^2 + im^2) instead of with std::abs (which goes through hypot), and
+// the sums are accumulated in several SIMD lanes and threads. Compared to the
+// straightforward scalar loop with std::abs:
+//  - the magnitude of each entry differs by at most one ulp (unless re^2 + im^2
+//    overflows or underflows, i.e., for entries above 1e154 or below 1e-154),
+//    so l0 can only differ for entries within one ulp of l0_epsilon and linf
+//    differs by at most one ulp,
+//  - l1 and l2 are summed in a different order, the relative difference is
+//    bounded by n * 2^-53 and in practice much smaller (below 1e-13 for
+//    n = 2^20).
+
+// Partial sums of the statistics. l2_squared is the squared l2-norm.
+struct StatisticsSums {
+  size_t l0;
+  double l1;
+  double l2_squared;
+  double linf;
+};
+
+// Computes the statistics of a - b, or of a if b is nullptr. The AVX-512,
+// AVX2, or scalar implementation is chosen at runtime depending on the CPU.
+// Large inputs are split across threads with OpenMP; the partial results are
+// combined in a fixed order, so the output does not depend on the thread
+// scheduling.
+void ComputeStatisticsSums(const std::complex<double>* a,
+                           const std::complex<double>* b,
+                           size_t n,
+                           double l0_epsilon,
+                           StatisticsSums* sums);
+
+// Name of the kernel implementation selected for this CPU ("avx512", "avx2",
+// or "scalar").
+const char* StatisticsKernelName();
+
+#endif
@@ -0,0 +1,157 @@
+#include "stream_reader.h"
+
+#include <algorithm>
+#include <cstring>
+
+StreamReader::StreamReader(size_t chunk_size) : chunk_size_(chunk_size),
+    file_(nullptr), consumer_buffer_(-1), error_(false), stop_(false) {
+  sizes_[0] = sizes_[1] = 0;
+  filled_[0] = filled_[1] = false;
+}
+
+bool StreamReader::Open(const std::string& filename) {
+  Close();
+  if (chunk_size_ == 0) {
+    fprintf(stderr, "The chunk size must be positive.\n");
+    return false;
+  }
+  file_ = fopen(filename.c_str(), "rb");
+  if (file_ == nullptr) {
+    fprintf(stderr, "Could not open file %s.\n", filename.c_str());
+    return false;
+  }
+  buffers_[0].resize(chunk_size_);
+  buffers_[1].resize(chunk_size_);
+  filled_[0] = filled_[1] = false;
+  consumer_buffer_ = -1;
+  error_ = false;
+  stop_ = false;
+  thread_ = std::thread(&StreamReader::ReaderLoop, this);
+  return true;
+}
+
+void StreamReader::ReaderLoop() {
+  for (int buffer = 0; ; buffer = 1 - buffer) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this, buffer] { return stop_ || !filled_[buffer]; });
+      if (stop_) {
+        return;
+      }
+    }
+
+    // The buffer is neither filled nor handed out, so we can write to it
+    // without holding the lock.
+    size_t num_read = fread(buffers_[buffer].data(),
+                            sizeof(std::complex<double>), chunk_size_, file_);
+    bool read_error = ferror(file_);
+    if (num_read < chunk_size_ && !read_error && !feof(file_)) {
+      read_error = true;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    sizes_[buffer] = num_read;
+    filled_[buffer] = true;
+    error_ = read_error;
+    cv_.notify_all();
+    if (num_read < chunk_size_) {
+      // End of the file (or an error). The empty or partial chunk is the
+      // last one.
+      return;
+    }
+  }
+}
+
+bool StreamReader::NextChunk(const std::complex<double>** data,
+                             size_t* size) {
+  if (file_ == nullptr) {
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  int next = 0;
+  if (consumer_buffer_ >= 0) {
+    if (sizes_[consumer_buffer_] < chunk_size_) {
+      // The previous chunk was the last one.
+      *data = nullptr;
+      *size = 0;
+      return !error_;
+    }
+    filled_[consumer_buffer_] = false;
+    next = 1 - consumer_buffer_;
+    cv_.notify_all();
+  }
+  cv_.wait(lock, [this, next] { return filled_[next]; });
+  consumer_buffer_ = next;
+  if (error_) {
+    fprintf(stderr, "Error while reading the input stream.\n");
+    return false;
+  }
+  *data = buffers_[next].data();
+  *size = sizes_[next];
+  return true;
+}
+
+void StreamReader::Close() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+      cv_.notify_all();
+    }
+    thread_.join();
+  }
+  if (file_ != nullptr) {
+    if (fclose(file_) != 0) {
+      fprintf(stderr, "Could not close input.\n");
+    }
+    file_ = nullptr;
+  }
+}
+
+bool SlidingWindow::Read(std::complex<double>* dest, size_t count) {
+  while (count > 0) {
+    if (chunk_pos_ == chunk_size_) {
+      if (!reader_->NextChunk(&chunk_, &chunk_size_)) {
+        failed_ = true;
+        return false;
+      }
+      chunk_pos_ = 0;
+      if (chunk_size_ == 0) {
+        return false;
+      }
+    }
+    size_t num = std::min(count, chunk_size_ - chunk_pos_);
+    if (dest != nullptr) {
+      memcpy(dest, chunk_ + chunk_pos_, num * sizeof(std::complex<double>));
+      dest += num;
+    }
+    chunk_pos_ += num;
+    count -= num;
+  }
+  return true;
+}
+
+bool SlidingWindow::Next() {
+  if (num_windows_ == 0) {
+    if (!Read(window_.data(), window_size_)) {
+      return false;
+    }
+  } else if (hop_size_ < window_size_) {
+    // Keep the overlap and append hop_size new elements.
+    size_t keep = window_size_ - hop_size_;
+    memmove(window_.data(), window_.data() + hop_size_,
+            keep * sizeof(std::complex<double>));
+    if (!Read(window_.data() + keep, hop_size_)) {
+      return false;
+    }
+    offset_ += hop_size_;
+  } else {
+    if (!Read(nullptr, hop_size_ - window_size_)
+        || !Read(window_.data(), window_size_)) {
+      return false;
+    }
+    offset_ += hop_size_;
+  }
+  ++num_windows_;
+  return true;
+}
@@ -0,0 +1,99 @@
+#ifndef __STREAM_READER_H__
+#define __STREAM_READER_H__
+
+#include <complex>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Reads a long binary file of complex doubles in fixed-size chunks. A reader
+// thread fills one of two chunk buffers while the caller works on the other,
+// so that I/O overlaps with computation and at most two chunks are in memory.
+class StreamReader {
+ public:
+  explicit StreamReader(size_t chunk_size);
+
+  // The file can also be a pipe (e.g., /dev/stdin).
+  bool Open(const std::string& filename);
+
+  // Returns the next chunk in data and its size in size. The chunk contains
+  // chunk_size elements except for the last one; size is 0 at the end of the
+  // file. The data is valid until the next call. Returns false on read
+  // errors.
+  bool NextChunk(const std::complex<double>** data, size_t* size);
+
+  void Close();
+
+  ~StreamReader() {
+    Close();
+  }
+
+ private:
+  size_t chunk_size_;
+  FILE* file_;
+  std::vector<std::complex<double>> buffers_[2];
+  size_t sizes_[2];
+  bool filled_[2];
+  // Buffer currently handed out by NextChunk (-1 if none).
+  int consumer_buffer_;
+  bool error_;
+  bool stop_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  void ReaderLoop();
+
+  StreamReader(const StreamReader&) = delete;
+  StreamReader& operator=(const StreamReader&) = delete;
+};
+
+// Overlapping windows of window_size elements over a stream, with hop_size
+// elements between the starts of consecutive windows. A final window that
+// would extend beyond the end of the stream is dropped.
+class SlidingWindow {
+ public:
+  SlidingWindow(StreamReader* reader, size_t window_size, size_t hop_size)
+      : reader_(reader), window_size_(window_size), hop_size_(hop_size),
+        window_(window_size), offset_(0), num_windows_(0), chunk_(nullptr),
+        chunk_size_(0), chunk_pos_(0), failed_(false) {}
+
+  // Advances to the next window. Returns false at the end of the stream or on
+  // errors (see failed()).
+  bool Next();
+
+  // The window_size elements of the current window (contiguous).
+  const std::complex<double>* data() const {
+    return window_.data();
+  }
+
+  // Position of the first element of the current window in the stream.
+  size_t offset() const {
+    return offset_;
+  }
+
+  bool failed() const {
+    return failed_;
+  }
+
+ private:
+  StreamReader* reader_;
+  size_t window_size_;
+  size_t hop_size_;
+  std::vector<std::complex<double>> window_;
+  size_t offset_;
+  size_t num_windows_;
+  const std::complex<double>* chunk_;
+  size_t chunk_size_;
+  size_t chunk_pos_;
+  bool failed_;
+
+  // Copies (or, if dest is nullptr, skips) the next count elements of the
+  // stream. Returns false if the stream ends before.
+  bool Read(std::complex<double>* dest, size_t count);
+};
+
+#endif
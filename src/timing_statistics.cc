@@ -0,0 +1,146 @@
+#include "timing_statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+namespace {
+
+const size_t kNumBootstrapResamples = 1000;
+const double kOutlierThreshold = 3.5;
+
+double Median(std::vector<double>* values) {
+  std::sort(values->begin(), values->end());
+  return Quantile(*values, 0.5);
+}
+
+}  // namespace
+
+double Quantile(const std::vector<double>& sorted_values, double q) {
+  double pos = q * (sorted_values.size() - 1);
+  size_t lower = static_cast<size_t>(std::floor(pos));
+  size_t upper = std::min(lower + 1, sorted_values.size() - 1);
+  double fraction = pos - lower;
+  return sorted_values[lower]
+      + fraction * (sorted_values[upper] - sorted_values[lower]);
+}
+
+bool IsTimingStable(const std::vector<double>& times,
+                    size_t window,
+                    double relative_tolerance) {
+  if (window == 0 || times.size() < 2 * window) {
+    return false;
+  }
+  std::vector<double> previous(times.end() - 2 * window,
+                               times.end() - window);
+  std::vector<double> last(times.end() - window, times.end());
+  double previous_median = Median(&previous);
+  double last_median = Median(&last);
+  return std::abs(last_median - previous_median)
+      <= relative_tolerance * previous_median;
+}
+
+void BootstrapMedianCI(const std::vector<double>& times,
+                       size_t num_resamples,
+                       double* low,
+                       double* high) {
+  if (times.empty()) {
+    *low = 0.0;
+    *high = 0.0;
+    return;
+  }
+  std::mt19937_64 prng(0x5eed);
+  std::uniform_int_distribution<size_t> index_distribution(0,
+                                                           times.size() - 1);
+  std::vector<double> resample(times.size());
+  std::vector<double> medians(num_resamples);
+  for (size_t ii = 0; ii < num_resamples; ++ii) {
+    for (size_t jj = 0; jj < times.size(); ++jj) {
+      resample[jj] = times[index_distribution(prng)];
+    }
+    medians[ii] = Median(&resample);
+  }
+  std::sort(medians.begin(), medians.end());
+  *low = Quantile(medians, 0.025);
+  *high = Quantile(medians, 0.975);
+}
+
+double RelativeMedianCIWidth(const std::vector<double>& times) {
+  std::vector<double> sorted(times);
+  double median = Median(&sorted);
+  double low;
+  double high;
+  BootstrapMedianCI(times, kNumBootstrapResamples, &low, &high);
+  return (median > 0.0 ? (high - low) / median : 0.0);
+}
+
+void ComputeTimingStatistics(const std::vector<double>& times,
+                             size_t num_warmup_runs,
+                             TimingStatistics* stats) {
+  stats->num_warmup_runs = num_warmup_runs;
+  stats->num_samples = times.size();
+  stats->num_outliers = 0;
+  if (times.empty()) {
+    stats->median = stats->p5 = stats->p95 = stats->mad = 0.0;
+    stats->mean_without_outliers = 0.0;
+    stats->median_ci_low = stats->median_ci_high = 0.0;
+    return;
+  }
+
+  std::vector<double> sorted(times);
+  std::sort(sorted.begin(), sorted.end());
+  stats->median = Quantile(sorted, 0.5);
+  stats->p5 = Quantile(sorted, 0.05);
+  stats->p95 = Quantile(sorted, 0.95);
+
+  std::vector<double> deviations(times.size());
+  for (size_t ii = 0; ii < times.size(); ++ii) {
+    deviations[ii] = std::abs(times[ii] - stats->median);
+  }
+  stats->mad = Median(&deviations);
+
+  double sum = 0.0;
+  for (size_t ii = 0; ii < times.size(); ++ii) {
+    double deviation = std::abs(times[ii] - stats->median);
+    // With a MAD of zero, every sample that differs from the median counts
+    // as an outlier.
+    if (0.6745 * deviation > kOutlierThreshold * stats->mad) {
+      ++(stats->num_outliers);
+    } else {
+      sum += times[ii];
+    }
+  }
+  stats->mean_without_outliers = sum / (times.size() - stats->num_outliers);
+
+  BootstrapMedianCI(times, kNumBootstrapResamples, &(stats->median_ci_low),
+                    &(stats->median_ci_high));
+}
+
+void WriteTimingStatisticsJSONToStream(const TimingStatistics& stats,
+                                       size_t indent,
+                                       std::ostream* out) {
+  std::ostream& oref = *out;
+  std::string indentation(indent, ' ');
+
+  oref << indentation << "\"num_warmup_runs\": " << stats.num_warmup_runs
+      << ",\n";
+  oref << indentation << "\"num_samples\": " << stats.num_samples << ","
+      << '\n';
+  oref << indentation << "\"num_outliers\": " << stats.num_outliers << ","
+      << '\n';
+  oref << indentation << "\"median\": " << std::scientific << stats.median
+      << ",\n";
+  oref << indentation << "\"p5\": " << std::scientific << stats.p5 << ","
+      << '\n';
+  oref << indentation << "\"p95\": " << std::scientific << stats.p95 << ","
+      << '\n';
+  oref << indentation << "\"mad\": " << std::scientific << stats.mad << ","
+      << '\n';
+  oref << indentation << "\"mean_without_outliers\": " << std::scientific
+      << stats.mean_without_outliers << ",\n";
+  oref << indentation << "\"median_ci_low\": " << std::scientific
+      << stats.median_ci_low << ",\n";
+  oref << indentation << "\"median_ci_high\": " << std::scientific
+      << stats.median_ci_high << '\n';
+}
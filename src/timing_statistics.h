@@ -0,0 +1,55 @@
+#ifndef __TIMING_STATISTICS_H__
+#define __TIMING_STATISTICS_H__
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Summary of the running times of one algorithm on one input.
+struct TimingStatistics {
+  size_t num_warmup_runs;
+  size_t num_samples;
+  // Samples whose modified z-score 0.6745 * |t - median| / MAD exceeds 3.5
+  // (Iglewicz and Hoaglin). Outliers are only excluded from the mean.
+  size_t num_outliers;
+  double median;
+  double p5;
+  double p95;
+  // Median absolute deviation from the median.
+  double mad;
+  double mean_without_outliers;
+  // 95% percentile bootstrap confidence interval of the median.
+  double median_ci_low;
+  double median_ci_high;
+};
+
+// The q-quantile (0 <= q <= 1) of a sorted, non-empty vector with linear
+// interpolation between the closest ranks.
+double Quantile(const std::vector<double>& sorted_values, double q);
+
+// True if the median of the last window times differs from the median of the
+// window before by at most relative_tolerance. Used to detect the end of the
+// warm-up phase (caches, branch predictors, CPU frequency).
+bool IsTimingStable(const std::vector<double>& times,
+                    size_t window,
+                    double relative_tolerance);
+
+// 95% percentile bootstrap confidence interval of the median. The resampling
+// uses a fixed seed, so the result only depends on the samples.
+void BootstrapMedianCI(const std::vector<double>& times,
+                       size_t num_resamples,
+                       double* low,
+                       double* high);
+
+// Width of the confidence interval of the median relative to the median.
+double RelativeMedianCIWidth(const std::vector<double>& times);
+
+void ComputeTimingStatistics(const std::vector<double>& times,
+                             size_t num_warmup_runs,
+                             TimingStatistics* stats);
+
+void WriteTimingStatisticsJSONToStream(const TimingStatistics& stats,
+                                       size_t indent,
+                                       std::ostream* out);
+
+#endif
@@ -0,0 +1,99 @@
+#include "top_k.h"
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+#include <omp.h>
+
+namespace {
+
+// Inputs smaller than this are processed by a single thread.
+const size_t kParallelThreshold = 1 << 16;
+
+// (squared magnitude, index). Larger pairs are better.
+typedef std::pair<double, size_t> Candidate;
+
+inline double SquaredMagnitude(const std::complex<double>& x) {
+  return x.real() * x.real() + x.imag() * x.imag();
+}
+
+// Adds the best k entries of x[begin, end) to candidates.
+void SelectWithHeap(const std::complex<double>* x,
+                    size_t begin,
+                    size_t end,
+                    size_t k,
+                    std::vector<Candidate>* candidates) {
+  // Min-heap with the worst of the current best k candidates at the front.
+  std::vector<Candidate> heap;
+  heap.reserve(k);
+  std::greater<Candidate> comp;
+  for (size_t ii = begin; ii < end; ++ii) {
+    double value = SquaredMagnitude(x[ii]);
+    if (heap.size() < k) {
+      heap.push_back(std::make_pair(value, ii));
+      std::push_heap(heap.begin(), heap.end(), comp);
+    } else if (value >= heap.front().first) {
+      Candidate candidate = std::make_pair(value, ii);
+      if (comp(candidate, heap.front())) {
+        std::pop_heap(heap.begin(), heap.end(), comp);
+        heap.back() = candidate;
+        std::push_heap(heap.begin(), heap.end(), comp);
+      }
+    }
+  }
+  candidates->insert(candidates->end(), heap.begin(), heap.end());
+}
+
+}  // namespace
+
+void SelectTopK(const std::complex<double>* x,
+                size_t n,
+                size_t k,
+                std::vector<size_t>* indices) {
+  k = std::min(k, n);
+  indices->clear();
+  if (k == 0) {
+    return;
+  }
+
+  std::vector<Candidate> candidates;
+  if (k > n / 16) {
+    candidates.reserve(n);
+    for (size_t ii = 0; ii < n; ++ii) {
+      candidates.push_back(std::make_pair(SquaredMagnitude(x[ii]), ii));
+    }
+  } else if (n < kParallelThreshold || omp_get_max_threads() <= 1
+             || omp_in_parallel()) {
+    SelectWithHeap(x, 0, n, k, &candidates);
+  } else {
+    int max_threads = omp_get_max_threads();
+    std::vector<std::vector<Candidate>> thread_candidates(max_threads);
+    #pragma omp parallel num_threads(max_threads)
+    {
+      size_t num_threads = omp_get_num_threads();
+      size_t thread_id = omp_get_thread_num();
+      size_t chunk = (n + num_threads - 1) / num_threads;
+      size_t begin = std::min(n, thread_id * chunk);
+      size_t end = std::min(n, begin + chunk);
+      SelectWithHeap(x, begin, end, k, &(thread_candidates[thread_id]));
+    }
+    for (size_t ii = 0; ii < thread_candidates.size(); ++ii) {
+      candidates.insert(candidates.end(), thread_candidates[ii].begin(),
+                        thread_candidates[ii].end());
+    }
+  }
+
+  std::greater<Candidate> comp;
+  if (candidates.size() > k) {
+    std::nth_element(candidates.begin(), candidates.begin() + k - 1,
+                     candidates.end(), comp);
+    candidates.resize(k);
+  }
+  std::sort(candidates.begin(), candidates.end(), comp);
+
+  indices->reserve(k);
+  for (size_t ii = 0; ii < k; ++ii) {
+    indices->push_back(candidates[ii].second);
+  }
+}
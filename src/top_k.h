@@ -0,0 +1,22 @@
+#ifndef __TOP_K_H__
+#define __TOP_K_H__
+
+#include <complex>
+#include <vector>
+
+// Selects the indices of the k entries of x with the largest magnitudes and
+// returns them sorted by decreasing magnitude. Ties are broken in favor of the
+// larger index, which is the order of the former full sort in
+// ComputeBestKTermRepresentation. Magnitudes are compared via the squared
+// magnitudes, so no square roots are computed.
+//
+// For k much smaller than n, every thread keeps a bounded min-heap of its
+// best k candidates (most entries are rejected with a single comparison
+// against the heap minimum), and the per-thread candidates are merged at the
+// end. For large k, std::nth_element is used instead.
+void SelectTopK(const std::complex<double>* x,
+                size_t n,
+                size_t k,
+                std::vector<size_t>* indices);
+
+#endif
@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "fft_wrapper.h"
+#include "fftw_interface.h"
+#include "fftw_wisdom.h"
+#include "signal_generator.h"
+#include "sparse_signal.h"
+#include "tuning_database.h"
+
+namespace po = boost::program_options;
+
+using std::complex;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+// Auto-tuner for the parameters of the sparse FFT algorithms. Runs an
+// algorithm on synthetic inputs from the gen_input generator and searches
+// its parameter space (see FFTWrapper::GetTunableParameters) for the fastest
+// configuration whose error is below the target on all inputs and trials.
+// The result is stored in the tuning database, which run_experiment and
+// run_stream read with --tuning_db.
+//
+// The search is a coordinate descent: starting from the initial values,
+// each parameter in turn is set to each of its candidate values while the
+// others are kept fixed, and the best configuration so far is kept. This is
+// repeated until a round brings no improvement. Configurations that miss the
+// target are ranked by their error, so the search first moves towards
+// accurate configurations and then towards fast ones.
+
+struct TuningInput {
+  vector<complex<double>> signal;
+  vector<complex<double>> spectrum;
+  double spectrum_norm2;
+};
+
+struct Evaluation {
+  bool valid;
+  bool feasible;
+  // Maximum relative l2 error over all inputs and trials.
+  double error;
+  // Median running time over all inputs and trials.
+  double time;
+};
+
+// Returns true if a is better than b.
+bool IsBetter(const Evaluation& a, const Evaluation& b) {
+  if (a.valid != b.valid) {
+    return a.valid;
+  }
+  if (a.feasible != b.feasible) {
+    return a.feasible;
+  }
+  if (a.feasible) {
+    return a.time < b.time;
+  }
+  return a.error < b.error;
+}
+
+// ||output - spectrum||_2 / ||spectrum||_2 in O(output size).
+double RelativeError(const SparseSignal& output, const TuningInput& input) {
+  double error2 = input.spectrum_norm2;
+  for (size_t ii = 0; ii < output.size(); ++ii) {
+    const complex<double>& reference = input.spectrum[output.indices[ii]];
+    error2 += std::norm(output.values[ii] - reference)
+              - std::norm(reference);
+  }
+  return std::sqrt(std::max(error2, 0.0) / input.spectrum_norm2);
+}
+
+bool GenerateInputs(size_t n, size_t rows, size_t k, double noise_variance,
+                    size_t num_inputs, uint64_t seed,
+                    vector<TuningInput>* inputs) {
+  GeneratorOptions options;
+  options.n = n;
+  options.k = k;
+  options.noise_variance = noise_variance;
+  options.rows = rows;
+  SignalGenerator generator(options);
+  if (!generator.Setup()) {
+    fprintf(stderr, "Could not set up the signal generator.\n");
+    return false;
+  }
+  FFTWInterface reference(n, FFTW_ESTIMATE, 1, rows);
+  if (!reference.Setup()) {
+    fprintf(stderr, "Could not set up the reference FFT.\n");
+    return false;
+  }
+
+  inputs->resize(num_inputs);
+  for (size_t ii = 0; ii < num_inputs; ++ii) {
+    TuningInput& input = (*inputs)[ii];
+    GeneratorStatistics stats;
+    generator.Generate(InstanceSeed(seed, ii + 1), 0, &stats);
+    input.signal.resize(n);
+    generator.CopySignal(0, input.signal.data(), &stats);
+    double time;
+    if (!reference.RunTrial(input.signal.data(), &input.spectrum, &time)) {
+      return false;
+    }
+    input.spectrum_norm2 = 0.0;
+    for (size_t jj = 0; jj < n; ++jj) {
+      input.spectrum_norm2 += std::norm(input.spectrum[jj]);
+    }
+  }
+  return true;
+}
+
+Evaluation Evaluate(FFTWrapper::Type type, size_t n, size_t k,
+                    const FFTWrapper::PlanningOptions& options,
+                    const vector<TuningInput>& inputs, size_t num_trials,
+                    double max_error) {
+  Evaluation result;
+  result.valid = false;
+  result.feasible = false;
+  result.error = std::numeric_limits<double>::infinity();
+  result.time = std::numeric_limits<double>::infinity();
+
+  FFTWrapper fft(n, k, type, options);
+  if (!fft.Setup()) {
+    return result;
+  }
+  vector<double> times;
+  double max_seen_error = 0.0;
+  for (size_t ii = 0; ii < inputs.size(); ++ii) {
+    SparseSignal output;
+    double time;
+    // Warm-up run.
+    if (!fft.RunTrialSparse(inputs[ii].signal.data(), n, &output, &time)) {
+      return result;
+    }
+    for (size_t trial = 0; trial < num_trials; ++trial) {
+      if (!fft.RunTrialSparse(inputs[ii].signal.data(), n, &output, &time)) {
+        return result;
+      }
+      times.push_back(time);
+      max_seen_error = std::max(max_seen_error,
+                                RelativeError(output, inputs[ii]));
+    }
+  }
+  std::sort(times.begin(), times.end());
+  result.valid = true;
+  result.error = max_seen_error;
+  result.time = times[times.size() / 2];
+  result.feasible = (result.error <= max_error);
+  return result;
+}
+
+void PrintEvaluation(const TuningParameters& parameters,
+                     const Evaluation& evaluation) {
+  if (!evaluation.valid) {
+    printf("  invalid                        %s\n",
+           TuningParametersToString(parameters).c_str());
+  } else {
+    printf("  time %.3e  error %.3e %s %s\n", evaluation.time,
+           evaluation.error, evaluation.feasible ? " " : "*",
+           TuningParametersToString(parameters).c_str());
+  }
+  fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+  string algorithm;
+  size_t n;
+  size_t rows;
+  size_t k;
+  double noise_variance;
+  size_t num_inputs;
+  size_t num_trials;
+  double max_error;
+  size_t max_rounds;
+  uint64_t seed;
+  string fftw_planning;
+  string tuning_db;
+  string filter_cache_dir;
+  string wisdom_file;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+      ("algorithm", po::value<string>(&algorithm),
+          "Sparse FFT algorithm to tune: aafft, sfft1-mit, sfft2-mit, "
+          "sfft1-native, sfft2-native, or sfft2d-native (with --rows).")
+      ("fftw_planning",
+          po::value<string>(&fftw_planning)->default_value("measure"),
+          "FFTW planner rigor for the bucket FFTs of the native sparse FFTs. "
+          "Should match the one used with the tuned parameters later. The "
+          "default is measure.")
+      ("filter_cache_dir",
+          po::value<string>(&filter_cache_dir)->default_value(""),
+          "Directory for caching the filters of the sfft1-mit and sfft2-mit "
+          "algorithms across runs (keyed by n and the filter parameters). "
+          "The cached filters are memory-mapped instead of recomputed. Empty "
+          "string if no cache should be used. The default is \"\".")
+      ("help", "Show help message.")
+      ("k", po::value<size_t>(&k), "Sparsity")
+      ("max_error", po::value<double>(&max_error)->default_value(1e-3),
+          "Target error: the maximum relative l2 error of the output "
+          "(||output - FFT(x)||_2 / ||FFT(x)||_2) over all inputs and trials. "
+          "With noise, this must be above the relative noise level. The "
+          "default is 1e-3.")
+      ("max_rounds", po::value<size_t>(&max_rounds)->default_value(3),
+          "Maximum number of rounds of the coordinate descent. The default "
+          "is 3.")
+      ("n", po::value<size_t>(&n), "Signal size")
+      ("noise_variance",
+          po::value<double>(&noise_variance)->default_value(-1.0),
+          "Noise variance of the generated inputs (see gen_input). If "
+          "negative, no noise is added. The default is -1.")
+      ("num_inputs", po::value<size_t>(&num_inputs)->default_value(3),
+          "Number of generated inputs. The default is 3.")
+      ("num_trials", po::value<size_t>(&num_trials)->default_value(3),
+          "Number of trials per input and configuration (after one warm-up "
+          "run). The default is 3.")
+      ("rows", po::value<size_t>(&rows)->default_value(1),
+          "Number of rows of the generated inputs (2D signals if rows > 1, "
+          "see run_experiment --rows). The default is 1.")
+      ("seed", po::value<uint64_t>(&seed)->default_value(0),
+          "Seed of the generated inputs. The default is 0.")
+      ("tuning_db", po::value<string>(&tuning_db),
+          "Tuning database to which the result is added (created if it does "
+          "not exist).")
+      ("wisdom_file", po::value<string>(&wisdom_file)->default_value(""),
+          "File for loading and saving FFTW wisdom (or \"\" for no wisdom "
+          "file). The default is \"\".");
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    cout << desc << endl;
+    return 0;
+  }
+  if (!vm.count("algorithm") || !vm.count("n") || !vm.count("k")
+      || !vm.count("tuning_db")) {
+    fprintf(stderr, "The options algorithm, n, k, and tuning_db are "
+                    "required.\n");
+    return 1;
+  }
+  if (num_inputs == 0 || num_trials == 0) {
+    fprintf(stderr, "The numbers of inputs and trials must be positive.\n");
+    return 1;
+  }
+  if (rows == 0 || n % rows != 0) {
+    fprintf(stderr, "The number of rows must divide n.\n");
+    return 1;
+  }
+
+  FFTWrapper::Type type;
+  if (!FFTWrapper::ParseType(algorithm, &type)) {
+    fprintf(stderr, "Unknown algorithm type \"%s\".\n", algorithm.c_str());
+    return 1;
+  }
+  vector<TunableParameter> space;
+  if (!FFTWrapper::GetTunableParameters(type, n, k, &space)) {
+    fprintf(stderr, "Algorithm %s has no tunable parameters.\n",
+            algorithm.c_str());
+    return 1;
+  }
+  FFTWrapper::PlanningOptions options;
+  options.filter_cache_dir = filter_cache_dir;
+  options.rows = rows;
+  if (!FFTWWisdom::ParsePlanningFlags(fftw_planning, &options.fftw_flags)) {
+    fprintf(stderr, "Unknown FFTW planning option \"%s\".\n",
+        fftw_planning.c_str());
+    return 1;
+  }
+
+  FFTWWisdom wisdom(wisdom_file);
+  if (!wisdom.Load()) {
+    return 1;
+  }
+
+  vector<TuningInput> inputs;
+  if (!GenerateInputs(n, rows, k, noise_variance, num_inputs, seed,
+                      &inputs)) {
+    return 1;
+  }
+
+  TuningParameters current;
+  for (size_t ii = 0; ii < space.size(); ++ii) {
+    current[space[ii].name] = space[ii].initial;
+  }
+  options.parameters = current;
+  Evaluation best = Evaluate(type, n, k, options, inputs, num_trials,
+                             max_error);
+  printf("Initial configuration:\n");
+  PrintEvaluation(current, best);
+
+  for (size_t round = 0; round < max_rounds; ++round) {
+    printf("Round %lu:\n", round + 1);
+    bool improved = false;
+    for (size_t ii = 0; ii < space.size(); ++ii) {
+      const TunableParameter& parameter = space[ii];
+      double start_value = current[parameter.name];
+      for (size_t jj = 0; jj < parameter.values.size(); ++jj) {
+        if (parameter.values[jj] == start_value) {
+          continue;
+        }
+        options.parameters = current;
+        options.parameters[parameter.name] = parameter.values[jj];
+        Evaluation evaluation = Evaluate(type, n, k, options, inputs,
+                                         num_trials, max_error);
+        PrintEvaluation(options.parameters, evaluation);
+        if (IsBetter(evaluation, best)) {
+          best = evaluation;
+          current = options.parameters;
+          improved = true;
+        }
+      }
+    }
+    if (!improved) {
+      break;
+    }
+  }
+
+  if (!wisdom.Save()) {
+    return 1;
+  }
+
+  if (!best.feasible) {
+    fprintf(stderr, "No configuration of %s meets the target error %e (best "
+                    "error: %e). The tuning database is not changed.\n",
+            algorithm.c_str(), max_error, best.error);
+    return 1;
+  }
+  printf("Best configuration (time %.3e, error %.3e):\n  %s\n", best.time,
+         best.error, TuningParametersToString(current).c_str());
+
+  TuningDatabase database;
+  if (!database.Update(tuning_db, FFTWrapper::TypeName(type), n, rows, k,
+                       current)) {
+    return 1;
+  }
+  return 0;
+}
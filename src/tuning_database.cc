@@ -0,0 +1,209 @@
+#include "tuning_database.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+namespace {
+
+// Parses <n> or <rows>x<cols>.
+bool ParseShape(const std::string& str, size_t* n, size_t* rows) {
+  size_t pos = str.find('x');
+  char* end = nullptr;
+  if (pos == std::string::npos) {
+    *n = strtoul(str.c_str(), &end, 10);
+    *rows = 1;
+    return !str.empty() && *end == '\0';
+  }
+  *rows = strtoul(str.c_str(), &end, 10);
+  if (end != str.c_str() + pos || pos == 0) {
+    return false;
+  }
+  size_t cols = strtoul(str.c_str() + pos + 1, &end, 10);
+  *n = *rows * cols;
+  return pos + 1 < str.size() && *end == '\0' && *rows > 1 && cols > 0;
+}
+
+}  // namespace
+
+double GetTuningParameter(const TuningParameters& parameters,
+                          const std::string& name, double default_value) {
+  auto iter = parameters.find(name);
+  if (iter == parameters.end()) {
+    return default_value;
+  }
+  return iter->second;
+}
+
+bool CheckTuningParameters(const TuningParameters& parameters,
+                           const std::vector<TunableParameter>& space,
+                           const std::string& algorithm) {
+  for (auto kv : parameters) {
+    bool found = false;
+    for (size_t ii = 0; ii < space.size(); ++ii) {
+      if (space[ii].name == kv.first) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      fprintf(stderr, "Unknown parameter \"%s\" for algorithm %s.\n",
+              kv.first.c_str(), algorithm.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string TuningParametersToString(const TuningParameters& parameters) {
+  std::string result;
+  for (auto kv : parameters) {
+    if (!result.empty()) {
+      result += " ";
+    }
+    // The shortest representation that reads back as the same double.
+    char buffer[32];
+    for (int precision = 6; precision <= 17; ++precision) {
+      snprintf(buffer, sizeof(buffer), "%.*g", precision, kv.second);
+      if (strtod(buffer, nullptr) == kv.second) {
+        break;
+      }
+    }
+    result += kv.first + "=" + buffer;
+  }
+  return result;
+}
+
+bool TuningDatabase::Load(const std::string& filename) {
+  std::ifstream in(filename);
+  if (!in.is_open()) {
+    if (access(filename.c_str(), F_OK) == 0) {
+      fprintf(stderr, "Could not open tuning database %s.\n",
+              filename.c_str());
+      return false;
+    }
+    return true;
+  }
+  std::string line;
+  size_t line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    size_t begin = line.find_first_not_of(" \t");
+    if (begin == std::string::npos || line[begin] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string algorithm, shape;
+    size_t n, rows, k;
+    if (!(fields >> algorithm >> shape >> k)
+        || !ParseShape(shape, &n, &rows)) {
+      fprintf(stderr, "Invalid entry in tuning database %s, line %lu.\n",
+              filename.c_str(), line_number);
+      return false;
+    }
+    TuningParameters parameters;
+    std::string field;
+    while (fields >> field) {
+      size_t pos = field.find('=');
+      char* end = nullptr;
+      double value = 0.0;
+      if (pos != std::string::npos) {
+        value = strtod(field.c_str() + pos + 1, &end);
+      }
+      if (pos == std::string::npos || pos == 0 || end == nullptr
+          || *end != '\0' || end == field.c_str() + pos + 1) {
+        fprintf(stderr, "Invalid parameter \"%s\" in tuning database %s, "
+                        "line %lu.\n", field.c_str(), filename.c_str(),
+                line_number);
+        return false;
+      }
+      parameters[field.substr(0, pos)] = value;
+    }
+    Set(algorithm, n, rows, k, parameters);
+  }
+  return true;
+}
+
+bool TuningDatabase::Save(const std::string& filename) const {
+  std::string tmp_filename = filename + ".tmp."
+                             + std::to_string(getpid());
+  FILE* out = fopen(tmp_filename.c_str(), "w");
+  if (out == nullptr) {
+    fprintf(stderr, "Could not open %s for writing.\n", tmp_filename.c_str());
+    return false;
+  }
+  fprintf(out, "# algorithm n (rowsxcols for 2D) k parameters\n");
+  for (auto kv : entries_) {
+    size_t n = std::get<1>(kv.first);
+    size_t rows = std::get<2>(kv.first);
+    std::string shape = std::to_string(n);
+    if (rows > 1) {
+      shape = std::to_string(rows) + "x" + std::to_string(n / rows);
+    }
+    fprintf(out, "%s %s %lu %s\n", std::get<0>(kv.first).c_str(),
+            shape.c_str(), std::get<3>(kv.first),
+            TuningParametersToString(kv.second).c_str());
+  }
+  if (fclose(out) != 0) {
+    fprintf(stderr, "Error while writing %s.\n", tmp_filename.c_str());
+    unlink(tmp_filename.c_str());
+    return false;
+  }
+  if (rename(tmp_filename.c_str(), filename.c_str()) != 0) {
+    fprintf(stderr, "Could not rename %s to %s.\n", tmp_filename.c_str(),
+            filename.c_str());
+    unlink(tmp_filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool TuningDatabase::Lookup(const std::string& algorithm, size_t n,
+                            size_t rows, size_t k,
+                            TuningParameters* parameters) const {
+  auto iter = entries_.find(std::make_tuple(algorithm, n, rows, k));
+  if (iter == entries_.end()) {
+    return false;
+  }
+  *parameters = iter->second;
+  return true;
+}
+
+void TuningDatabase::Set(const std::string& algorithm, size_t n, size_t rows,
+                         size_t k, const TuningParameters& parameters) {
+  entries_[std::make_tuple(algorithm, n, rows, k)] = parameters;
+}
+
+bool TuningDatabase::Update(const std::string& filename,
+                            const std::string& algorithm, size_t n,
+                            size_t rows, size_t k,
+                            const TuningParameters& parameters) {
+  std::string lock_filename = filename + ".lock";
+  int fd = open(lock_filename.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Could not open tuning database lock file %s.\n",
+            lock_filename.c_str());
+    return false;
+  }
+  if (flock(fd, LOCK_EX) != 0) {
+    fprintf(stderr, "Could not lock tuning database lock file %s.\n",
+            lock_filename.c_str());
+    close(fd);
+    return false;
+  }
+  entries_.clear();
+  bool success = Load(filename);
+  if (success) {
+    Set(algorithm, n, rows, k, parameters);
+    success = Save(filename);
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+  return success;
+}
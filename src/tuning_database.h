@@ -0,0 +1,72 @@
+#ifndef __TUNING_DATABASE_H__
+#define __TUNING_DATABASE_H__
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Parameter values of a sparse FFT backend by name (e.g., "loops_loc" or
+// "Bcst_loc"). Parameters that are not set keep the defaults of the backend.
+typedef std::map<std::string, double> TuningParameters;
+
+// A parameter of a backend together with the values the auto-tuner tries.
+struct TunableParameter {
+  std::string name;
+  // Value of the first configuration tried by the tuner.
+  double initial;
+  std::vector<double> values;
+};
+
+// Returns the value of the parameter with the given name, or default_value
+// if it is not set.
+double GetTuningParameter(const TuningParameters& parameters,
+                          const std::string& name, double default_value);
+
+// Returns false (and prints an error) if parameters contains a name that is
+// not in the parameter space of the algorithm.
+bool CheckTuningParameters(const TuningParameters& parameters,
+                           const std::vector<TunableParameter>& space,
+                           const std::string& algorithm);
+
+// Formats the parameters as "name=value name=value ...".
+std::string TuningParametersToString(const TuningParameters& parameters);
+
+// Tuned parameters per (algorithm, n, rows, k), stored in a text file with
+// one entry per line:
+//
+//   <algorithm> <n> <k> <name>=<value> <name>=<value> ...
+//
+// For 2D signals (rows > 1), <n> is written as <rows>x<cols>, since the
+// parameters depend on the shape and not only on n. Empty lines and lines
+// starting with '#' are ignored. If an entry occurs more than once, the last
+// one is used.
+class TuningDatabase {
+ public:
+  // A missing file is an empty database.
+  bool Load(const std::string& filename);
+
+  // Writes to a temporary file that is then renamed, so concurrent readers
+  // never see a partially written database.
+  bool Save(const std::string& filename) const;
+
+  // Returns false if there is no entry for (algorithm, n, rows, k).
+  bool Lookup(const std::string& algorithm, size_t n, size_t rows, size_t k,
+              TuningParameters* parameters) const;
+
+  void Set(const std::string& algorithm, size_t n, size_t rows, size_t k,
+           const TuningParameters& parameters);
+
+  // Re-reads the file, sets the entry and saves the file while holding an
+  // exclusive flock on <filename>.lock, so concurrent updates (e.g., by
+  // several tuners) do not drop each other's entries.
+  bool Update(const std::string& filename, const std::string& algorithm,
+              size_t n, size_t rows, size_t k,
+              const TuningParameters& parameters);
+
+ private:
+  typedef std::tuple<std::string, size_t, size_t, size_t> Key;
+  std::map<Key, TuningParameters> entries_;
+};
+
+#endif